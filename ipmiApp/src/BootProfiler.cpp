@@ -0,0 +1,142 @@
+/* BootProfiler.cpp
+ *
+ * Copyright (c) 2018 Oak Ridge National Laboratory.
+ * All rights reserved.
+ * See file LICENSE that is included with this distribution.
+ */
+
+#include "BootProfiler.h"
+#include "common.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+
+/** JSON string literal with quotes and control characters escaped. */
+static std::string jsonString(const std::string &str)
+{
+    std::string out = "\"";
+    for (char ch: str) {
+        if (ch == '"' || ch == '\\') {
+            out += '\\';
+            out += ch;
+        } else if (static_cast<unsigned char>(ch) < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", ch);
+            out += buf;
+        } else {
+            out += ch;
+        }
+    }
+    return out + "\"";
+}
+
+BootProfiler::Timer::Timer(const std::string &connection, const std::string &scope, const std::string &name)
+: mConnection(connection)
+, mScope(scope)
+, mName(name)
+, mStart(epicsTime::getCurrent())
+{
+}
+
+BootProfiler::Timer::~Timer()
+{
+    if (!mDone)
+        BootProfiler::getInstance().add(mConnection, mScope, mName, mStart, epicsTime::getCurrent() - mStart, true);
+}
+
+void BootProfiler::Timer::done()
+{
+    if (!mDone)
+        BootProfiler::getInstance().add(mConnection, mScope, mName, mStart, epicsTime::getCurrent() - mStart);
+    mDone = true;
+}
+
+void BootProfiler::Timer::setConnection(const std::string &connection)
+{
+    mConnection = connection;
+}
+
+BootProfiler::BootProfiler()
+: mStart(epicsTime::getCurrent())
+{
+}
+
+BootProfiler& BootProfiler::getInstance()
+{
+    static BootProfiler profiler;
+    return profiler;
+}
+
+void BootProfiler::add(const std::string &connection, const std::string &scope, const std::string &name,
+                       const epicsTime &start, double duration, bool failed)
+{
+    const std::string key = connection + '\n' + scope + '\n' + name;
+
+    common::ScopedLock lock(mMutex);
+    auto it = mIndex.find(key);
+    if (it == mIndex.end()) {
+        Phase phase;
+        phase.connection = connection;
+        phase.scope = scope;
+        phase.name = name;
+        phase.firstStart = std::max(0.0, start - mStart);
+        mPhases.push_back(phase);
+        it = mIndex.insert({key, mPhases.size() - 1}).first;
+    }
+
+    Phase &phase = mPhases[it->second];
+    phase.count++;
+    phase.total += duration;
+    phase.max = std::max(phase.max, duration);
+    if (failed)
+        phase.failures++;
+}
+
+std::vector<BootProfiler::Phase> BootProfiler::getPhases()
+{
+    std::vector<Phase> phases;
+    {
+        common::ScopedLock lock(mMutex);
+        phases = mPhases;
+    }
+
+    std::stable_sort(phases.begin(), phases.end(), [](const Phase &a, const Phase &b) {
+        if (a.connection != b.connection)
+            return a.connection < b.connection;
+        return a.firstStart < b.firstStart;
+    });
+    return phases;
+}
+
+void BootProfiler::print()
+{
+    printf("%-16s %-24s %-16s %9s %6s %6s %10s %10s\n",
+           "Connection", "Scope", "Phase", "Start[s]", "Count", "Failed", "Total[s]", "Max[s]");
+    for (auto &phase: getPhases()) {
+        printf("%-16s %-24s %-16s %9.3f %6u %6u %10.3f %10.3f\n", phase.connection.c_str(),
+               (phase.scope.empty() ? "-" : phase.scope.c_str()), phase.name.c_str(),
+               phase.firstStart, phase.count, phase.failures, phase.total, phase.max);
+    }
+}
+
+std::string BootProfiler::toJson()
+{
+    std::ostringstream json;
+    json << "{\"phases\":[";
+    bool first = true;
+    for (auto &phase: getPhases()) {
+        json << (first ? "" : ",") << "\n  {"
+             << "\"connection\":" << jsonString(phase.connection) << ","
+             << "\"scope\":" << jsonString(phase.scope) << ","
+             << "\"phase\":" << jsonString(phase.name) << ","
+             << "\"start\":" << phase.firstStart << ","
+             << "\"count\":" << phase.count << ","
+             << "\"failures\":" << phase.failures << ","
+             << "\"total\":" << phase.total << ","
+             << "\"max\":" << phase.max << "}";
+        first = false;
+    }
+    json << "\n]}\n";
+    return json.str();
+}
@@ -0,0 +1,104 @@
+/* BootProfiler.h
+ *
+ * Copyright (c) 2018 Oak Ridge National Laboratory.
+ * All rights reserved.
+ * See file LICENSE that is included with this distribution.
+ */
+
+#ifndef IPMIAPP_SRC_BOOTPROFILER_H_
+#define IPMIAPP_SRC_BOOTPROFILER_H_
+
+#include <map>
+#include <string>
+#include <vector>
+#include <epicsMutex.h>
+#include <epicsTime.h>
+
+/**
+ * @class BootProfiler
+ * @brief Accumulates time spent in each boot phase, per connection and FRU.
+ *
+ * Phases are identified by connection, scope and name. Repeated phases,
+ * like reconnects or init_record of many records, are aggregated into
+ * one entry with count, total and longest duration.
+ */
+class BootProfiler
+{
+    public:
+
+        struct Phase {
+            std::string connection;
+            std::string scope;              //!< FRU name, empty when phase covers the connection.
+            std::string name;
+            double firstStart{0.0};         //!< Seconds since profiling started when phase first began.
+            double total{0.0};              //!< Seconds spent in all occurrences.
+            double max{0.0};                //!< Longest occurrence in seconds.
+            unsigned count{0};
+            unsigned failures{0};           //!< Occurrences that threw or otherwise failed.
+        };
+
+        /**
+         * @class Timer
+         * @brief Times one occurrence of a phase, counts it as failed unless done() was called.
+         */
+        class Timer
+        {
+            public:
+                Timer(const std::string &connection, const std::string &scope, const std::string &name);
+                ~Timer();
+
+                /**
+                 * @brief Record successful occurrence now.
+                 */
+                void done();
+
+                /**
+                 * @brief Attribute occurrence to connection that wasn't known when the timer started.
+                 */
+                void setConnection(const std::string &connection);
+
+            private:
+                std::string mConnection;
+                const std::string mScope;
+                const std::string mName;
+                epicsTime mStart;
+                bool mDone{false};
+        };
+
+        /**
+         * @brief Return the profiler shared by all connections, profiling starts on first use.
+         */
+        static BootProfiler& getInstance();
+
+        /**
+         * @brief Record one occurrence of a phase.
+         */
+        void add(const std::string &connection, const std::string &scope, const std::string &name,
+                 const epicsTime &start, double duration, bool failed=false);
+
+        /**
+         * @brief Return a copy of all phases, ordered by connection and first start.
+         */
+        std::vector<Phase> getPhases();
+
+        /**
+         * @brief Print phases as a table to stdout.
+         */
+        void print();
+
+        /**
+         * @brief Return phases as JSON object.
+         */
+        std::string toJson();
+
+    private:
+
+        epicsMutex mMutex;
+        const epicsTime mStart;
+        std::vector<Phase> mPhases;
+        std::map<std::string, size_t> mIndex;   //!< Phase index by connection, scope and name.
+
+        BootProfiler();
+};
+
+#endif ///IPMIAPP_SRC_BOOTPROFILER_H_
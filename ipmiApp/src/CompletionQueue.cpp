@@ -0,0 +1,106 @@
+/* CompletionQueue.cpp
+ *
+ * Copyright (c) 2018 Oak Ridge National Laboratory.
+ * All rights reserved.
+ * See file LICENSE that is included with this distribution.
+ */
+
+#include "CompletionQueue.h"
+#include "common.h"
+
+#include <dbLock.h>
+#include <epicsThread.h>
+#include <recSup.h>
+
+#include <algorithm>
+
+/** Enough for every sensor of a fully populated crate completing at once. */
+static const size_t COMPLETION_QUEUE_SIZE = 4096;
+
+extern "C" {
+    static void completionThread(void* ctx)
+    {
+        reinterpret_cast<CompletionQueue*>(ctx)->run();
+    }
+};
+
+CompletionQueue::CompletionQueue(size_t capacity)
+: mRing(capacity)
+{
+    mStats.capacity = capacity;
+    epicsThreadCreate("ipmiCompletion", epicsThreadPriorityMedium,
+        epicsThreadGetStackSize(epicsThreadStackMedium), (EPICSTHREADFUNC)&completionThread, this);
+}
+
+CompletionQueue& CompletionQueue::getInstance()
+{
+    static CompletionQueue queue(COMPLETION_QUEUE_SIZE);
+    return queue;
+}
+
+void CompletionQueue::request(CALLBACK* callback, dbCommon* rec)
+{
+    {
+        common::ScopedLock lock(mMutex);
+        if (mCount < mRing.size()) {
+            mRing[(mHead + mCount) % mRing.size()] = {callback, rec, epicsTime::getCurrent()};
+            mCount++;
+            mStats.maxQueued = std::max(mStats.maxQueued, mCount);
+            mEvent.signal();
+            return;
+        }
+        mStats.overflows++;
+    }
+
+    callbackRequestProcessCallback(callback, rec->prio, rec);
+}
+
+CompletionQueue::Stats CompletionQueue::getStats()
+{
+    common::ScopedLock lock(mMutex);
+    Stats stats = mStats;
+    if (stats.processed > 0)
+        stats.avgLatency = mLatencySum / stats.processed;
+    return stats;
+}
+
+void CompletionQueue::run()
+{
+    std::vector<Entry> batch;
+    batch.reserve(mRing.size());
+
+    while (true) {
+        mEvent.wait();
+
+        {
+            common::ScopedLock lock(mMutex);
+            for (; mCount > 0; mCount--) {
+                batch.push_back(mRing[mHead]);
+                mHead = (mHead + 1) % mRing.size();
+            }
+        }
+        if (batch.empty())
+            continue;
+
+        /** Same as EPICS process callback, record support does the second pass. */
+        double latencySum = 0.0;
+        double latencyMax = 0.0;
+        for (auto& entry: batch) {
+            double latency = epicsTime::getCurrent() - entry.queued;
+            latencySum += latency;
+            latencyMax = std::max(latencyMax, latency);
+
+            dbScanLock(entry.rec);
+            entry.rec->rset->process(entry.rec);
+            dbScanUnlock(entry.rec);
+        }
+
+        common::ScopedLock lock(mMutex);
+        mStats.processed += batch.size();
+        mStats.batches++;
+        mStats.maxBatch = std::max(mStats.maxBatch, batch.size());
+        mStats.maxLatency = std::max(mStats.maxLatency, latencyMax);
+        mLatencySum += latencySum;
+        batch.clear();
+    }
+}
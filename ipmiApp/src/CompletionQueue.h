@@ -0,0 +1,89 @@
+/* CompletionQueue.h
+ *
+ * Copyright (c) 2018 Oak Ridge National Laboratory.
+ * All rights reserved.
+ * See file LICENSE that is included with this distribution.
+ */
+
+#ifndef IPMIAPP_SRC_COMPLETIONQUEUE_H_
+#define IPMIAPP_SRC_COMPLETIONQUEUE_H_
+
+#include <cstddef>
+#include <vector>
+#include <callback.h>
+#include <dbCommon.h>
+#include <epicsEvent.h>
+#include <epicsMutex.h>
+#include <epicsTime.h>
+
+/**
+ * @class CompletionQueue
+ * @brief Finishes asynchronous record processing in batches on its own thread.
+ *
+ * Connections complete reads one by one, a sweep over many sensors would
+ * otherwise push one entry per record into EPICS callback queues. Records
+ * are kept in a bounded ring instead and the completion thread processes
+ * everything queued since it last woke up in one go. When the ring is
+ * full the record is handed to the EPICS callback queue like before, so
+ * no completion is ever lost.
+ */
+class CompletionQueue
+{
+    public:
+
+        /**
+         * @brief Counters since IOC start.
+         */
+        struct Stats {
+            size_t capacity{0};
+            unsigned long processed{0};     //!< Records processed by completion thread
+            unsigned long overflows{0};     //!< Records passed to EPICS callback queue because ring was full
+            unsigned long batches{0};       //!< Completion thread wake-ups
+            size_t maxBatch{0};             //!< Most records processed in one wake-up
+            size_t maxQueued{0};            //!< Highest ring occupancy
+            double avgLatency{0.0};         //!< Seconds from completion to record processing
+            double maxLatency{0.0};
+        };
+
+        /**
+         * @brief Return the queue shared by all records, thread is started on first use.
+         */
+        static CompletionQueue& getInstance();
+
+        /**
+         * @brief Process asynchronous record on completion thread.
+         * @param callback record's own callback, used when ring is full
+         * @param rec record with PACT set
+         */
+        void request(CALLBACK* callback, dbCommon* rec);
+
+        /**
+         * @brief Return a copy of the counters.
+         */
+        Stats getStats();
+
+        /**
+         * @brief Completion thread body.
+         */
+        void run();
+
+    private:
+
+        struct Entry {
+            CALLBACK* callback;
+            dbCommon* rec;
+            epicsTime queued;
+        };
+
+        epicsMutex mMutex;
+        epicsEvent mEvent;
+        std::vector<Entry> mRing;           //!< Fixed size, allocated once.
+        size_t mHead{0};                    //!< Oldest entry.
+        size_t mCount{0};
+        Stats mStats;
+        double mLatencySum{0.0};
+
+        explicit CompletionQueue(size_t capacity);
+};
+
+#endif ///IPMIAPP_SRC_COMPLETIONQUEUE_H_
@@ -5,13 +5,156 @@
  */
 
 #include "EntityAddrType.h"
-#include <regex>
-#include <iostream>
+#include "common.h"
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+#include <string_view>
 
 auto isSensor = [](EntityAddrType::Type t) {return t == EntityAddrType::Type::SENSOR;};
 auto isPicmgLed = [](EntityAddrType::Type t) {return t == EntityAddrType::Type::PICMG_LED;};
 auto isOemCmd = [](EntityAddrType::Type t) {return t == EntityAddrType::Type::OEM_CMD;};
 
+namespace {
+
+/**
+ * @brief Single pass cursor over a link, errors report where parsing stopped.
+ *
+ * Tokens are views into the link, only the parsed results are copied out.
+ */
+class LinkParser
+{
+    public:
+        explicit LinkParser(const std::string &link)
+        : mLink(link)
+        {}
+
+        bool atEnd() const
+        {
+            return mPos >= mLink.size();
+        }
+
+        /** @return number of whitespace characters skipped */
+        size_t skipSpace()
+        {
+            size_t start = mPos;
+            while(!atEnd() && std::isspace(static_cast<unsigned char>(mLink[mPos])))
+                mPos++;
+            return mPos - start;
+        }
+
+        /** Longest run of characters accepted by pred, may be empty. */
+        template<typename F>
+        std::string_view span(F pred)
+        {
+            size_t start = mPos;
+            while(!atEnd() && pred(static_cast<unsigned char>(mLink[mPos])))
+                mPos++;
+            return std::string_view(mLink).substr(start, mPos - start);
+        }
+
+        /** Same as span() but at least one character is required. */
+        template<typename F>
+        std::string_view token(F pred, const char *what)
+        {
+            std::string_view tok = span(pred);
+            if(tok.empty())
+                fail(what);
+            return tok;
+        }
+
+        template<typename F>
+        bool peek(F pred) const
+        {
+            return (!atEnd() && pred(static_cast<unsigned char>(mLink[mPos])));
+        }
+
+        bool accept(char c)
+        {
+            if(atEnd() || mLink[mPos] != c)
+                return false;
+            mPos++;
+            return true;
+        }
+
+        void expect(char c, const char *what)
+        {
+            if(!accept(c))
+                fail(what);
+        }
+
+        /** Decimal number, truncated to 8 bits like IPMI entity fields. */
+        uint8_t number(const char *what)
+        {
+            uint8_t value = 0;
+            for(char ch : token(::isdigit, what))
+                value = value * 10 + (ch - '0');
+            return value;
+        }
+
+        /** Entity as "<id> : <instance>", whitespace allowed around the colon. */
+        std::pair<uint8_t, uint8_t> entity()
+        {
+            uint8_t id = number("entity id");
+            skipSpace();
+            expect(':', "':' after entity id");
+            skipSpace();
+            return std::make_pair(id, number("entity instance"));
+        }
+
+        /** Closing quote is the last one in the link, the quoted string may contain more quotes. */
+        std::string_view quoted()
+        {
+            expect('\'', "opening quote");
+            size_t end = mLink.rfind('\'');
+            if(end == std::string::npos || end < mPos)
+                fail("closing quote");
+            std::string_view str = std::string_view(mLink).substr(mPos, end - mPos);
+            mPos = end + 1;
+            return str;
+        }
+
+        void expectEnd()
+        {
+            skipSpace();
+            if(!atEnd())
+                fail("end of link");
+        }
+
+        [[noreturn]] void fail(const char *what) const
+        {
+            throw std::invalid_argument("Invalid link \'" + mLink + "\': expected " + what +
+                                        " at position " + std::to_string(mPos));
+        }
+
+    private:
+        const std::string &mLink;
+        size_t mPos{0};
+};
+
+bool iequals(std::string_view a, const char *b)
+{
+    size_t i = 0;
+    for(; i < a.size() && b[i] != '\0'; i++)
+    {
+        if(std::toupper(static_cast<unsigned char>(a[i])) != std::toupper(static_cast<unsigned char>(b[i])))
+            return false;
+    }
+    return (i == a.size() && b[i] == '\0');
+}
+
+std::string toLower(std::string_view str)
+{
+    std::string lower(str);
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    return lower;
+}
+
+auto isAlnum = [](unsigned char ch) { return std::isalnum(ch) != 0; };
+auto isAlpha = [](unsigned char ch) { return std::isalpha(ch) != 0; };
+
+}; // namespace
+
 constexpr const char* getEntAddrTypeStr(EntityAddrType::Type t)
 {
     switch (t)
@@ -20,6 +163,8 @@ constexpr const char* getEntAddrTypeStr(EntityAddrType::Type t)
         case EntityAddrType::Type::PICMG_LED: return "PICMG_LED";
         case EntityAddrType::Type::FRU: return "FRU";
         case EntityAddrType::Type::OEM_CMD: return "OEM_CMD";
+        case EntityAddrType::Type::SEL: return "SEL";
+        case EntityAddrType::Type::STATS: return "STATS";
         default:
             throw std::runtime_error("ERROR! getEntAddrTypeStr was called but passed an invalid enumeration \'" + std::to_string((int) t) + "\'");
     }
@@ -34,6 +179,34 @@ EntityAddrType::EntityAddrType(const std::string &recInOutString)
 
     parseInOutString(recInOutString);
 
+    mSensorKey = std::to_string(mSensorEntityId) + ":" + std::to_string(mSensorEntityInstance) + ":" + mSensorIdString;
+    if(mAddrType == Type::FRU && !mFruAll)
+        mFruKey = std::to_string(mFruEntityId) + ":" + std::to_string(mFruEntityInstance);
+}
+
+std::shared_ptr<const EntityAddrType> EntityAddrType::intern(const std::string &link)
+{
+    /** Expired entries are reused on next lookup of the same link. */
+    static epicsMutex mutex;
+    static std::map<std::string, std::weak_ptr<const EntityAddrType>> table;
+
+    common::ScopedLock lock(mutex);
+    std::weak_ptr<const EntityAddrType> &entry = table[link];
+    std::shared_ptr<const EntityAddrType> entAddrType = entry.lock();
+    if(!entAddrType)
+    {
+        try
+        {
+            entAddrType = std::make_shared<const EntityAddrType>(link);
+        }
+        catch(...)
+        {
+            table.erase(link);
+            throw;
+        }
+        entry = entAddrType;
+    }
+    return entAddrType;
 }
 
 EntityAddrType::~EntityAddrType()
@@ -67,7 +240,38 @@ std::pair<uint8_t, bool> EntityAddrType::getSensorEntityInstance() const
 
 std::pair<const std::string &, bool> EntityAddrType::getSensorIdString() const
 {
-    return std::make_pair(mSensorIdString, isSensor(mAddrType));
+    /** make_pair() would return a reference to its own copy of the string. */
+    return std::pair<const std::string &, bool>(mSensorIdString, isSensor(mAddrType));
+}
+
+double EntityAddrType::getPollPeriod() const
+{
+    return mPollPeriod;
+}
+
+const std::string &EntityAddrType::getFruKey() const
+{
+    return mFruKey;
+}
+
+EntityAddrType::FruField EntityAddrType::getFruField() const
+{
+    return mFruField;
+}
+
+EntityAddrType::Stat EntityAddrType::getStat() const
+{
+    return mStat;
+}
+
+double EntityAddrType::getDeadband() const
+{
+    return mDeadband;
+}
+
+bool EntityAddrType::isDeadbandAuto() const
+{
+    return mDeadbandAuto;
 }
 
 std::pair<uint8_t, bool> EntityAddrType::getPicmgLedFruDeviceSlaveSddress() const
@@ -80,16 +284,14 @@ std::pair<uint8_t, bool> EntityAddrType::getPicmgLedId() const
     return std::make_pair(mLedId, isPicmgLed(mAddrType));
 }
 
-const std::string EntityAddrType::getSensorIdAsKey() const
+const std::string &EntityAddrType::getSensorIdAsKey() const
 {
-    return std::to_string(mSensorEntityId) + ":"
-    + std::to_string(mSensorEntityInstance) + ":"
-    + mSensorIdString;
+    return mSensorKey;
 }
 
-std::tuple<const std::string, const std::string, const std::vector<std::string>> EntityAddrType::get_oem_command() const
+std::tuple<const std::string &, const std::string &, const std::vector<std::string> &> EntityAddrType::get_oem_command() const
 {
-    return std::make_tuple(mOemCmd.vendorId, mOemCmd.commandId, mOemCmd.commandArgs);
+    return std::tie(mOemCmd.vendorId, mOemCmd.commandId, mOemCmd.commandArgs);
 }
 
 
@@ -108,80 +310,148 @@ void EntityAddrType::parseInOutString(const std::string &link) {
      * you will have to wrap your string with single quotes if they have
      * spaces at the end.
      * E.g., "@vt811 F5 SID 'VT BIOS POST '"
+     * Sensors may be followed by a poll period in seconds for I/O Intr records.
+     * E.g., "@vt811 SENSOR 30:97 'CU TEMP1' POLL=2"
+     * and a deadband, number in engineering units or AUTO for sensor resolution.
+     * E.g., "@vt811 SENSOR 30:97 'CU TEMP1' DEADBAND=0.5", "@vt811 SENSOR 30:97 'CU TEMP1' POLL=2 DEADBAND=AUTO"
+     * PICMG LEDs are addressed by FRU device and LED id.
+     * E.g., "@vt811 PICMG_LED 0:1"
+     * OEM commands take vendor, command and optional arguments.
+     * E.g., "@vt811 OEM_CMD vadatech reboot", "@vt811 OEM_CMD vadatech set-fan 1 auto"
+     * FRU links read all sensors of a FRU, or of the connection when the
+     * entity is omitted, optionally selecting status or names instead of values.
+     * E.g., "@vt811 FRU 193:97", "@vt811 FRU 193:97 STATUS", "@vt811 FRU NAMES"
+     * E.g., "@vt811 SEL"
+     * STATS links read the module's own counters of the connection.
+     * E.g., "@vt811 STATS queue_depth", "@vt811 STATS state"
+     *
+     * Tokens are separated by any whitespace, spaces and tabs alike, which
+     * may also lead and trail the link. Link types, option names and FRU
+     * fields are case insensitive, OEM_CMD included. Entity may be glued to
+     * SENSOR and PICMG_LED keywords, e.g. "SENSOR30:97", but not to FRU.
+     * OEM command arguments are letters, digits, '-' and '_', any length.
     */
 
-    std::regex re_sensor ("([a-zA-Z0-9]+) ([sS][eE][nN][sS][oO][rR]) *([0-9]+) *: *([0-9]+) *\'(.*)\'");
-    std::regex re_picmg_led("([a-zA-Z0-9]+) ([pP][iI][cC][mM][gG]_[lL][eE][dD]) *([0-9]+) *: *([0-9]+)");
-    //std::regex re_oem_cmd ("^([a-zA-Z0-9]+)\\s+OEM_CMD\\s+([a-zA-Z0-9]+)\\s+([a-zA-Z0-9]+)\\s*$");
-    std::regex re_oem_cmd ("^([a-zA-Z0-9]+)\\s+OEM_CMD\\s+([a-zA-Z0-9]+)\\s+([a-zA-Z0-9-]+)(?: ([a-zA-Z0-9][a-zA-Z0-9-_\\s]+))?$");
-    std::smatch re_m;
-
-    /**
-     * cid = connection ID
-     * type = object type: sensor, led, etc.
-     * et = entity type
-     * ei = entity instance
-     * sid = sensor id-string
-    */
+    LinkParser parser(link);
 
-    /* Do we have SID? */
-    if(std::regex_match(link, re_m, re_sensor))
+    parser.skipSpace();
+    mConnectionId = parser.token(isAlnum, "connection id");
+    if(parser.skipSpace() == 0)
+        parser.fail("whitespace after connection id");
+    std::string_view type = parser.token([](unsigned char ch) { return std::isalpha(ch) || ch == '_'; }, "link type");
+    size_t gap = parser.skipSpace();
+
+    if(iequals(type, "SENSOR"))
     {
-        mConnectionId = re_m[1];
-        mAddrType = Type::SENSOR; ///re_m[2];
-        mSensorEntityId = (std::stoul(re_m[3]) & 0xFF);
-        mSensorEntityInstance = (std::stoul(re_m[4]) & 0xFF);
+        mAddrType = Type::SENSOR;
+        std::tie(mSensorEntityId, mSensorEntityInstance) = parser.entity();
+        parser.skipSpace();
 
         /** The quotes were only used to keep whitespace characters that
          *  are unknowingly at the end of the strings... Take them off
          *  now and preserve those whitespace characters.
         */
-        for(auto &ch : re_m[5].str())
+        for(char ch : parser.quoted())
         {
             if(ch != '\'')
                 mSensorIdString.push_back(ch);
         }
+
+        /** Trailing KEY=value options in any order. */
+        while(parser.skipSpace() > 0 && !parser.atEnd())
+        {
+            std::string_view key = parser.token(isAlpha, "option name");
+            parser.skipSpace();
+            parser.expect('=', "'=' after option name");
+            parser.skipSpace();
+            std::string value = toLower(parser.token([](unsigned char ch) { return std::isalnum(ch) || ch == '.'; }, "option value"));
+            try
+            {
+                if(iequals(key, "POLL"))
+                    mPollPeriod = std::stod(value);
+                else if(iequals(key, "DEADBAND") && value == "auto")
+                    mDeadbandAuto = true;
+                else if(iequals(key, "DEADBAND"))
+                    mDeadband = std::stod(value);
+                else
+                    throw std::invalid_argument("unknown option");
+            }
+            catch(const std::logic_error &e)
+            {
+                throw std::invalid_argument("Invalid option \'" + std::string(key) + "=" + value + "\' in link \'" + link + "\'");
+            }
+        }
+        parser.expectEnd();
     }
-    else if(std::regex_match(link, re_m, re_picmg_led))
+    else if(iequals(type, "PICMG_LED"))
     {
-        mConnectionId = re_m[1];
-        mAddrType = Type::PICMG_LED; ///re_m[2];
-        mLogicalFruDeviceSlaveSddress = (std::stoul(re_m[3]) & 0xFF);
-        mLedId = (std::stoul(re_m[4]) & 0xFF);
+        mAddrType = Type::PICMG_LED;
+        std::tie(mLogicalFruDeviceSlaveSddress, mLedId) = parser.entity();
+        parser.expectEnd();
     }
-    else if (std::regex_match(link, re_m, re_oem_cmd))
+    else if(iequals(type, "OEM_CMD"))
     {
         mAddrType = Type::OEM_CMD;
-        mConnectionId = re_m[1].str();
-        mOemCmd.vendorId = re_m[2].str();
-        mOemCmd.commandId = re_m[3].str();
-
-        /* Make'em lowercase.*/
-        std::transform(mOemCmd.vendorId.begin(), mOemCmd.vendorId.end(), mOemCmd.vendorId.begin(), ::tolower);
-        std::transform(mOemCmd.commandId.begin(), mOemCmd.commandId.end(), mOemCmd.commandId.begin(), ::tolower);
-        
-        /** Optional command arguments*/
-        if(!re_m[4].str().empty())
-        {
-            /** split the list of arguments based on whitespace*/
-            int strstart = 0;
-            int strend = 0;
-            while((strstart = re_m[4].str().find_first_not_of( ' ',strend)) != std::string::npos)
-            {
-                strend = re_m[4].str().find(' ', strstart);
-                mOemCmd.commandArgs.push_back(re_m[4].str().substr(strstart, strend-strstart));
-            }
-            for(auto &str : mOemCmd.commandArgs)
-            {
-                /** Make these lower too*/
-                std::transform(str.begin(), str.end(), str.begin(), ::tolower);
-            }
+        mOemCmd.vendorId = toLower(parser.token(isAlnum, "OEM vendor"));
+        if(parser.skipSpace() == 0)
+            parser.fail("whitespace after OEM vendor");
+        mOemCmd.commandId = toLower(parser.token([](unsigned char ch) { return std::isalnum(ch) || ch == '-'; }, "OEM command"));
+
+        /** Optional command arguments, separated by whitespace. */
+        while(parser.skipSpace() > 0 && !parser.atEnd())
+            mOemCmd.commandArgs.push_back(toLower(parser.token([](unsigned char ch) { return std::isalnum(ch) || ch == '-' || ch == '_'; }, "OEM command argument")));
+        parser.expectEnd();
+    }
+    else if(iequals(type, "SEL"))
+    {
+        mAddrType = Type::SEL;
+        parser.expectEnd();
+    }
+    else if(iequals(type, "STATS"))
+    {
+        static const std::map<std::string, Stat> stats = {
+            {"queue_depth",     Stat::QUEUE_DEPTH},
+            {"read_rate",       Stat::READ_RATE},
+            {"error_rate",      Stat::ERROR_RATE},
+            {"errors",          Stat::ERRORS},
+            {"timeouts",        Stat::TIMEOUTS},
+            {"reconnects",      Stat::RECONNECTS},
+            {"latency_avg",     Stat::LATENCY_AVG},
+            {"latency_p99",     Stat::LATENCY_P99},
+            {"sdr_generation",  Stat::SDR_GENERATION},
+            {"connected",       Stat::CONNECTED},
+            {"state",           Stat::STATE},
+        };
+
+        mAddrType = Type::STATS;
+        std::string name = toLower(parser.token([](unsigned char ch) { return std::isalnum(ch) || ch == '_'; }, "statistic name"));
+        auto it = stats.find(name);
+        if(it == stats.end())
+            throw std::invalid_argument("Unknown statistic \'" + name + "\' in link \'" + link + "\'");
+        mStat = it->second;
+        parser.expectEnd();
+    }
+    else if(iequals(type, "FRU"))
+    {
+        mAddrType = Type::FRU;
+        if(gap > 0 && parser.peek(::isdigit))
+        {
+            mFruAll = false;
+            std::tie(mFruEntityId, mFruEntityInstance) = parser.entity();
+            gap = parser.skipSpace();
         }
+
+        std::string_view field = (gap > 0 ? parser.span(isAlpha) : std::string_view());
+        if(iequals(field, "STATUS"))
+            mFruField = FruField::STATUS;
+        else if(iequals(field, "NAMES"))
+            mFruField = FruField::NAMES;
+        else if(!field.empty() && !iequals(field, "VALUES"))
+            throw std::invalid_argument("Unknown FRU field \'" + std::string(field) + "\' in link \'" + link + "\'");
+        parser.expectEnd();
     }
-        
-    
-    else {  /* Something is wrong. Throw now! */
-        throw std::invalid_argument("Link field does not contain proper arguments. \'" + link + "\'");
+    else
+    {
+        throw std::invalid_argument("Unknown link type \'" + std::string(type) + "\' in link \'" + link + "\'");
     }
 }
-
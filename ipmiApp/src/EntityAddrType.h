@@ -9,9 +9,17 @@
 
 #include <string>
 #include <map>
+#include <memory>
 #include <vector>
 #include <tuple>
 
+/**
+ * @class EntityAddrType
+ * @brief Parsed record link, immutable once constructed.
+ *
+ * Records with identical links share one object through intern(), accessors
+ * return references into it.
+ */
 class EntityAddrType {
 
 public:
@@ -19,7 +27,31 @@ public:
         SENSOR,
         FRU,
         PICMG_LED,
-        OEM_CMD
+        OEM_CMD,
+        SEL,
+        STATS
+    };
+
+    /** What a FRU link returns, all arrays are in the same sensor order. */
+    enum class FruField {
+        VALUES,     //!< Sensor readings
+        STATUS,     //!< Alarm severity of each reading
+        NAMES       //!< Sensor id strings
+    };
+
+    /** Module's own counter a STATS link reads, no IPMI traffic involved. */
+    enum class Stat {
+        QUEUE_DEPTH,        //!< Tasks waiting for the connection thread
+        READ_RATE,          //!< Tasks per second
+        ERROR_RATE,         //!< Failed tasks per second
+        ERRORS,             //!< Failed tasks since IOC start
+        TIMEOUTS,           //!< Reads that found the session timed out
+        RECONNECTS,         //!< Sessions established after the first one
+        LATENCY_AVG,        //!< Mean task time in ms
+        LATENCY_P99,        //!< 99th percentile task time in ms
+        SDR_GENERATION,     //!< Times SDR was loaded, 0 until first load
+        CONNECTED,          //!< 1 when session is up
+        STATE               //!< "connecting", "connected" or "disconnected"
     };
 
 private:
@@ -29,6 +61,17 @@ private:
     uint8_t mSensorEntityId;
     uint8_t mSensorEntityInstance;
     std::string mSensorIdString;
+    std::string mSensorKey;             //!< "entity-id:entity-instance:id-string", composed once.
+    double mPollPeriod{0.0};            //!< Optional POLL=<seconds> from the link, 0 when not given.
+    double mDeadband{-1.0};             //!< Optional DEADBAND=<value> from the link, negative when not given.
+    bool mDeadbandAuto{false};          //!< DEADBAND=auto, deadband comes from sensor's resolution.
+
+    bool mFruAll{true};                 //!< FRU link without entity covers all sensors of the connection.
+    uint8_t mFruEntityId{0};
+    uint8_t mFruEntityInstance{0};
+    FruField mFruField{FruField::VALUES};
+    Stat mStat{Stat::QUEUE_DEPTH};
+    std::string mFruKey;                //!< "entity-id:entity-instance", empty for whole connection.
 
     uint8_t mLogicalFruDeviceSlaveSddress;
     uint8_t mLedId;
@@ -46,6 +89,12 @@ public:
     EntityAddrType(const std::string &recInOutString);
     ~EntityAddrType();
 
+    /**
+     * @brief Return the parsed link, shared with all other users of identical link text.
+     * @throw std::invalid_argument when link can't be parsed, failures are not cached
+     */
+    static std::shared_ptr<const EntityAddrType> intern(const std::string &link);
+
     const std::string &getConnectionId() const;
     EntityAddrType::Type getEntityAddressType() const;
     const std::string getEntityAddressTypeAsString() const;
@@ -53,12 +102,30 @@ public:
     std::pair<uint8_t, bool> getSensorEntityId() const;
     std::pair<uint8_t, bool> getSensorEntityInstance() const;
     std::pair<const std::string &, bool> getSensorIdString() const;
-    const std::string getSensorIdAsKey() const;
+    const std::string &getSensorIdAsKey() const;
+    double getPollPeriod() const;
+
+    /**
+     * @brief Deadband from the link in engineering units, negative when not given or auto.
+     */
+    double getDeadband() const;
+
+    /**
+     * @brief Link asked for deadband of sensor's resolution with DEADBAND=auto.
+     */
+    bool isDeadbandAuto() const;
+
+    /**
+     * @brief FRU entity as "entity-id:entity-instance", empty when link covers whole connection.
+     */
+    const std::string &getFruKey() const;
+    FruField getFruField() const;
+    Stat getStat() const;
 
     std::pair<uint8_t, bool> getPicmgLedFruDeviceSlaveSddress() const;
     std::pair<uint8_t, bool> getPicmgLedId() const;
 
-    std::tuple<const std::string, const std::string, const std::vector<std::string>> get_oem_command() const;
+    std::tuple<const std::string &, const std::string &, const std::vector<std::string> &> get_oem_command() const;
 
 };
 
@@ -5,6 +5,7 @@
  */
 
 #include "IpmiConnectionManager.h"
+#include "BootProfiler.h"
 #include <stdexcept>
 #include <sstream>
 #include <iostream>
@@ -20,12 +21,15 @@ std::map<std::string, uint8_t> IpmiConnectionManager::VADATECH_SITE_TYPES =
     {"pm", 0x0B}
 };
 
-const std::map<std::string, std::string> IpmiConnectionManager::mThresholdsMap =
+/** Thresholds are configuration, no need to ask for them with every reading. */
+const double IpmiConnectionManager::LIMITS_REFRESH_PERIOD = 60.0;
+
+const std::map<std::string, Provider::Entity::Field> IpmiConnectionManager::mThresholdsMap =
 {
-    {"lower_critical_threshold", "LOLO"},
-    {"lower_non_critical_threshold", "LOW"},
-    {"upper_non_critical_threshold", "HIGH"},
-    {"upper_critical_threshold", "HIHI"}
+    {"lower_critical_threshold", Provider::Entity::LOLO},
+    {"lower_non_critical_threshold", Provider::Entity::LOW},
+    {"upper_non_critical_threshold", Provider::Entity::HIGH},
+    {"upper_critical_threshold", Provider::Entity::HIHI}
 };
 
 /** "readable_thresholds.lower_non_critical_threshold" */
@@ -61,25 +65,30 @@ int IpmiConnectionManager::vadatech_set_power_state(ipmi_ctx_t ctx, const std::v
 {
     if(args.size() < 2)
     {
-        throw std::runtime_error("Can't set_power_state. vadatech set_power_state requires two arguments: "
+        throw Provider::syntax_error("Can't set_power_state. vadatech set_power_state requires two arguments: "
         "Module type (e.g., AMC, MCH, PM,...) and Site Number (1...16).\n"
         "Example: set_power_state AMC 1\n");
     }
-    if(!entity.hasField("VAL"))
+    if(!entity.hasField<Provider::Entity::VAL>())
     {
-        throw std::runtime_error("Can't set_power_state. Missing \'VAL\' field. Device support routine is supposed to set the VAL field.\n");
+        throw Provider::syntax_error("Can't set_power_state. Missing \'VAL\' field. Device support routine is supposed to set the VAL field.\n");
     }
 
     const uint8_t SET_CHASSIS_POWER_STATE = 0x9E;
-    const uint8_t val = entity.getField<int>("VAL", 0);
+    const uint8_t val = entity.getField<Provider::Entity::VAL>(0);
     const std::string &SITE_TYPE_NAME = args[0];
     const std::string &SITE_ID_STRING = args[1];
-    const uint8_t SITE_ID = std::stoi(SITE_ID_STRING);
+    uint8_t SITE_ID;
+    try {
+        SITE_ID = std::stoi(SITE_ID_STRING);
+    } catch (std::logic_error &e) {
+        throw Provider::syntax_error("Can't set_power_state. Invalid Site Number '" + SITE_ID_STRING + "'\n");
+    }
 
     auto site_type_itr = IpmiConnectionManager::VADATECH_SITE_TYPES.find(SITE_TYPE_NAME);
     if(site_type_itr == IpmiConnectionManager::VADATECH_SITE_TYPES.end())
     {
-        throw std::runtime_error("Can't set_power_state. Invalid Site Type \'" + SITE_TYPE_NAME + "\'\n");
+        throw Provider::syntax_error("Can't set_power_state. Invalid Site Type \'" + SITE_TYPE_NAME + "\'\n");
     }
     const uint8_t SITE_TYPE_VALUE = site_type_itr->second;
 
@@ -96,20 +105,24 @@ int IpmiConnectionManager::vadatech_set_power_state(ipmi_ctx_t ctx, const std::v
      * See Table 5-, Completion Codes in the IPMI specification.
     */
 
-    if(rval != 2)
+    if(rval < 0)
+    {
+        throw Provider::comm_error("set_power_state failed: " + std::string(ipmi_ctx_errormsg(ctx)) + "\n");
+    }
+    else if(rval != 2)
     {
-        throw std::runtime_error("set_power_state returned an invalid value. "
+        throw Provider::process_error("set_power_state returned an invalid value. "
         "A value of 2 was expected but " + std::to_string(rval) + " was returned.\n");
     }
     else if (buf_rs[0] != SET_CHASSIS_POWER_STATE)
     {
-        throw std::runtime_error("set_power_state returned an invalid value. "
+        throw Provider::process_error("set_power_state returned an invalid value. "
         "OEM command of \'" + common::hex_dump(&SET_CHASSIS_POWER_STATE, 0, 1) + "\' expected but \'" + common::hex_dump(&buf_rs[0],0,1) + "\' was returned.\n");
     }
     else if (buf_rs[1] != IPMI_COMP_CODE_COMMAND_SUCCESS)
     {
-        throw std::runtime_error("set_power_state returned an invalid Completion Code. "
-        "A value of \'0x00\' was expected but \'" + common::hex_dump(&buf_rs[1], 0, 1) + "\' was returned.\n");
+        throw Provider::process_error("set_power_state returned an invalid Completion Code. "
+        "A value of \'0x00\' was expected but \'" + common::hex_dump(&buf_rs[1], 0, 1) + "\' was returned.\n", buf_rs[1]);
     }
     
     return 0;
@@ -117,13 +130,13 @@ int IpmiConnectionManager::vadatech_set_power_state(ipmi_ctx_t ctx, const std::v
 
 int IpmiConnectionManager::vadatech_reboot_chassis(ipmi_ctx_t ctx, const std::vector<std::string> &args, Provider::Entity &entity)
 {
-    if(!entity.hasField("VAL"))
+    if(!entity.hasField<Provider::Entity::VAL>())
     {
-        throw std::runtime_error("Can't reboot_chassis. Missing \'VAL\' field. Device support routine is supposed to set the VAL field.\n");
+        throw Provider::syntax_error("Can't reboot_chassis. Missing \'VAL\' field. Device support routine is supposed to set the VAL field.\n");
     }
 
     const uint8_t SET_CHASSIS_POWER_STATE = 0x9E;
-    const uint8_t val = entity.getField<int>("VAL", 0);
+    const uint8_t val = entity.getField<Provider::Entity::VAL>(0);
     
     if(val < 1)
     {
@@ -137,6 +150,27 @@ int IpmiConnectionManager::vadatech_reboot_chassis(ipmi_ctx_t ctx, const std::ve
     int rval = IpmiConnectionManager::send_ipmi_cmd_raw_ipmb(ctx, IPMI_CHANNEL_NUMBER_PRIMARY_IPMB, IpmiConnectionManager::VADATECH_IPMB_ADDRESS,
         IPMI_BMC_IPMB_LUN_BMC, IPMI_NET_FN_OEM_GROUP_RQ, &buf_rq, sizeof(buf_rq), &buf_rs, sizeof(buf_rs));
 
+    if(rval < 0)
+    {
+        /** MCH resets together with the chassis and never replies, anything else didn't reach it. */
+        int err_num = ipmi_ctx_errnum(ctx);
+        if(err_num == IPMI_ERR_MESSAGE_TIMEOUT || err_num == IPMI_ERR_SESSION_TIMEOUT)
+        {
+            return 0;
+        }
+        throw Provider::comm_error("reboot_chassis failed: " + std::string(ipmi_ctx_errormsg(ctx)) + "\n");
+    }
+    else if(rval < 2)
+    {
+        throw Provider::process_error("reboot_chassis returned an invalid value. "
+        "At least 2 bytes were expected but " + std::to_string(rval) + " were returned.\n");
+    }
+    else if (buf_rs[1] != IPMI_COMP_CODE_COMMAND_SUCCESS)
+    {
+        throw Provider::process_error("reboot_chassis returned an invalid Completion Code. "
+        "A value of \'0x00\' was expected but \'" + common::hex_dump(&buf_rs[1], 0, 1) + "\' was returned.\n", buf_rs[1]);
+    }
+
     return 0;
 }
 
@@ -181,11 +215,9 @@ IpmiConnectionManager::IpmiConnectionManager(const std::string &connectionid, co
             fs::create_directory(mCachePath);
         }
 
-        createIpmiContext();
-        createSdrContext();
-        connect();
-        openSdrCache();
-        createSensorContext(); /** This has to come after connection is ready to go.*/
+        /** The session and SDR cache are opened from the provider thread
+         *  (see process()) so that ipmiConnect does not block IOC boot.
+        */
     }
     catch(fs::filesystem_error const &fserr)
     {
@@ -349,10 +381,19 @@ void IpmiConnectionManager::openSdrCache()
 {
 
     int rv = -1;
+    /** Opening and creating the cache are profiled separately, create reads the whole SDR from the device. */
+    auto openCache = [this]() {
+        BootProfiler::Timer timer(mConnId, "", "sdr cache open");
+        int status = ipmi_sdr_cache_open(mSdrCtx, mIpmiCtx, mCacheFile.c_str());
+        if (status == 0)
+            timer.done();
+        return status;
+    };
+
     /** open creates/opens the file and reads it into memory using mmap. So all
      * of the sdr parse calls come from memory, not the file.
     */
-    if ((rv = ipmi_sdr_cache_open(mSdrCtx, mIpmiCtx, mCacheFile.c_str())) < 0)
+    if ((rv = openCache()) < 0)
     {
         
         switch (ipmi_sdr_ctx_errnum(mSdrCtx))
@@ -364,13 +405,17 @@ void IpmiConnectionManager::openSdrCache()
                 // fall thru
             case IPMI_SDR_ERR_CACHE_READ_CACHE_DOES_NOT_EXIST:
                 LOG_INFO("Creating new SDR cache file \'" + mCacheFile.string() + "\' for connection id: \'" + mConnId + "\'");
-                (void)ipmi_sdr_cache_create(mSdrCtx, mIpmiCtx, mCacheFile.c_str(), IPMI_SDR_CACHE_CREATE_FLAGS_DEFAULT, NULL, NULL);
+                {
+                    BootProfiler::Timer create(mConnId, "", "sdr cache create");
+                    if (ipmi_sdr_cache_create(mSdrCtx, mIpmiCtx, mCacheFile.c_str(), IPMI_SDR_CACHE_CREATE_FLAGS_DEFAULT, NULL, NULL) == 0)
+                        create.done();
+                }
                 break;
             default:
                 throw std::runtime_error("Can't open SDR cache file \'" + mCacheFile.string() + "\' for connection id: \'" + mConnId + "\' -" 
                 + std::string(ipmi_ctx_errormsg(mIpmiCtx)));
         }
-        if ((rv = ipmi_sdr_cache_open(mSdrCtx, mIpmiCtx, mCacheFile.c_str())) < 0)
+        if ((rv = openCache()) < 0)
             throw std::runtime_error("Can't open SDR cache file \'" + mCacheFile.string() + "\' for connection id: \'" + mConnId + "\' -" 
             + std::string(ipmi_ctx_errormsg(mIpmiCtx)));
     }
@@ -443,9 +488,17 @@ void IpmiConnectionManager::disconnect()
 {
     printf("Disconnecting...\n");
     cleanup();
+    mLimitsCache.clear();
     mDisconnectTime = epicsTime::getCurrent();
 }
 
+void IpmiConnectionManager::close()
+{
+    /** ipmi_ctx_close() sends Close Session before tearing down the context. */
+    cleanup();
+    mLimitsCache.clear();
+}
+
 void IpmiConnectionManager::reconnect()
 {
 
@@ -454,13 +507,30 @@ void IpmiConnectionManager::reconnect()
     * If we have rebooted the chassis, give it time
     * to fully come back and initialize.
     */
-    if(epicsTime::getCurrent() > mDisconnectTime+60)
+    if(isReconnectDue())
     {
-        createIpmiContext();
-        createSdrContext();
-        connect();
-        openSdrCache();
-        createSensorContext(); /** This has to come after connection is ready to go.*/
+        try
+        {
+            epicsTime start = epicsTime::getCurrent();
+            BootProfiler::Timer session(mConnId, "", "session");
+            createIpmiContext();
+            createSdrContext();
+            connect();
+            session.done();
+            epicsTime connected = epicsTime::getCurrent();
+            mConnectDuration = connected - start;
+            openSdrCache();
+            mSdrCacheDuration = epicsTime::getCurrent() - connected;
+            createSensorContext(); /** This has to come after connection is ready to go.*/
+            mSessions++;
+        }
+        catch(const std::exception &e)
+        {
+            /** Don't retry on every pass of the provider thread, wait another minute.*/
+            cleanup();
+            mDisconnectTime = epicsTime::getCurrent();
+            throw;
+        }
     }
 }
 
@@ -506,6 +576,11 @@ const std::string &IpmiConnectionManager::getHostname() const
     return mHostname;
 }
 
+fs::path IpmiConnectionManager::getLedCacheFile() const
+{
+    return mCachePath / (mConnId + "." + mHostname + ".leds");
+}
+
 void IpmiConnectionManager::process()
 {
 
@@ -528,6 +603,36 @@ bool IpmiConnectionManager::isConnected()
     return (mConnState == ConnectionState::CONNECTED);
 }
 
+ConnectionState IpmiConnectionManager::getConnectionState() const
+{
+    return mConnState;
+}
+
+bool IpmiConnectionManager::isReconnectDue()
+{
+    return (mConnState != ConnectionState::CONNECTED && epicsTime::getCurrent() > mDisconnectTime+60);
+}
+
+double IpmiConnectionManager::getConnectDuration() const
+{
+    return mConnectDuration;
+}
+
+double IpmiConnectionManager::getSdrCacheDuration() const
+{
+    return mSdrCacheDuration;
+}
+
+unsigned IpmiConnectionManager::getReconnectCount() const
+{
+    return (mSessions > 0 ? mSessions - 1 : 0);
+}
+
+unsigned IpmiConnectionManager::getTimeoutCount() const
+{
+    return mTimeouts;
+}
+
 void IpmiConnectionManager::keepAlive()
 {
 
@@ -591,92 +696,27 @@ void IpmiConnectionManager::updateIdleTime()
 
 Provider::Entity IpmiConnectionManager::getSensorReading(const std::shared_ptr<IpmiSensorRecComp> record)
 {
-
-
-    try
-    {
-        return readSensor(record);
-    }
-    catch(const IpmiException &e)
-    {
-        /**
-         * Trap possible session-timeouts and handle reconnections. 
-         * This is indicative of a session timeout/device disconnected.
-         * The actual error code/message returned from IPMI will be 16/'internal IPMI error'
-         * which isn't very descriptive. But if you dig deeper you find 'session timeout'.
-         * But sometimes you get read errors that are okay and so you do not want to
-         * disconnect. e.g., Error Code: '5', Error String: 'sensor reading unavailable'
-        */
-        if(e.getErrorCode() == 16)
-        {
-
-            disconnect();
-
-            std::stringstream ss;
-            ss << "Could not read sensor for {\n";
-            ss << " * Connection-ID: \'" << mConnId << "\'\n";
-            ss << " * Hostname: \'" << mHostname << "\'\n";
-            ss << " * Entity-Id: \'" << std::to_string(record->get_entity_id()) << "\'\n";
-            ss << " * Entity-Instance: \'" << std::to_string(record->get_entity_instance()) << "\'\n";
-            ss << " * Sensor-Id-String: \'" << record->get_device_id_string() << "\'\n";
-            ss << " * Reason: \'Session Timeout\'" << "\n";
-            ss << " * Error Code: \'" << e.getErrorCode() << "\', Error Message: \'" << e.getErrorString() << "\'\n";
-            ss << "}\n\n";
-            throw std::runtime_error(ss.str());
-        }
-        else
-        {
-            //this->disconnect();
-            std::stringstream ss;
-            ss << "Could not read sensor for {\n";
-            ss << " * Connection-ID: \'" << mConnId << "\'\n";
-            ss << " * Hostname: \'" << mHostname << "\'\n";
-            ss << " * Entity-Id: \'" << std::to_string(record->get_entity_id()) << "\'\n";
-            ss << " * Entity-Instance: \'" << std::to_string(record->get_entity_instance()) << "\'\n";
-            ss << " * Sensor-Id-String: \'" << record->get_device_id_string() << "\'\n";
-            ss << " * Reason: \'" << e.getErrorString() << "\'\n";
-            ss << " * Error Code: \'" << e.getErrorCode() << "\', Error Message: \'" << e.getErrorString() << "\'\n";
-            ss << "}\n\n";
-            throw std::runtime_error(ss.str());
-        }
-    }
-    catch(const std::exception& e)
+    Provider::Entity entity;
+    Provider::ReadError error;
+    if(!tryReadSensor(record, entity, error))
     {
-        std::stringstream ss;
-        ss << "Could not read sensor for {\n";
-        ss << " * Connection-ID: \'" << mConnId << "\'\n";
-        ss << " * Hostname: \'" << mHostname << "\'\n";
-        ss << " * Entity-Id: \'" << std::to_string(record->get_entity_id()) << "\'\n";
-        ss << " * Entity-Instance: \'" << std::to_string(record->get_entity_instance()) << "\'\n";
-        ss << " * Sensor-Id-String: \'" << record->get_device_id_string() << "\'\n";
-        ss << " * Reason: " << e.what() << "\n";
-        ss << "}\n\n";
-        throw std::runtime_error(ss.str());
+        throw std::runtime_error(formatReadError(*record, error));
     }
-    
+    return entity;
 }
 
-void IpmiConnectionManager::write_oem_command(const std::shared_ptr<EntityAddrType> entAddrType, Provider::Entity &entity)
+void IpmiConnectionManager::write_oem_command(OEM_HANDLER handler, const std::vector<std::string> &args, Provider::Entity &entity)
 {
-
-    auto [vendorId, command, cmdArgs] = entAddrType->get_oem_command();
-
-    for(auto &key_value : IpmiConnectionManager::oem_cmds)
+    if(mConnState != ConnectionState::CONNECTED)
     {
-        auto vendor = std::find(key_value.first.begin(), key_value.first.end(), vendorId);
-        if(vendor != key_value.first.end())
-        {
-            auto cmd = key_value.second.find(command);
-            if(cmd != key_value.second.end())
-            {
-                cmd->second(mIpmiCtx, cmdArgs, entity);
-                updateIdleTime();
-            }
-        }
+        throw Provider::comm_error("Can't send OEM command to '" + mConnId + "', device is disconnected.\n");
     }
+
+    handler(mIpmiCtx, args, entity);
+    updateIdleTime();
 }
 
-bool IpmiConnectionManager::is_valid_oem_command(const std::string &vendor_id, const std::string &command)
+IpmiConnectionManager::OEM_HANDLER IpmiConnectionManager::findOemHandler(const std::string &vendor_id, const std::string &command)
 {
      /** Walk thru the map of vendor-ids and vendor-commands.*/
     for(auto &key_value : IpmiConnectionManager::oem_cmds)
@@ -691,75 +731,97 @@ bool IpmiConnectionManager::is_valid_oem_command(const std::string &vendor_id, c
             auto cmd = key_value.second.find(command);
             if(cmd != key_value.second.end())
             {
-                return true;
+                return cmd->second;
             }
         }
     }
-    return false;
+    return nullptr;
 }
 
-Provider::Entity IpmiConnectionManager::readSensor(const std::shared_ptr<IpmiSensorRecComp> record)
+bool IpmiConnectionManager::is_valid_oem_command(const std::string &vendor_id, const std::string &command)
+{
+    return (findOemHandler(vendor_id, command) != nullptr);
+}
+
+std::string IpmiConnectionManager::formatReadError(const IpmiSensorRecComp &record, const Provider::ReadError &error) const
+{
+    std::stringstream ss;
+    ss << "Could not read sensor for {\n";
+    ss << " * Connection-ID: \'" << mConnId << "\'\n";
+    ss << " * Hostname: \'" << mHostname << "\'\n";
+    ss << " * Entity-Id: \'" << std::to_string(record.get_entity_id()) << "\'\n";
+    ss << " * Entity-Instance: \'" << std::to_string(record.get_entity_instance()) << "\'\n";
+    ss << " * Sensor-Id-String: \'" << record.get_device_id_string() << "\'\n";
+    switch(error.reason)
+    {
+        case Provider::ReadError::Reason::DISCONNECTED:
+            ss << " * Reason: Device is disconnected.\n";
+            break;
+        case Provider::ReadError::Reason::NO_CONTEXT:
+            ss << " * Reason: sensor-ctx is null.\n";
+            break;
+        case Provider::ReadError::Reason::SESSION_TIMEOUT:
+            ss << " * Reason: \'Session Timeout\'\n";
+            ss << " * Error Code: \'" << error.code << "\', Error Message: \'" << ipmi_sensor_read_ctx_strerror(error.code) << "\'\n";
+            break;
+        default:
+            ss << " * Reason: \'" << ipmi_sensor_read_ctx_strerror(error.code) << "\'\n";
+            ss << " * Error Code: \'" << error.code << "\'\n";
+            break;
+    }
+    ss << "}\n";
+    return ss.str();
+}
+
+bool IpmiConnectionManager::tryReadSensor(const std::shared_ptr<IpmiSensorRecComp> record, Provider::Entity &entity,
+                                          Provider::ReadError &error, Provider::WireTime* wire)
 {
-    
     if(mConnState != ConnectionState::CONNECTED)
     {
-        std::stringstream ss;
-        ss << "Could not read sensor for {\n";
-        ss << " * Connection-ID: \'" << mConnId << "\'\n";
-        ss << " * Hostname: \'" << mHostname << "\'\n";
-        ss << " * Entity-Id: \'" << std::to_string(record->get_entity_id()) << "\'\n";
-        ss << " * Entity-Instance: \'" << std::to_string(record->get_entity_instance()) << "\'\n";
-        ss << " * Sensor-Id-String: \'" << record->get_device_id_string() << "\'\n";
-        ss << " * Reason: Device is disconnected.\n";
-        ss << "}\n\n";
-        throw std::runtime_error(ss.str());
+        error = {Provider::ReadError::Reason::DISCONNECTED, 0};
+        return false;
     }
 
     if (!mSensorCtx)
     {
-        std::stringstream ss;
-        ss << "Could not read sensor for {\n";
-        ss << " * Connection-ID: \'" << mConnId << "\'\n";
-        ss << " * Hostname: \'" << mHostname << "\'\n";
-        ss << " * Entity-Id: \'" << std::to_string(record->get_entity_id()) << "\'\n";
-        ss << " * Entity-Instance: \'" << std::to_string(record->get_entity_instance()) << "\'\n";
-        ss << " * Sensor-Id-String: \'" << record->get_device_id_string() << "\'\n";
-        ss << " * Reason: sensor-ctx is null.\n";
-        ss << "}\n\n";
-        throw std::runtime_error(ss.str());
+        error = {Provider::ReadError::Reason::NO_CONTEXT, 0};
+        return false;
     }
 
-    Provider::Entity entity;
     uint8_t sharedOffset = 0; // TODO: shared sensors support
     uint8_t readingRaw = 0;
     double* reading = nullptr;
     uint16_t eventMask = 0;
-    const common::buffer<uint8_t, IPMI_SDR_MAX_RECORD_LENGTH> &data = record->get_record_data();
+    const common::bytes_view &data = record->get_record_data();
 
+    epicsTime start = epicsTime::getCurrent();
     int rv = ipmi_sensor_read(mSensorCtx, data.data, data.size, sharedOffset, &readingRaw, &reading, &eventMask);
+    if(wire)
+        wire->reading = epicsTime::getCurrent() - start;
     
     if(rv != 1)
     {
-
         int err_num = ipmi_sensor_read_ctx_errnum (mSensorCtx);
-        std::string str_error = ipmi_sensor_read_ctx_strerror (err_num);
-        std::string str_errmsg = ipmi_sensor_read_ctx_errormsg (mSensorCtx);
-
-        /** Not sure if ipmi_sensor_read_ctx_strerror() and ipmi_sensor_read_ctx_errormsg()
-         * always return the same messages.
-         * So, use Lambda to concat strings if they are different...
-         */
-        auto getErrStr = [&str_error, &str_errmsg]()
+
+        /**
+         * Trap possible session-timeouts and handle reconnections. 
+         * This is indicative of a session timeout/device disconnected.
+         * The actual error code/message returned from IPMI will be 16/'internal IPMI error'
+         * which isn't very descriptive. But if you dig deeper you find 'session timeout'.
+         * But sometimes you get read errors that are okay and so you do not want to
+         * disconnect. e.g., Error Code: '5', Error String: 'sensor reading unavailable'
+        */
+        if(err_num == 16)
         {
-            if(str_error.compare(str_errmsg) != 0)
-            {
-                return "\'" + str_error + "\' Error Message: \'" + str_errmsg + "\'";
-            }
-            else
-                return "\'" + str_error + "\'";
-        };
-        
-        throw IpmiException(err_num, std::move(getErrStr()));
+            mTimeouts++;
+            disconnect();
+            error = {Provider::ReadError::Reason::SESSION_TIMEOUT, err_num};
+        }
+        else
+        {
+            error = {Provider::ReadError::Reason::IPMI, err_num};
+        }
+        return false;
     }
     
     /** Only threshold type sensors return a reading-value. The rest of the sensor types
@@ -773,22 +835,45 @@ Provider::Entity IpmiConnectionManager::readSensor(const std::shared_ptr<IpmiSen
     {
         if(reading)
         {
-            entity["VAL"] = std::round(*reading * 100.0) / 100.0;
+            const double value = std::round(*reading * 100.0) / 100.0;
             free(reading);
-            getSensorThresholds(entity, record);
-            getSensorHysteresis(entity, record);
+            entity = getSensorLimits(record, wire);
+            entity.setField<Provider::Entity::VAL>(value);
         }
         else
-            entity["VAL"] = (double) eventMask;
+            entity.setField<Provider::Entity::VAL>((double) eventMask);
     }
     else
     {
-        entity["VAL"] = (double) eventMask;
+        entity.setField<Provider::Entity::VAL>((double) eventMask);
     }
+    entity.setField<Provider::Entity::STATE_MASK>(eventMask);
     
     updateIdleTime();
-    return entity;
+    return true;
+}
+
+Provider::Entity IpmiConnectionManager::getSensorLimits(const std::shared_ptr<IpmiSensorRecComp> record, Provider::WireTime* wire)
+{
+    const uint32_t key = (record->get_channel_number() << 24) | (record->get_sensor_owner_id() << 16) |
+                         (record->get_sensor_owner_lun() << 8) | record->get_sensor_number();
+    const epicsTime now = epicsTime::getCurrent();
 
+    auto itr = mLimitsCache.find(key);
+    if(itr != mLimitsCache.end() && now - itr->second.readTime < LIMITS_REFRESH_PERIOD)
+        return itr->second.limits;
+
+    Provider::Entity limits;
+    getSensorThresholds(limits, record);
+    const epicsTime thresholdsDone = epicsTime::getCurrent();
+    getSensorHysteresis(limits, record);
+    if(wire)
+    {
+        wire->thresholds = thresholdsDone - now;
+        wire->hysteresis = epicsTime::getCurrent() - thresholdsDone;
+    }
+    mLimitsCache[key] = {limits, now};
+    return limits;
 }
 
 void IpmiConnectionManager::getSensorThresholds(Provider::Entity &entity, const std::shared_ptr<IpmiSensorRecComp> record)
@@ -865,7 +950,7 @@ void IpmiConnectionManager::getSensorThresholds(Provider::Entity &entity, const
     * See Table 35- Get Sensor Thresholds
     * Just passing the bits back to EPICS in case we need them later.
     */
-    entity["THRESHOLDS_READABLE"] = thresh_readable;
+    entity.setField<Provider::Entity::THRESHOLDS_READABLE>(thresh_readable);
 
     /*
     * There are 6-thresholds in the ipmi standard:
@@ -903,7 +988,14 @@ void IpmiConnectionManager::getSensorThresholds(Provider::Entity &entity, const
                 dstr << std::fixed << std::setprecision(2) << record->scale_threshold(mSdrCtx, tval);
                 double d = 0;
                 dstr >> d;
-                entity[itr->second.c_str()] = d;
+                switch(itr->second)
+                {
+                    case Provider::Entity::LOLO: entity.setField<Provider::Entity::LOLO>(d); break;
+                    case Provider::Entity::LOW:  entity.setField<Provider::Entity::LOW>(d);  break;
+                    case Provider::Entity::HIGH: entity.setField<Provider::Entity::HIGH>(d); break;
+                    case Provider::Entity::HIHI: entity.setField<Provider::Entity::HIHI>(d); break;
+                    default: break;
+                }
             }
             catch(const std::exception& e)
             {
@@ -1000,7 +1092,7 @@ void IpmiConnectionManager::getSensorHysteresis(Provider::Entity &entity, const
                 dstr << std::fixed << std::setprecision(2) << record->scale_threshold(mSdrCtx, tval);
                 double d = 0;
                 dstr >> d;
-                entity["HYST"] = fabs(d);
+                entity.setField<Provider::Entity::HYST>(fabs(d));
             }
             catch(const std::exception& e)
             {
@@ -7,6 +7,7 @@
 #include <filesystem>
 #include <string>
 #include <cstdint>
+#include <atomic>
 #include <map>
 #include <list>
 #include <functional>
@@ -30,6 +31,12 @@ enum class ConnectionState {
 
 class IpmiConnectionManager
 {
+public:
+    /**
+     * @brief OEM command handler, throws Provider errors on failure.
+     */
+    typedef int (*OEM_HANDLER)(ipmi_ctx_t ctx, const std::vector<std::string> &args, Provider::Entity &value);
+
 private:
 
     const std::string mConnId;
@@ -57,17 +64,27 @@ private:
     bool mConnStatus{false};
     epicsTime mIdleTime;
     epicsTime mDisconnectTime;
+    double mConnectDuration{0.0};       //!< Seconds spent establishing the last session.
+    double mSdrCacheDuration{0.0};      //!< Seconds spent opening/downloading the last SDR cache.
+    std::atomic<unsigned> mSessions{0}; //!< Sessions established, first one included.
+    std::atomic<unsigned> mTimeouts{0}; //!< Sensor reads that found the session timed out.
     fiid_obj_t mSdrRepositoryInfoRq{nullptr};
     fiid_obj_t mSdrRepositoryInfoRs{nullptr};
     fiid_obj_t mGetSensorThresholdsRq{nullptr};
     fiid_obj_t mGetSensorThresholdsRs{nullptr};
     fiid_obj_t mGetSensorHysteresisRq{nullptr};
     fiid_obj_t mGetSensorHysteresisRs{nullptr};
-    ConnectionState mConnState{ConnectionState::DISCONNECTED};
-    static const std::map<std::string, std::string> mThresholdsMap;
+    std::atomic<ConnectionState> mConnState{ConnectionState::DISCONNECTED}; //!< Also read by statistics records.
+
+    struct CachedLimits {
+        Provider::Entity limits;        //!< Threshold and hysteresis fields only.
+        epicsTime readTime;
+    };
+    std::map<uint32_t, CachedLimits> mLimitsCache;  //!< By channel, owner id, LUN and sensor number, cleared on disconnect.
+    static const double LIMITS_REFRESH_PERIOD;
+    static const std::map<std::string, Provider::Entity::Field> mThresholdsMap;
     static const std::string mThresholdReadables [];
     static const std::string mSensorHysteresisValues [];
-    typedef int (*OEM_HANDLER)(ipmi_ctx_t ctx, const std::vector<std::string> &args, Provider::Entity &value);
     static std::map<std::list<std::string>, std::map<std::string, OEM_HANDLER>> oem_cmds;
     static std::map<std::string, uint8_t> VADATECH_SITE_TYPES;
     static const uint8_t VADATECH_IPMB_ADDRESS {0x82};
@@ -87,9 +104,9 @@ private:
     uint8_t initAuthtype(const std::string &authenticationtype, const std::string &username);
     uint8_t initPrivLevel(const std::string &privlegelevel);
 
-    Provider::Entity readSensor(const std::shared_ptr<IpmiSensorRecComp> record);
     void getSensorThresholds(Provider::Entity &entity, const std::shared_ptr<IpmiSensorRecComp> record);
     void getSensorHysteresis(Provider::Entity &entity, const std::shared_ptr<IpmiSensorRecComp> record);
+    Provider::Entity getSensorLimits(const std::shared_ptr<IpmiSensorRecComp> record, Provider::WireTime* wire);
     static int vadatech_reboot_chassis(ipmi_ctx_t ctx, const std::vector<std::string> &args, Provider::Entity &entity);
     static int vadatech_set_power_state(ipmi_ctx_t ctx, const std::vector<std::string> &args, Provider::Entity &entity);
     static int send_ipmi_cmd_raw_ipmb(ipmi_ctx_t ctx, uint8_t channel_number, uint8_t rs_addr,
@@ -108,12 +125,55 @@ public:
     ipmi_sdr_ctx_t getSdrCtx();
     const std::string &getConnectionId() const;
     const std::string &getHostname() const;
+    fs::path getLedCacheFile() const;
     void process();
+
+    /**
+     * @brief Close the session on IOC exit, frees the session slot on the BMC.
+     */
+    void close();
     bool isConnected();
+    ConnectionState getConnectionState() const;
+    bool isReconnectDue();
+    double getConnectDuration() const;
+    double getSdrCacheDuration() const;
+
+    /**
+     * @brief Number of times the session was re-established after the first connect.
+     */
+    unsigned getReconnectCount() const;
+
+    /**
+     * @brief Number of sensor reads that failed on session timeout.
+     */
+    unsigned getTimeoutCount() const;
 
     Provider::Entity getSensorReading(const std::shared_ptr<IpmiSensorRecComp> record);
-    ///void write_oem_command(const std::string &connectionId, const std::string vendorId, const std::string command);
-    void write_oem_command(const std::shared_ptr<EntityAddrType> entAddrType, Provider::Entity &entity);
+
+    /**
+     * @brief Read sensor without throwing on read failures, for the polling path.
+     *
+     * Only fetching thresholds of a sensor that was just read may throw.
+     * @param entity empty entity, filled only on success
+     * @param wire when given, receives time spent in each IPMI command
+     * @return false and the reason in error when sensor couldn't be read
+     */
+    bool tryReadSensor(const std::shared_ptr<IpmiSensorRecComp> record, Provider::Entity &entity, Provider::ReadError &error,
+                       Provider::WireTime* wire=nullptr);
+
+    /**
+     * @brief Describe failed read of a sensor, only when it gets logged.
+     */
+    std::string formatReadError(const IpmiSensorRecComp &record, const Provider::ReadError &error) const;
+    /**
+     * @brief Return handler for vendor name or alias and command, nullptr when not supported.
+     */
+    static OEM_HANDLER findOemHandler(const std::string &vendor_id, const std::string &command);
+
+    /**
+     * @brief Run OEM command handler resolved with findOemHandler.
+     */
+    void write_oem_command(OEM_HANDLER handler, const std::vector<std::string> &args, Provider::Entity &entity);
     static bool is_valid_oem_command(const std::string &vendor_id, const std::string &command);
     
     IpmiSdrInfo getSdrInfo();
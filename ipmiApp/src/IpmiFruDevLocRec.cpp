@@ -13,6 +13,20 @@
 #define IPMI_NET_FN_PICMG_RQ IPMI_NET_FN_GROUP_EXTENSION_RQ
 #define IPMI_NET_FN_PICMG_RS IPMI_NET_FN_GROUP_EXTENSION_RS
 
+/** Command failed because of the FRU rather than the session to the shelf manager. */
+static void throwCmdError(ipmi_ctx_t ipmi, const std::string &what)
+{
+    switch (ipmi_ctx_errnum(ipmi)) {
+    case IPMI_ERR_MESSAGE_TIMEOUT:
+    case IPMI_ERR_BAD_COMPLETION_CODE:
+    case IPMI_ERR_BAD_COMPLETION_CODE_INVALID_COMMAND:
+    case IPMI_ERR_BAD_COMPLETION_CODE_REQUEST_DATA_INVALID:
+        throw IpmiFruDevLocRec::led_error(what + " - " + ipmi_ctx_errormsg(ipmi));
+    default:
+        throw std::runtime_error(what + " - " + ipmi_ctx_errormsg(ipmi));
+    }
+}
+
 enum {
     PICMG_GET_PICMG_PROPERTIES_CMD             = 0x00,
     PICMG_GET_ADDRESS_INFO_CMD                 = 0x01,
@@ -40,57 +54,36 @@ enum {
     PICMG_BUSED_RESOURCE_CMD                   = 0x17,
 };
 
-/**
- * When calling the two funcions below on the VadaTech equipment with the FRU names
- * in the exclusion list, they will throw errors. Their errors are not bad because
- * we are looking for LEDs on FRUs and the FRUs in the list are not physical hardware
- * with LEDs. And the one named "TELCO ALARM" will actually not return an error
- * right away but will instead timeout which hangs the process for a few seconds
- * and this is annoying to watch during IOC startup. So, this is just a way for now to
- * silence the errors on startup so the IOC engineer doesn't think there is a problem
- * When they see the boot process hang and display errors about bad completion codes.
- * 
- * I can't find another way to exclude asking these guys if they have LEDs as of yet.
- * And what I mean is that I cannot see a way in software to distinguish between a
- * physical FRU device (e.g., AMC523) that has LEDs and a software FRU device 
- * (e.g., TELCO ALARM) that does not have LEDs.
- * 
- * (1) ipmi_cmd(ipmi, IPMI_BMC_IPMB_LUN_BMC, IPMI_NET_FN_PICMG_RQ, obj_cmd_rq, obj_cmd_rs);
- * (2) ipmi_ctx_set_target(ipmi, &this->channel_number, &deviceAddr);
- * 
-*/
-const std::vector<std::string> IpmiFruDevLocRec::picmgLedExclusionList = {
-    "SHELF FRU INFO",
-    "UTCA CARRIER",
-    "SH FRU DEV1",
-    "SH FRU DEV2",
-    "MCH DA INFO",
-    "BMC FRU",
-    "TELCO ALARM"
-};
+IpmiFruDevLocRec::IpmiFruDevLocRec(ipmi_sdr_ctx_t sdr, uint16_t recid, uint8_t rectype)
+    :IpmiSdrRec(recid, rectype)
+{
+    read_record_data(sdr);
+    parse(sdr);
+}
 
-bool IpmiFruDevLocRec::isInExclusionList(const std::string &name) {
-    for(auto &exName : picmgLedExclusionList) {
-        if(name == exName) {return true;};
-    }
-    return false;
+IpmiFruDevLocRec::IpmiFruDevLocRec(ipmi_sdr_ctx_t sdr, uint16_t recid, uint8_t rectype, const common::bytes_view &data)
+    :IpmiSdrRec(recid, rectype, data)
+{
+    parse(sdr);
 }
 
-IpmiFruDevLocRec::IpmiFruDevLocRec(ipmi_ctx_t ipmi, ipmi_sdr_ctx_t sdr, uint16_t recid, uint8_t rectype)
-    :IpmiSdrRec(recid, rectype)
+void IpmiFruDevLocRec::parse(ipmi_sdr_ctx_t sdr)
 {
-    if(rectype != IPMI_SDR_FORMAT_FRU_DEVICE_LOCATOR_RECORD) {
+    if(this->record_type != IPMI_SDR_FORMAT_FRU_DEVICE_LOCATOR_RECORD) {
 	std::stringstream ss;
 	ss << "ERROR: Invalid record type passed to FruDevLocatorRec::FruDevLocatorRec()." <<
 	     "Expected \'" << sdr_type_itos_map[IPMI_SDR_FORMAT_FRU_DEVICE_LOCATOR_RECORD] <<
-	     "\' but received \'" << sdr_type_itos_map[rectype] << "\'" << std::endl;
+	     "\' but received \'" << sdr_type_itos_map[this->record_type] << "\'" << std::endl;
         throw std::invalid_argument(ss.str());
     }
 
+    const void *data = this->record_data.data;
+    const unsigned int size = this->record_data.size;
+
     int rv = (-1);
-    rv = ipmi_sdr_parse_fru_entity_id_and_instance (sdr, NULL, 0, &this->fru_entity_id, &this->fru_entity_instance);
+    rv = ipmi_sdr_parse_fru_entity_id_and_instance (sdr, data, size, &this->fru_entity_id, &this->fru_entity_instance);
 
-    rv = ipmi_sdr_parse_fru_device_locator_parameters (sdr, NULL, 0,
+    rv = ipmi_sdr_parse_fru_device_locator_parameters (sdr, data, size,
                     &this->device_access_address,
                     &this->logical_fru_device_device_slave_address,
                     &this->private_bus_id,
@@ -99,25 +92,10 @@ IpmiFruDevLocRec::IpmiFruDevLocRec(ipmi_ctx_t ipmi, ipmi_sdr_ctx_t sdr, uint16_t
                     &this->channel_number);
 
     char id_str[IPMI_SDR_MAX_SENSOR_NAME_LENGTH] = {'\0'};
-    rv = ipmi_sdr_parse_device_id_string (sdr, NULL, 0, &id_str[0], IPMI_SDR_MAX_SENSOR_NAME_LENGTH);
+    rv = ipmi_sdr_parse_device_id_string (sdr, data, size, &id_str[0], IPMI_SDR_MAX_SENSOR_NAME_LENGTH);
     this->device_id_string = id_str;
 
-    /** Does this FRU device have LEDs? */
-    try
-    {
-        if(! isInExclusionList(this->device_id_string)) {
-            getPicmgStatusLeds(ipmi);
-        }
-    }
-    catch(const std::exception& e)
-    {
-        std::cerr << this->device_id_string << " [" << (unsigned) this->logical_fru_device_device_slave_address
-        << "] " << e.what() << '\n';
-        if (ipmi_ctx_set_target(ipmi, NULL, NULL) < 0) {
-            std::cerr << "Failed to reset target IPMI address - " << std::string(ipmi_ctx_errormsg(ipmi));
-        }
-    }
-
+    /** LEDs are discovered separately, probing can take seconds per FRU. */
 }
 
 IpmiFruDevLocRec::~IpmiFruDevLocRec()
@@ -229,17 +207,17 @@ std::string getLedColorsReqRsp(ipmi_ctx_t ipmi, uint8_t _logical_fru_device_devi
 
     int ret = ipmi_cmd(ipmi, IPMI_BMC_IPMB_LUN_BMC, IPMI_NET_FN_PICMG_RQ, obj_cmd_rq, obj_cmd_rs);
     if (ret < 0)
-        throw std::runtime_error("failed to request PICMG LED capabilities");
+        throwCmdError(ipmi, "failed to request PICMG LED capabilities");
 
     uint64_t compCode;
     if (fiid_obj_get(obj_cmd_rs, "comp_code", &compCode) < 0)
-        throw std::runtime_error("failed to decode PICMG LED capabilities response");
+        throw IpmiFruDevLocRec::led_error("failed to decode PICMG LED capabilities response");
     if (compCode != 0)
-        throw std::runtime_error("failed to decode PICMG LED capabilities response, invalid comp_code");
+        throw IpmiFruDevLocRec::led_error("failed to decode PICMG LED capabilities response, invalid comp_code");
 
     uint64_t val;
     if (fiid_obj_get(obj_cmd_rs, "colors", &val) < 0)
-        throw std::runtime_error("failed to decode PICMG LED capabilities response");
+        throw IpmiFruDevLocRec::led_error("failed to decode PICMG LED capabilities response");
     ///val |= 0x1; // Force 'off' color to be part of the options
 
     static const std::vector<std::string> colors = {
@@ -257,7 +235,9 @@ std::string getLedColorsReqRsp(ipmi_ctx_t ipmi, uint8_t _logical_fru_device_devi
 
 }
 
-void IpmiFruDevLocRec::getPicmgStatusLeds(ipmi_ctx_t ipmi) {
+std::vector<std::shared_ptr<PicmgLed>> IpmiFruDevLocRec::discoverStatusLeds(ipmi_ctx_t ipmi) {
+
+    std::vector<std::shared_ptr<PicmgLed>> leds;
 
     auto [obj_cmd_rq, obj_cmd_rs] = getLedPropReqRsp(this->logical_fru_device_device_slave_address);
     
@@ -268,44 +248,60 @@ void IpmiFruDevLocRec::getPicmgStatusLeds(ipmi_ctx_t ipmi) {
         throw std::runtime_error("Failed to set target IPMI address - " + std::string(ipmi_ctx_errormsg(ipmi)));
     }
 
-    int ret = ipmi_cmd(ipmi, IPMI_BMC_IPMB_LUN_BMC, IPMI_NET_FN_PICMG_RQ, obj_cmd_rq, obj_cmd_rs);
-    if (ret < 0) {
-        throw std::runtime_error("ERROR! IPMI command returned a failure code for object command req/rsp: " + 
-        std::string(ipmi_ctx_errormsg(ipmi)));
-    }
-    
-    /** Completion code. 00h is good.*/
-    uint64_t compCode;
-    if (fiid_obj_get(obj_cmd_rs, "comp_code", &compCode) < 0)
-        throw std::runtime_error("Failed to get object \'comp_code\' from response for PICMG LED properties");
-    if (compCode != 0)
-        throw std::runtime_error("ERROR! Unsuccessfull completion code \'" + std::to_string(compCode) + "\' "
-        "returned for get \'comp_code\' command response for PICMG LED properties");
-
-    uint64_t statusLeds;
-    uint64_t appLeds;
-    if (fiid_obj_get(obj_cmd_rs, "status_leds", &statusLeds) < 0)
-        throw std::runtime_error("Failed to get object \'status_leds\' from response for PICMG LED properties");
-    if (fiid_obj_get(obj_cmd_rs, "app_leds", &appLeds) < 0)
-        throw std::runtime_error("Failed to get object \'app_leds\' from response for PICMG LED properties");
-
-    /** If we have LEDs then get the led colors*/
-    if(statusLeds) {
+    try {
+        int ret = ipmi_cmd(ipmi, IPMI_BMC_IPMB_LUN_BMC, IPMI_NET_FN_PICMG_RQ, obj_cmd_rq, obj_cmd_rs);
+        if (ret < 0) {
+            throwCmdError(ipmi, "ERROR! IPMI command returned a failure code for object command req/rsp");
+        }
+        
+        /** Completion code. 00h is good.*/
+        uint64_t compCode;
+        if (fiid_obj_get(obj_cmd_rs, "comp_code", &compCode) < 0)
+            throw led_error("Failed to get object \'comp_code\' from response for PICMG LED properties");
+        if (compCode != 0)
+            throw led_error("ERROR! Unsuccessfull completion code \'" + std::to_string(compCode) + "\' "
+            "returned for get \'comp_code\' command response for PICMG LED properties");
+
+        uint64_t statusLeds;
+        uint64_t appLeds;
+        if (fiid_obj_get(obj_cmd_rs, "status_leds", &statusLeds) < 0)
+            throw led_error("Failed to get object \'status_leds\' from response for PICMG LED properties");
+        if (fiid_obj_get(obj_cmd_rs, "app_leds", &appLeds) < 0)
+            throw led_error("Failed to get object \'app_leds\' from response for PICMG LED properties");
+
+        /** If we have LEDs then get the led colors*/
         for(int i=0; i<4; i++) {
             if(statusLeds & (1 << i)) {
                 std::string color = getLedColorsReqRsp(ipmi, this->logical_fru_device_device_slave_address, i);
-                this->m_StatusLeds.push_back(std::make_shared<PicmgLed>(this->device_access_address,
+                leds.push_back(std::make_shared<PicmgLed>(this->device_access_address,
                 this->channel_number, this->logical_fru_device_device_slave_address, i, color));
             }
         }
+    } catch (...) {
+        fiid_obj_destroy(obj_cmd_rq);
+        fiid_obj_destroy(obj_cmd_rs);
+        ipmi_ctx_set_target(ipmi, NULL, NULL);
+        throw;
     }
 
-    /** Do this last maybe? 
-     * Reset the target address back to null */
+    fiid_obj_destroy(obj_cmd_rq);
+    fiid_obj_destroy(obj_cmd_rs);
+
+    /** Reset the target address back to null */
     if (ipmi_ctx_set_target(ipmi, NULL, NULL) < 0) {
             throw std::runtime_error("Failed to reset target IPMI address - " + std::string(ipmi_ctx_errormsg(ipmi)));
     }
 
+    return leds;
+}
+
+void IpmiFruDevLocRec::addStatusLed(uint8_t led_id, const std::string &color) {
+    this->m_StatusLeds.push_back(std::make_shared<PicmgLed>(this->device_access_address,
+        this->channel_number, this->logical_fru_device_device_slave_address, led_id, color));
+}
+
+std::string IpmiFruDevLocRec::getLedCacheKey() const {
+    return std::to_string(this->device_access_address) + ":" + std::to_string(this->logical_fru_device_device_slave_address);
 }
 
 
@@ -378,6 +374,14 @@ uint8_t IpmiFruDevLocRec::get_channel_number() const {
     return this->channel_number;
 }
 
+uint8_t IpmiFruDevLocRec::get_fru_entity_id() const {
+    return this->fru_entity_id;
+}
+
+uint8_t IpmiFruDevLocRec::get_fru_entity_instance() const {
+    return this->fru_entity_instance;
+}
+
 uint8_t IpmiFruDevLocRec::get_logical_physical_fru_device() const {
     return this->logical_physical_fru_device;
 }
@@ -12,6 +12,7 @@
 #include "IpmiSensorRecFull.h"
 #include <vector>
 #include <memory>
+#include <stdexcept>
 #include <typeinfo>
 #include "PicmgLed.h"
 
@@ -26,14 +27,22 @@ private:
     uint8_t channel_number;
     uint8_t fru_entity_id;
     uint8_t fru_entity_instance;
-    void IpmiFruDevLocRec::getPicmgStatusLeds(ipmi_ctx_t ipmi);
     std::vector<std::shared_ptr<IpmiSensorRecComp>> sensor_records;
     std::vector<std::shared_ptr<PicmgLed>> m_StatusLeds;
-    static const std::vector<std::string> picmgLedExclusionList;
-    static bool isInExclusionList(const std::string &name);
+
+    void parse(ipmi_sdr_ctx_t sdr);
 
 public:
-    IpmiFruDevLocRec(ipmi_ctx_t ipmi, ipmi_sdr_ctx_t sdr, uint16_t recid, uint8_t rectype);
+    /**
+     * @brief The FRU itself rejected or didn't answer the LED query, asking again won't help.
+     */
+    struct led_error : public std::runtime_error {
+        using std::runtime_error::runtime_error;
+    };
+
+    IpmiFruDevLocRec(ipmi_sdr_ctx_t sdr, uint16_t recid, uint8_t rectype);
+    IpmiFruDevLocRec(ipmi_sdr_ctx_t sdr, uint16_t recid, uint8_t rectype, const common::bytes_view &data);
+    IpmiFruDevLocRec(IpmiFruDevLocRec&&) = default;
     ~IpmiFruDevLocRec();
     std::string report();
     template<typename T>
@@ -42,11 +51,35 @@ public:
     uint8_t get_device_slave_address();
     uint8_t get_logical_physical_fru_device() const;
     uint8_t get_channel_number() const;
+    uint8_t get_fru_entity_id() const;
+    uint8_t get_fru_entity_instance() const;
     std::shared_ptr<IpmiSensorRecComp> get_sensor_by_sensor_number(uint8_t number) const;
     std::shared_ptr<IpmiSensorRecComp> get_sensor_by_sensor_id_string(const std::string &) const;
     std::vector<std::shared_ptr<IpmiSensorRecComp>> &get_sensors();
     std::vector<std::shared_ptr<PicmgLed>> getStatusLeds();
     std::shared_ptr<PicmgLed> getStatusLedById(uint8_t led_id);
+
+    /**
+     * @brief Ask the FRU which PICMG status LEDs it has and what colors they support.
+     * @param ipmi context to send commands through, target is reset before returning
+     * @return discovered LEDs, not yet attached to this FRU
+     * @exception led_error on bad completion code, malformed response or target timeout
+     * @exception std::runtime_error on any other communication failure
+     *
+     * Non-physical FRUs may not respond until the command times out,
+     * callers should remember led_error failures rather than retry.
+     */
+    std::vector<std::shared_ptr<PicmgLed>> discoverStatusLeds(ipmi_ctx_t ipmi);
+
+    /**
+     * @brief Attach previously discovered LED to this FRU.
+     */
+    void addStatusLed(uint8_t led_id, const std::string &color);
+
+    /**
+     * @brief Key uniquely identifying this FRU within the SDR, "<access address>:<FRU id>".
+     */
+    std::string getLedCacheKey() const;
     
 };
 
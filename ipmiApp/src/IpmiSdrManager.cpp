@@ -6,56 +6,39 @@
 */
 
 #include "IpmiSdrManager.h"
+#include "BootProfiler.h"
 #include "common.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
 #include <sstream>
 #include "IpmiSdrInfo.h"
 
+/** First SDR load retry delay doubles from min to max seconds, max matches the reconnect period. */
+static const double SDR_LOAD_RETRY_MIN = 1.0;
+static const double SDR_LOAD_RETRY_MAX = 60.0;
+
+/** LED probes share the provider thread with reads, a FRU that doesn't answer blocks it
+ *  for a whole timeout. Probes are at least this many seconds apart, and after a slow
+ *  one the thread waits long enough for probing to take at most LED_PROBE_SHARE of it. */
+static const double LED_PROBE_PERIOD = 1.0;
+static const double LED_PROBE_SHARE = 0.1;
+
 IpmiSdrManager::IpmiSdrManager(IpmiConnectionManager &cmngr)
 : mConnMgr(cmngr)
 {
-    try
-    {
-        readSdr();
-    }
-    catch(const std::exception &e)
-    {
-        mMutex.unlock();
-        LOG_ERROR(e.what());
-    }
-    
+    /** The SDR is read from the provider thread once the connection is up, see process().*/
 }
 
 IpmiSdrManager::~IpmiSdrManager() {
     
 }
 
-void IpmiSdrManager::clearMaps() {
-
-    if(mSensRecFullList.size() > 0)
-        mSensRecFullList.clear();
-
-    if(mSensRecCompactList.size() > 0)
-        mSensRecCompactList.clear();
-
-    if(mFruDevLocRecList.size() > 0)
-        mFruDevLocRecList.clear();
-
-    if(mOrphandList.size() > 0)
-        mOrphandList.clear();
-
-    if(mSidEntityMap.size() > 0)
-        mSidEntityMap.clear();
-
-    if(mSensToFruMap.size() > 0)
-        mSensToFruMap.clear();
-
-}
-
 void IpmiSdrManager::readSdr() {
 
-    mMutex.lock();
-
+    /** Failed reads are profiled too, the timer counts them when an exception leaves. */
+    BootProfiler::Timer profile(mConnMgr.getConnectionId(), "", "sdr parse");
     ipmi_sdr_ctx_t sdr = mConnMgr.getSdrCtx();
 
     /* Get the SDR version. */
@@ -74,40 +57,158 @@ void IpmiSdrManager::readSdr() {
     if(ipmi_sdr_cache_record_count (sdr, &mRecordCount) < 0)
         throw std::runtime_error("Error! Could not read SDR cache record count.");
 
-    /** This is needed after initialization and we need to rebuild/re read the SDR*/
-    clearMaps();
+    /** Build the new repository aside, lookups keep using the old one until swapped. */
+    std::shared_ptr<IpmiSdrRepository> repository;
+    epicsTime start = epicsTime::getCurrent();
+    try {
+        repository = std::make_shared<IpmiSdrRepository>(sdr, mRecordCount);
+    } catch(const std::exception& e) {
+        throw std::runtime_error("Can't parse SDR for connection id: \'" + mConnMgr.getConnectionId() + "\' - " + e.what());
+    }
+    double parseTime = epicsTime::getCurrent() - start;
+
+    LOG_INFO("Parsed %u SDR records for \'%s\': %zu sensors, %zu FRUs, %zu orphans, %zu bytes in %.3f s",
+             (unsigned) mRecordCount, mConnMgr.getConnectionId().c_str(), repository->getSensorCount(),
+             repository->getFruCount(), repository->getOrphanCount(), repository->getMemoryUsage(), parseTime);
 
-    uint16_t record_id = 0;
-    uint8_t record_type = 0;
+    common::ScopedLock lock(mMutex);
+    mRepository = repository;
+    loadLedCache();
 
-    /* Iterate through all of the records in the SDR and create sensor lists as needed. */
-    for(int i = 0; i < mRecordCount; i++, ipmi_sdr_cache_next(sdr)) {
-        if(ipmi_sdr_parse_record_id_and_type (sdr, nullptr, 0, &record_id, &record_type)<0)
-            throw std::runtime_error("Could not read record ID and record type in SDR.");
+    mReadTime = epicsTime::getCurrent();
+    mSdrState = SDRSTATE::INITIALIZED;
+    mGeneration++;
+    profile.done();
+}
 
-        /* Add this record type to the list. When constructor is called we read more sensor data */
-        insertRecord(sdr, record_id, record_type);
+void IpmiSdrManager::loadLedCache() {
+
+    mLedCache.clear();
+    mLedProbeQueue.clear();
+
+    /** Header must match the SDR we just read, otherwise FRUs might have changed. */
+    std::ifstream file(mConnMgr.getLedCacheFile());
+    std::string line;
+    if(file.is_open() && std::getline(file, line)) {
+        std::istringstream header(line);
+        std::string tag;
+        uint32_t addTs = 0, eraseTs = 0;
+        header >> tag >> addTs >> eraseTs;
+        if(tag == "sdr" && addTs == mAdditionTimestamp && eraseTs == mEraseTimestamp) {
+            while(std::getline(file, line)) {
+                auto pos = line.find(' ');
+                if(pos != std::string::npos)
+                    mLedCache[line.substr(0, pos)] = line.substr(pos + 1);
+            }
+        }
     }
 
-    std::copy(mSensRecFullList.begin(), mSensRecFullList.end(), std::back_inserter(mOrphandList));
-    std::copy(mSensRecCompactList.begin(), mSensRecCompactList.end(), std::back_inserter(mOrphandList));
+    for(size_t i = 0; i < mRepository->getFruCount(); i++) {
+        auto fru = mRepository->getFru(i);
+        auto it = mLedCache.find(fru->getLedCacheKey());
+        if(it == mLedCache.end())
+            mLedProbeQueue.push_back(fru);
+        else
+            applyLeds(fru, it->second);
+    }
+}
+
+void IpmiSdrManager::saveLedCache() {
+
+    std::ofstream file(mConnMgr.getLedCacheFile(), std::ios::trunc);
+    if(!file.is_open()) {
+        LOG_WARN("Can't write LED cache file \'" + mConnMgr.getLedCacheFile().string() + "\'");
+        return;
+    }
+    file << "sdr " << mAdditionTimestamp << " " << mEraseTimestamp << "\n";
+    for(auto &entry : mLedCache)
+        file << entry.first << " " << entry.second << "\n";
+}
+
+void IpmiSdrManager::applyLeds(std::shared_ptr<IpmiFruDevLocRec> fru, const std::string &leds) {
+
+    if(leds == "none" || leds == "failed")
+        return;
+
+    std::istringstream ss(leds);
+    std::string led;
+    while(ss >> led) {
+        auto pos = led.find('=');
+        if(pos == std::string::npos)
+            continue;
+        fru->addStatusLed(std::stoi(led.substr(0, pos)), led.substr(pos + 1));
+    }
+}
+
+bool IpmiSdrManager::discoverNextLeds() {
+
+    if(epicsTime::getCurrent() < mNextLedProbe)
+        return false;
 
-    /* Iterate through all of the FRU Device Locator Records and attach sensors to their parent FRUs */
-    for(auto &fdlr: mFruDevLocRecList) {
-        fdlr.get()->parseAssociations(mOrphandList);
+    std::shared_ptr<IpmiFruDevLocRec> fru;
+    {
+        common::ScopedLock lock(mMutex);
+        if(mLedProbeQueue.empty())
+            return false;
+        fru = mLedProbeQueue.back();
+        mLedProbeQueue.pop_back();
     }
 
-    /* Create a reverse lookup map so the sensor can find its parent FRU. */
-    for(auto &fdlr : mFruDevLocRecList) {
-        std::vector<std::shared_ptr<IpmiSensorRecComp>> &sensrs = fdlr.get()->get_sensors();
-        for(auto &sensr : sensrs) {
-            mSensToFruMap.insert({sensr, fdlr.get()->get_device_slave_address()});
+    epicsTime start = epicsTime::getCurrent();
+    bool attached = probeLeds(fru);
+    epicsTime end = epicsTime::getCurrent();
+    mNextLedProbe = end + std::max(LED_PROBE_PERIOD, (end - start) * (1.0 / LED_PROBE_SHARE - 1.0));
+    return attached;
+}
+
+bool IpmiSdrManager::probeLeds(std::shared_ptr<IpmiFruDevLocRec> fru) {
+
+    /** Talk to the device without holding the lock, may take until timeout. */
+    std::string result;
+    std::vector<std::shared_ptr<PicmgLed>> leds;
+    BootProfiler::Timer probe(mConnMgr.getConnectionId(), fru->get_device_id_string(), "led probe");
+    try {
+        leds = fru->discoverStatusLeds(mConnMgr.getIpmiCtx());
+        probe.done();
+        for(auto &led : leds)
+            result += (result.empty() ? "" : " ") + std::to_string(led->getLedId()) + "=" + led->getLedColor();
+        if(result.empty())
+            result = "none";
+    } catch(const IpmiFruDevLocRec::led_error& e) {
+        if(!mConnMgr.isConnected()) {
+            requeueLedProbe(fru);
+            return false;
         }
+        LOG_DEBUG("FRU \'" + fru->get_device_id_string() + "\' on \'" + mConnMgr.getConnectionId() +
+                  "\' has no LEDs, won't probe again - " + e.what());
+        result = "failed";
+    } catch(const std::exception& e) {
+        /** Session or transport problem says nothing about the FRU, probe it again later. */
+        LOG_DEBUG("FRU \'" + fru->get_device_id_string() + "\' on \'" + mConnMgr.getConnectionId() +
+                  "\' LED probe interrupted, will retry - " + e.what());
+        requeueLedProbe(fru);
+        return false;
     }
 
-    mReadTime = epicsTime::getCurrent();
-    mMutex.unlock();
-    mSdrState = SDRSTATE::INITIALIZED;
+    common::ScopedLock lock(mMutex);
+    mLedCache[fru->getLedCacheKey()] = result;
+    saveLedCache();
+    applyLeds(fru, result);
+    if(leds.empty())
+        return false;
+    /** Let records waiting for this LED bind. */
+    mGeneration++;
+    return true;
+}
+
+void IpmiSdrManager::requeueLedProbe(std::shared_ptr<IpmiFruDevLocRec> fru) {
+
+    common::ScopedLock lock(mMutex);
+    /** SDR may have been re-read meanwhile, its own FRUs are queued already. */
+    if(fru.owner_before(mRepository) || mRepository.owner_before(fru))
+        return;
+    /** Others are probed first, queue is consumed from the back. */
+    mLedProbeQueue.insert(mLedProbeQueue.begin(), fru);
 }
 
 int IpmiSdrManager::compSdrHeader()
@@ -146,75 +247,25 @@ int IpmiSdrManager::compSdrHeader()
     return rval;
 }
 
-void IpmiSdrManager::insertRecord(ipmi_sdr_ctx_t psdr, uint16_t record_id, uint8_t record_type) {
-
-    if(record_type == IPMI_SDR_FORMAT_FULL_SENSOR_RECORD) {
-        std::shared_ptr<IpmiSensorRecFull> p;
-
-        /** Add sensor to list */
-        p = std::make_shared<IpmiSensorRecFull>(psdr, record_id, record_type);
-        mSensRecFullList.push_back(p);
-
-        /** Add sensor to map with entity-id:entity-instance:sensor-number as key */
-        insertIntoEntityMap(p);
-    }
-
-    /* Add this record type to the list. Compact and Full are so close to the same.
-    * When constructor is called we read more sensor data
-    */
-    if(record_type == IPMI_SDR_FORMAT_COMPACT_SENSOR_RECORD) {
-        std::shared_ptr<IpmiSensorRecComp> p;
-
-        /** Add sensor to list */
-        p = std::make_shared<IpmiSensorRecComp>(psdr, record_id, record_type);
-        mSensRecCompactList.push_back(p);
-
-        /** Add sensor to map with entity-id:entity-instance:sensor-number as key */
-        insertIntoEntityMap(p);
-    }
-
-    if(record_type == IPMI_SDR_FORMAT_EVENT_ONLY_RECORD) {
-        ///TODO:
-        ;
-    }
-
-    if(record_type == IPMI_SDR_FORMAT_DEVICE_RELATIVE_ENTITY_ASSOCIATION_RECORD) {
-        ///TODO:
-        ;
-    }
-
-    /* Add this record type to the list. This record type is useful for grouping sensor based on
-        * FRU to sensor relationships. 
-        */
-    if(record_type == IPMI_SDR_FORMAT_FRU_DEVICE_LOCATOR_RECORD) {
-        mFruDevLocRecList.push_back(std::make_shared<IpmiFruDevLocRec>(mConnMgr.getIpmiCtx(), psdr, record_id, record_type));
-    }
-
-    if(record_type == IPMI_SDR_FORMAT_MANAGEMENT_CONTROLLER_DEVICE_LOCATOR_RECORD) {
-        ///TODO:
-        ;
-    }
-}
-
-void IpmiSdrManager::insertIntoEntityMap(std::shared_ptr<IpmiSensorRecComp> prec) {
-
-    /** Add sensor to map with entity-id:entity-instance:sensor-number as key */
-    std::pair<std::map<std::string, std::shared_ptr<IpmiSensorRecComp>>::iterator,bool> rv;
-
-    /** Create the key */
-    std::string sidKey = std::to_string(prec->get_entity_id()) + ":" + 
-    std::to_string(prec->get_entity_instance()) + ":" + prec->get_device_id_string();
+void IpmiSdrManager::process() {
 
-    rv = mSidEntityMap.insert({sidKey, prec});
-    if(rv.second == false) {
-        
-        throw std::runtime_error("Cannot insert SDR record into map for connection id: \'" + mConnMgr.getConnectionId() + "\'. Duplicate Keys Exists: " + sidKey);
+    /** Nothing to compare against until the SDR has been read once.*/
+    if(mSdrState == SDRSTATE::UNINITIALIZED)
+    {
+        if(!isLoadDue())
+            return;
+        try {
+            readSdr();
+            mLoadRetryDelay = 0.0;
+        } catch(...) {
+            /** Bad SDR cache fails the same way every time, back off like reconnect does. */
+            mLoadRetryDelay = std::min(std::max(mLoadRetryDelay * 2, SDR_LOAD_RETRY_MIN), SDR_LOAD_RETRY_MAX);
+            mReadTime = epicsTime::getCurrent();
+            throw;
+        }
+        return;
     }
 
-}
-
-void IpmiSdrManager::process() {
-
     /**
      * SDR could change in two places: (cache file or device)
     */
@@ -277,7 +328,6 @@ void IpmiSdrManager::process() {
                 }
                 catch(const std::exception& e)
                 {
-                    mMutex.unlock();
                     LOG_ERROR("Could not read SDR cache after rebuild for \'" + mConnMgr.getConnectionId() + "\' @ \'"
                     + mConnMgr.getHostname() + "\' - " + e.what() + "\n");
                 }
@@ -293,32 +343,51 @@ void IpmiSdrManager::process() {
 
 std::shared_ptr<IpmiFruDevLocRec> IpmiSdrManager::getFruByDeviceSlaveAddress(const uint8_t slave_address) {
 
-    std::shared_ptr<IpmiFruDevLocRec> pfru = nullptr;
-
-    mMutex.lock();
-    for(auto &fru : mFruDevLocRecList) {
-        if(fru->get_device_slave_address() == slave_address) {
-            pfru = fru;
-            break;
-        }
-    }
-    mMutex.unlock();
-    return pfru;
+    common::ScopedLock lock(mMutex);
+    if(!mRepository)
+        return nullptr;
+    return mRepository->getFruByDeviceSlaveAddress(slave_address);
 }
 
 std::shared_ptr<IpmiSensorRecComp> IpmiSdrManager::findSensorByMapKey(std::string key) {
 
-    std::map<std::string, std::shared_ptr<IpmiSensorRecComp>>::iterator itr;
-    std::shared_ptr<IpmiSensorRecComp> pSens = nullptr;
+    common::ScopedLock lock(mMutex);
+    if(!mRepository)
+        return nullptr;
+    return mRepository->findSensorByMapKey(key);
+}
+
+std::vector<std::shared_ptr<IpmiSensorRecComp>> IpmiSdrManager::findFruSensors(const std::string &fru_key) {
 
-    mMutex.lock();
-    itr = mSidEntityMap.find(key);
-    if(itr != mSidEntityMap.end()) {
-        pSens = itr->second;
-    }
+    common::ScopedLock lock(mMutex);
+    if(!mRepository)
+        return {};
+    if(fru_key.empty())
+        return mRepository->getSensors();
+
+    unsigned entity_id = 0, entity_instance = 0;
+    if(sscanf(fru_key.c_str(), "%u:%u", &entity_id, &entity_instance) != 2)
+        return {};
+    return mRepository->findFruSensors(entity_id & 0xFF, entity_instance & 0xFF);
+}
+
+std::string IpmiSdrManager::findSensorKeyByEventSource(uint8_t generator_id, uint8_t sensor_number) {
+
+    common::ScopedLock lock(mMutex);
+    if(!mRepository)
+        return "";
+    return mRepository->findSensorKeyByEventSource(generator_id, sensor_number);
+}
+
+std::shared_ptr<PicmgLed> IpmiSdrManager::getPicmgLed(const uint8_t slave_address, const uint8_t led_id) {
 
-    mMutex.unlock();
-    return pSens;
+    common::ScopedLock lock(mMutex);
+    if(!mRepository)
+        return nullptr;
+    auto fru = mRepository->getFruByDeviceSlaveAddress(slave_address);
+    if(!fru)
+        return nullptr;
+    return fru->getStatusLedById(led_id);
 }
 
 std::string IpmiSdrManager::timestampToString(const uint32_t &tstamp) {
@@ -358,4 +427,17 @@ std::string IpmiSdrManager::getHeaderAsString() {
 
 bool IpmiSdrManager::sdrStateIsInitialized() {
     return (mSdrState == SDRSTATE::INITIALIZED);
-}
\ No newline at end of file
+}
+
+unsigned IpmiSdrManager::getGeneration() const {
+    return mGeneration;
+}
+
+void IpmiSdrManager::requestCheck() {
+    mReadTime = epicsTime();
+}
+
+bool IpmiSdrManager::isLoadDue() {
+    return (mSdrState == SDRSTATE::INITIALIZED || mLoadRetryDelay == 0.0 ||
+            epicsTime::getCurrent() > mReadTime + mLoadRetryDelay);
+}
@@ -12,12 +12,14 @@
 #include <vector>
 #include <memory>
 #include <map>
+#include <atomic>
 #include <freeipmi/freeipmi.h>
 #include <epicsTime.h>
 #include <epicsMutex.h>
 #include "IpmiSensorRecFull.h"
 #include "IpmiFruDevLocRec.h"
 #include "IpmiConnectionManager.h"
+#include "IpmiSdrRepository.h"
 
 class IpmiSdrManager
 {
@@ -34,26 +36,29 @@ private:
     uint32_t mAdditionTimestamp{0};
     uint32_t mEraseTimestamp{0};
 
-    std::vector<std::shared_ptr<IpmiSensorRecFull>> mSensRecFullList;
-    std::vector<std::shared_ptr<IpmiSensorRecComp>> mSensRecCompactList;
-    std::vector<std::shared_ptr<IpmiFruDevLocRec>> mFruDevLocRecList;
-    std::vector<std::shared_ptr<IpmiSensorRecComp>> mOrphandList;
+    std::shared_ptr<IpmiSdrRepository> mRepository;   //!< Parsed records, replaced as a whole on re-read.
 
-    std::map<std::string, std::shared_ptr<IpmiSensorRecComp>> mSidEntityMap;
-    std::map<std::shared_ptr<IpmiSensorRecComp>, uint16_t> mSensToFruMap;
+    /** LED discovery results by FRU cache key: "none", "failed" or "<led id>=<color> ..." */
+    std::map<std::string, std::string> mLedCache;
+    std::vector<std::shared_ptr<IpmiFruDevLocRec>> mLedProbeQueue;  //!< FRUs never probed for LEDs.
+    epicsTime mNextLedProbe;            //!< Probing is paced, no probe before this time.
 
     enum class SDRSTATE {
         UNINITIALIZED,
         INITIALIZED
     };
 
-    SDRSTATE mSdrState{SDRSTATE::UNINITIALIZED};
+    std::atomic<SDRSTATE> mSdrState{SDRSTATE::UNINITIALIZED};
+    std::atomic<unsigned> mGeneration{0};  //!< Incremented every time the SDR is (re)read.
+    double mLoadRetryDelay{0.0};           //!< Seconds between attempts while the first SDR load keeps failing.
     
     void readSdr();
     int compSdrHeader();
-    void insertRecord(ipmi_sdr_ctx_t psdr, uint16_t record_id, uint8_t record_type);
-    void insertIntoEntityMap(std::shared_ptr<IpmiSensorRecComp> prec);
-    void clearMaps();
+    void loadLedCache();
+    void saveLedCache();
+    void applyLeds(std::shared_ptr<IpmiFruDevLocRec> fru, const std::string &leds);
+    void requeueLedProbe(std::shared_ptr<IpmiFruDevLocRec> fru);
+    bool probeLeds(std::shared_ptr<IpmiFruDevLocRec> fru);
     std::string timestampToString(const uint32_t &tstamp);
 
     
@@ -63,9 +68,45 @@ public:
     void process();
     std::shared_ptr<IpmiFruDevLocRec> getFruByDeviceSlaveAddress(const uint8_t slave_address);
     std::shared_ptr<IpmiSensorRecComp> findSensorByMapKey(std::string key);
+
+    /**
+     * @brief Sensors of a FRU, or all sensors when key is empty.
+     * @param fru_key "entity-id:entity-instance" of FRU device locator record
+     * @return empty when SDR is not loaded or FRU has no sensors
+     */
+    std::vector<std::shared_ptr<IpmiSensorRecComp>> findFruSensors(const std::string &fru_key);
+    /**
+     * @brief Find the sensor that generated SEL event.
+     * @param generator_id as stored in SEL record, owner id in bits 7:1
+     * @param sensor_number as stored in SEL record
+     * @return sensor map key or empty string when not found
+     */
+    std::string findSensorKeyByEventSource(uint8_t generator_id, uint8_t sensor_number);
+    std::shared_ptr<PicmgLed> getPicmgLed(const uint8_t slave_address, const uint8_t led_id);
+
+    /**
+     * @brief Probe one FRU not yet known to have or not have LEDs.
+     * @return true when new LEDs were attached
+     *
+     * Called from the provider thread when it has no tasks queued. Each
+     * call blocks for at most a single FRU's timeout, calls are paced so
+     * that slow probes take only a small share of the thread.
+     */
+    bool discoverNextLeds();
     std::string getHeaderAsString();
 
     bool sdrStateIsInitialized();
+    unsigned getGeneration() const;
+
+    /**
+     * @brief Compare SDR info with the device on next process() instead of waiting for the periodic check.
+     */
+    void requestCheck();
+
+    /**
+     * @brief False while waiting to retry a failed first SDR load.
+     */
+    bool isLoadDue();
     
 };
 
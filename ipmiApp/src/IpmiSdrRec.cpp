@@ -15,9 +15,29 @@ IpmiSdrRec::IpmiSdrRec(uint16_t record_id, uint8_t record_type)
 
 }
 
+IpmiSdrRec::IpmiSdrRec(uint16_t record_id, uint8_t record_type, const common::bytes_view &data)
+    :record_id(record_id), record_type(record_type), record_data(data)
+{
+
+}
+
 IpmiSdrRec::~IpmiSdrRec() {
 }
 
+void IpmiSdrRec::read_record_data(ipmi_sdr_ctx_t sdr) {
+    uint8_t buf[IPMI_SDR_MAX_RECORD_LENGTH];
+    int len = ipmi_sdr_cache_record_read(sdr, buf, IPMI_SDR_MAX_RECORD_LENGTH);
+    if(len < 0)
+        throw std::runtime_error("Can't read SDR record " + std::to_string(this->record_id));
+    this->owned_data.assign(buf, buf + len);
+    this->record_data.data = this->owned_data.data();
+    this->record_data.size = this->owned_data.size();
+}
+
+const common::bytes_view &IpmiSdrRec::get_record_data() const {
+    return this->record_data;
+}
+
 uint16_t IpmiSdrRec::get_record_id() const {
     return this->record_id;
 }
@@ -35,7 +55,7 @@ double IpmiSdrRec::scale_threshold(ipmi_sdr_ctx_t sdr, uint64_t rawVal) const
     /*
     * Get the format type and scaling values from the SDR file.
     */
-    const common::buffer<uint8_t, IPMI_SDR_MAX_RECORD_LENGTH> &data = record_data;
+    const common::bytes_view &data = record_data;
     uint8_t sensor_units_percentage = 0;
     uint8_t sensor_units_modifier = 0;
     uint8_t sensor_units_rate = 0;
@@ -140,7 +160,7 @@ double IpmiSdrRec::scale_hysteresis(ipmi_sdr_ctx_t sdr, uint64_t rawVal) const
     /*
     * Get the format type and scaling values from the SDR file.
     */
-    const common::buffer<uint8_t, IPMI_SDR_MAX_RECORD_LENGTH> &data = record_data;
+    const common::bytes_view &data = record_data;
     uint8_t sensor_units_percentage = 0;
     uint8_t sensor_units_modifier = 0;
     uint8_t sensor_units_rate = 0;
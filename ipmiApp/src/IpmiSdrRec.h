@@ -10,6 +10,7 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
 #include "common.h"
 #include <freeipmi/freeipmi.h>
 
@@ -19,10 +20,17 @@ protected:
     uint16_t record_id;
     uint8_t record_type;
     std::string device_id_string;
-    common::buffer<uint8_t, IPMI_SDR_MAX_RECORD_LENGTH> record_data;
+    common::bytes_view record_data;         //!< Raw record, points to owned_data or into IpmiSdrRepository
+    std::vector<uint8_t> owned_data;        //!< Only used by records not stored in a repository
+
+    void read_record_data(ipmi_sdr_ctx_t sdr);
 public:
     IpmiSdrRec(uint16_t record_id, uint8_t record_type);
+    IpmiSdrRec(uint16_t record_id, uint8_t record_type, const common::bytes_view &data);
+    IpmiSdrRec(const IpmiSdrRec&) = delete;
+    IpmiSdrRec(IpmiSdrRec&&) = default;
     ~IpmiSdrRec();
+    const common::bytes_view &get_record_data() const;
     uint16_t get_record_id() const;
     uint8_t get_record_type() const;
     std::string get_device_id_string() const;
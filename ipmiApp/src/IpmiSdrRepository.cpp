@@ -0,0 +1,197 @@
+/* IpmiSdrRepository.cpp
+ *
+ * Copyright (c) 2018 Oak Ridge National Laboratory.
+ * All rights reserved.
+ * See file LICENSE that is included with this distribution.
+ */
+
+#include "IpmiSdrRepository.h"
+#include <stdexcept>
+
+IpmiSdrRepository::IpmiSdrRepository(ipmi_sdr_ctx_t sdr, uint16_t record_count)
+{
+    struct Location {
+        uint16_t record_id;
+        uint8_t record_type;
+        size_t offset;
+        unsigned int size;
+    };
+    std::vector<Location> locations;
+    locations.reserve(record_count);
+
+    /** First copy raw bytes of interesting records, objects will point into
+     *  the buffer so it must not move after they're created.
+    */
+    size_t nSensors = 0;
+    size_t nFrus = 0;
+    uint8_t buf[IPMI_SDR_MAX_RECORD_LENGTH];
+
+    if(ipmi_sdr_cache_first(sdr) < 0)
+        throw std::runtime_error("Could not rewind SDR cache.");
+
+    for(int i = 0; i < record_count; i++, ipmi_sdr_cache_next(sdr)) {
+        uint16_t record_id = 0;
+        uint8_t record_type = 0;
+        if(ipmi_sdr_parse_record_id_and_type (sdr, nullptr, 0, &record_id, &record_type)<0)
+            throw std::runtime_error("Could not read record ID and record type in SDR.");
+
+        if(record_type == IPMI_SDR_FORMAT_FULL_SENSOR_RECORD || record_type == IPMI_SDR_FORMAT_COMPACT_SENSOR_RECORD)
+            nSensors++;
+        else if(record_type == IPMI_SDR_FORMAT_FRU_DEVICE_LOCATOR_RECORD)
+            nFrus++;
+        else
+            continue;
+
+        int len = ipmi_sdr_cache_record_read(sdr, buf, IPMI_SDR_MAX_RECORD_LENGTH);
+        if(len < 0)
+            throw std::runtime_error("Could not read record " + std::to_string(record_id) + " from SDR.");
+
+        locations.push_back({record_id, record_type, mBytes.size(), static_cast<unsigned int>(len)});
+        mBytes.insert(mBytes.end(), buf, buf + len);
+    }
+    mBytes.shrink_to_fit();
+
+    mSensors.reserve(nSensors);
+    mFrus.reserve(nFrus);
+    for(auto &loc : locations) {
+        common::bytes_view data;
+        data.data = mBytes.data() + loc.offset;
+        data.size = loc.size;
+
+        if(loc.record_type == IPMI_SDR_FORMAT_FRU_DEVICE_LOCATOR_RECORD) {
+            mFrus.emplace_back(sdr, loc.record_id, loc.record_type, data);
+            continue;
+        }
+
+        mSensors.emplace_back(sdr, loc.record_id, loc.record_type, data);
+        const IpmiSensorRecComp &sensor = mSensors.back();
+        const uint16_t index = mSensors.size() - 1;
+
+        std::string sidKey = makeSensorKey(sensor);
+        if(mSidIndex.insert({sidKey, index}).second == false)
+            throw std::runtime_error("Cannot insert SDR record into map. Duplicate Keys Exists: " + sidKey);
+
+        /** SEL events identify the sensor by its owner and number. */
+        uint16_t source = ((((sensor.get_sensor_owner_id() << 1) | sensor.get_sensor_owner_id_type()) & 0xFF) << 8) | sensor.get_sensor_number();
+        mEventSourceIndex.insert({source, index});
+    }
+
+    associate();
+}
+
+std::string IpmiSdrRepository::makeSensorKey(const IpmiSensorRecComp &sensor)
+{
+    return std::to_string(sensor.get_entity_id()) + ":" +
+           std::to_string(sensor.get_entity_instance()) + ":" + sensor.get_device_id_string();
+}
+
+void IpmiSdrRepository::associate()
+{
+    /** Same rules as IpmiFruDevLocRec::parseAssociations(), first FRU wins. */
+    mSensorFru.assign(mSensors.size(), NO_FRU);
+    for(uint16_t f = 0; f < mFrus.size(); f++) {
+        const IpmiFruDevLocRec &fru = mFrus[f];
+        for(uint16_t s = 0; s < mSensors.size(); s++) {
+            if(mSensorFru[s] != NO_FRU)
+                continue;
+            const IpmiSensorRecComp &sensor = mSensors[s];
+            if(sensor.get_entity_id() == fru.get_fru_entity_id() && sensor.get_entity_instance() == fru.get_fru_entity_instance())
+                mSensorFru[s] = f;
+            /** Fans and cooling units are missing from the device relative association record. */
+            else if(fru.get_fru_entity_id() == IPMI_ENTITY_ID_COOLING_UNIT_COOLING_DOMAIN &&
+                    sensor.get_sensor_type() == IPMI_SENSOR_TYPE_FAN &&
+                    sensor.get_entity_instance() == fru.get_fru_entity_instance())
+                mSensorFru[s] = f;
+        }
+    }
+}
+
+std::shared_ptr<IpmiSensorRecComp> IpmiSdrRepository::findSensorByMapKey(const std::string &key)
+{
+    auto itr = mSidIndex.find(key);
+    if(itr == mSidIndex.end())
+        return nullptr;
+    /** Aliasing pointer, keeps the whole repository alive. */
+    return std::shared_ptr<IpmiSensorRecComp>(shared_from_this(), &mSensors[itr->second]);
+}
+
+std::string IpmiSdrRepository::findSensorKeyByEventSource(uint8_t generator_id, uint8_t sensor_number) const
+{
+    auto itr = mEventSourceIndex.find((generator_id << 8) | sensor_number);
+    if(itr == mEventSourceIndex.end())
+        return "";
+    return makeSensorKey(mSensors[itr->second]);
+}
+
+std::shared_ptr<IpmiFruDevLocRec> IpmiSdrRepository::getFruByDeviceSlaveAddress(uint8_t slave_address)
+{
+    for(size_t i = 0; i < mFrus.size(); i++) {
+        if(mFrus[i].get_device_slave_address() == slave_address)
+            return getFru(i);
+    }
+    return nullptr;
+}
+
+std::vector<std::shared_ptr<IpmiSensorRecComp>> IpmiSdrRepository::findFruSensors(uint8_t entity_id, uint8_t entity_instance)
+{
+    std::vector<std::shared_ptr<IpmiSensorRecComp>> sensors;
+    for(uint16_t f = 0; f < mFrus.size(); f++) {
+        if(mFrus[f].get_fru_entity_id() != entity_id || mFrus[f].get_fru_entity_instance() != entity_instance)
+            continue;
+        for(uint16_t s = 0; s < mSensors.size(); s++) {
+            if(mSensorFru[s] == f)
+                sensors.emplace_back(shared_from_this(), &mSensors[s]);
+        }
+        break;
+    }
+    return sensors;
+}
+
+std::vector<std::shared_ptr<IpmiSensorRecComp>> IpmiSdrRepository::getSensors()
+{
+    std::vector<std::shared_ptr<IpmiSensorRecComp>> sensors;
+    sensors.reserve(mSensors.size());
+    for(auto &sensor : mSensors)
+        sensors.emplace_back(shared_from_this(), &sensor);
+    return sensors;
+}
+
+std::shared_ptr<IpmiFruDevLocRec> IpmiSdrRepository::getFru(size_t index)
+{
+    if(index >= mFrus.size())
+        return nullptr;
+    return std::shared_ptr<IpmiFruDevLocRec>(shared_from_this(), &mFrus[index]);
+}
+
+size_t IpmiSdrRepository::getFruCount() const
+{
+    return mFrus.size();
+}
+
+size_t IpmiSdrRepository::getSensorCount() const
+{
+    return mSensors.size();
+}
+
+size_t IpmiSdrRepository::getOrphanCount() const
+{
+    size_t count = 0;
+    for(auto fru : mSensorFru) {
+        if(fru == NO_FRU)
+            count++;
+    }
+    return count;
+}
+
+size_t IpmiSdrRepository::getMemoryUsage() const
+{
+    /** Map nodes are estimated, strings longer than SSO buffer are not counted. */
+    const size_t mapNode = 4 * sizeof(void*);
+    return sizeof(*this) +
+           mBytes.capacity() +
+           mSensors.capacity() * sizeof(IpmiSensorRecComp) +
+           mFrus.capacity() * sizeof(IpmiFruDevLocRec) +
+           mSensorFru.capacity() * sizeof(uint16_t) +
+           mSidIndex.size() * (mapNode + sizeof(std::pair<const std::string, uint16_t>)) +
+           mEventSourceIndex.size() * (mapNode + sizeof(std::pair<const uint16_t, uint16_t>));
+}
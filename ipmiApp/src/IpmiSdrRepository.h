@@ -0,0 +1,80 @@
+/* IpmiSdrRepository.h
+ *
+ * Copyright (c) 2018 Oak Ridge National Laboratory.
+ * All rights reserved.
+ * See file LICENSE that is included with this distribution.
+ */
+
+#ifndef IPMIAPP_SRC_IPMISDRREPOSITORY_H_
+#define IPMIAPP_SRC_IPMISDRREPOSITORY_H_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <freeipmi/freeipmi.h>
+#include "IpmiSensorRecComp.h"
+#include "IpmiFruDevLocRec.h"
+
+/**
+ * @class IpmiSdrRepository
+ * @brief All parsed records of one SDR, stored together.
+ *
+ * Raw bytes of all records are kept back to back in one buffer, record
+ * objects are stored by value and only point into it. Lookups keep
+ * indices rather than reference counted pointers. Pointers handed out
+ * share ownership of the whole repository, which is freed in one step
+ * when the SDR is re-read and nobody uses the old one anymore.
+ */
+class IpmiSdrRepository : public std::enable_shared_from_this<IpmiSdrRepository>
+{
+private:
+
+    static constexpr uint16_t NO_FRU = 0xFFFF;
+
+    std::vector<uint8_t> mBytes;                        //!< Raw bytes of all records.
+    std::vector<IpmiSensorRecComp> mSensors;            //!< Full and compact sensor records.
+    std::vector<IpmiFruDevLocRec> mFrus;                //!< FRU device locator records.
+    std::vector<uint16_t> mSensorFru;                   //!< Index of parent FRU for each sensor, NO_FRU for orphans.
+    std::map<std::string, uint16_t> mSidIndex;          //!< Sensor index by "entity-id:entity-instance:id-string".
+    std::map<uint16_t, uint16_t> mEventSourceIndex;     //!< Sensor index by (generator id << 8 | sensor number).
+
+    void associate();
+
+public:
+
+    /**
+     * @brief Read and parse all records from SDR cache.
+     * @exception std::runtime_error on SDR cache read error or duplicate sensor keys
+     */
+    IpmiSdrRepository(ipmi_sdr_ctx_t sdr, uint16_t record_count);
+
+    static std::string makeSensorKey(const IpmiSensorRecComp &sensor);
+
+    std::shared_ptr<IpmiSensorRecComp> findSensorByMapKey(const std::string &key);
+    std::string findSensorKeyByEventSource(uint8_t generator_id, uint8_t sensor_number) const;
+    std::shared_ptr<IpmiFruDevLocRec> getFruByDeviceSlaveAddress(uint8_t slave_address);
+
+    /**
+     * @brief Sensors associated with FRU in SDR order.
+     * @return empty when there's no such FRU or it has no sensors
+     */
+    std::vector<std::shared_ptr<IpmiSensorRecComp>> findFruSensors(uint8_t entity_id, uint8_t entity_instance);
+
+    /**
+     * @brief All sensors in SDR order.
+     */
+    std::vector<std::shared_ptr<IpmiSensorRecComp>> getSensors();
+    std::shared_ptr<IpmiFruDevLocRec> getFru(size_t index);
+    size_t getFruCount() const;
+    size_t getSensorCount() const;
+    size_t getOrphanCount() const;
+
+    /**
+     * @brief Approximate heap memory used by the repository in bytes.
+     */
+    size_t getMemoryUsage() const;
+};
+
+#endif ///IPMIAPP_SRC_IPMISDRREPOSITORY_H_
@@ -0,0 +1,217 @@
+/* IpmiSelReader.cpp
+ *
+ * Copyright (c) 2018 Oak Ridge National Laboratory.
+ * All rights reserved.
+ * See file LICENSE that is included with this distribution.
+ */
+
+#include "IpmiSelReader.h"
+#include "common.h"
+
+double IpmiSelReader::sPollPeriod = 5.0;
+
+/** PICMG 3.0 Table 3-21, OEM sensor type of the FRU hot swap sensor. */
+static const uint8_t PICMG_SENSOR_TYPE_FRU_HOT_SWAP = 0xF0;
+
+IpmiSelReader::IpmiSelReader(IpmiConnectionManager &cmngr, IpmiSdrManager &smngr)
+: mConnMgr(cmngr)
+, mSdrMgr(smngr)
+{
+    mSelInfoRs = fiid_obj_create(tmpl_cmd_get_sel_info_rs);
+    if(!fiid_obj_valid(mSelInfoRs))
+        throw std::runtime_error("Can't allocate SEL info response for connection id: \'" + mConnMgr.getConnectionId() + "\'");
+}
+
+IpmiSelReader::~IpmiSelReader()
+{
+    destroySelContext();
+    fiid_obj_destroy(mSelInfoRs);
+}
+
+void IpmiSelReader::setPollPeriod(double seconds)
+{
+    sPollPeriod = seconds;
+}
+
+void IpmiSelReader::createSelContext()
+{
+    ipmi_ctx_t ipmi = mConnMgr.getIpmiCtx();
+    if(mSelCtx && mSelIpmiCtx == ipmi)
+        return;
+
+    /** Session was re-established, old context points to freed session. */
+    destroySelContext();
+
+    mSelCtx = ipmi_sel_ctx_create(ipmi, mConnMgr.getSdrCtx());
+    if(!mSelCtx)
+        throw std::runtime_error("Can't create SEL context for connection id: \'" + mConnMgr.getConnectionId() + "\'");
+    mSelIpmiCtx = ipmi;
+    mPositioned = false;
+}
+
+void IpmiSelReader::destroySelContext()
+{
+    if(mSelCtx)
+        ipmi_sel_ctx_destroy(mSelCtx);
+    mSelCtx = nullptr;
+    mSelIpmiCtx = nullptr;
+}
+
+bool IpmiSelReader::readSelInfo(uint16_t &entries, uint32_t &additionTimestamp, uint32_t &eraseTimestamp)
+{
+    if(fiid_obj_clear(mSelInfoRs) < 0)
+        throw std::runtime_error("Can't read SEL info for connection id: \'" + mConnMgr.getConnectionId() +
+        "\', Reason: fiid_obj_clear() returned -1");
+
+    if(ipmi_cmd_get_sel_info(mSelIpmiCtx, mSelInfoRs) < 0)
+        throw std::runtime_error("Can't read SEL info for connection id: \'" + mConnMgr.getConnectionId() +
+        "\', Reason: " + ipmi_ctx_errormsg(mSelIpmiCtx));
+
+    uint64_t val = 0;
+    if(fiid_obj_get(mSelInfoRs, "entries", &val) < 0)
+        return false;
+    entries = val;
+    if(fiid_obj_get(mSelInfoRs, "most_recent_addition_timestamp", &val) < 0)
+        return false;
+    additionTimestamp = val;
+    if(fiid_obj_get(mSelInfoRs, "most_recent_erase_timestamp", &val) < 0)
+        return false;
+    eraseTimestamp = val;
+    return true;
+}
+
+int IpmiSelReader::parseCallback(ipmi_sel_ctx_t ctx, void *data)
+{
+    reinterpret_cast<IpmiSelReader*>(data)->handleEntry();
+    return 0;
+}
+
+void IpmiSelReader::handleEntry()
+{
+    uint16_t recordId = 0;
+    if(ipmi_sel_parse_read_record_id(mSelCtx, NULL, 0, &recordId) < 0)
+        return;
+
+    /** Incremental reads start at the last entry we already have. */
+    if(mPositioned && recordId == mLastRecordId)
+        return;
+    mLastRecordId = recordId;
+
+    uint8_t recordType = 0;
+    uint32_t timestamp = 0;
+    ipmi_sel_parse_read_record_type(mSelCtx, NULL, 0, &recordType);
+    ipmi_sel_parse_read_timestamp(mSelCtx, NULL, 0, &timestamp);
+
+    if(mPositioned && ipmi_sel_record_type_class(recordType) == IPMI_SEL_RECORD_TYPE_CLASS_SYSTEM_EVENT_RECORD)
+    {
+        uint8_t generatorId = 0;
+        uint8_t sensorNumber = 0;
+        if(ipmi_sel_parse_read_generator_id(mSelCtx, NULL, 0, &generatorId) >= 0 &&
+           ipmi_sel_parse_read_sensor_number(mSelCtx, NULL, 0, &sensorNumber) >= 0)
+        {
+            std::string key = mSdrMgr.findSensorKeyByEventSource(generatorId, sensorNumber);
+            if(!key.empty())
+                mEventSensors.push_back(key);
+
+            /** Hot swap sensor shares the entity with all sensors of its FRU. */
+            uint8_t sensorType = 0;
+            uint8_t offset = 0;
+            if(!key.empty() &&
+               ipmi_sel_parse_read_sensor_type(mSelCtx, NULL, 0, &sensorType) >= 0 &&
+               sensorType == PICMG_SENSOR_TYPE_FRU_HOT_SWAP &&
+               ipmi_sel_parse_read_event_data1_offset_from_event_reading_type_code(mSelCtx, NULL, 0, &offset) >= 0)
+            {
+                auto sensor = mSdrMgr.findSensorByMapKey(key);
+                if(sensor)
+                    mHotSwapEvents.push_back({sensor->get_entity_id(), sensor->get_entity_instance(), offset});
+            }
+        }
+    }
+
+    char text[256] = {'\0'};
+    if(ipmi_sel_parse_format_record_string(mSelCtx, "%d %t %s %e %k", NULL, 0, text, sizeof(text),
+                                           IPMI_SEL_STRING_FLAGS_DEFAULT) < 0)
+        snprintf(text, sizeof(text), "SEL record %u", (unsigned) recordId);
+
+    common::ScopedLock lock(mMutex);
+    mLastEvent = text;
+    mLastEventTimestamp = timestamp;
+    mEventCount++;
+}
+
+void IpmiSelReader::readEntries(uint16_t start)
+{
+    if(ipmi_sel_parse(mSelCtx, start, IPMI_SEL_RECORD_ID_LAST, parseCallback, this) < 0)
+        throw std::runtime_error("Can't read SEL entries for connection id: \'" + mConnMgr.getConnectionId() +
+        "\', Reason: " + ipmi_sel_ctx_errormsg(mSelCtx));
+}
+
+std::vector<std::string> IpmiSelReader::process()
+{
+    mEventSensors.clear();
+    mHotSwapEvents.clear();
+
+    if(sPollPeriod <= 0 || epicsTime::getCurrent() < mPollTime + sPollPeriod)
+        return mEventSensors;
+    mPollTime = epicsTime::getCurrent();
+
+    createSelContext();
+
+    uint16_t entries = 0;
+    uint32_t additionTimestamp = 0;
+    uint32_t eraseTimestamp = 0;
+    if(!readSelInfo(entries, additionTimestamp, eraseTimestamp))
+        return mEventSensors;
+
+    if(!mPositioned && entries == 0)
+    {
+        /** Real records never use id 0, next read starts from the first one. */
+        mLastRecordId = IPMI_SEL_RECORD_ID_FIRST;
+        mPositioned = true;
+    }
+    else if(!mPositioned)
+    {
+        /** Don't replay history, only pick up where the SEL currently ends. */
+        readEntries(IPMI_SEL_RECORD_ID_LAST);
+        mPositioned = true;
+    }
+    else if(eraseTimestamp != mEraseTimestamp)
+    {
+        /** SEL was cleared, everything in it is new. Ids restart, so the first
+         *  entry may reuse the last id we had and must not be skipped.
+         */
+        mLastRecordId = IPMI_SEL_RECORD_ID_FIRST;
+        readEntries(IPMI_SEL_RECORD_ID_FIRST);
+    }
+    else if(additionTimestamp != mAdditionTimestamp)
+    {
+        try
+        {
+            readEntries(mLastRecordId);
+        }
+        catch(const std::exception& e)
+        {
+            /** Our last entry is gone, reposition without replaying. */
+            mPositioned = false;
+            readEntries(IPMI_SEL_RECORD_ID_LAST);
+            mPositioned = true;
+        }
+    }
+
+    mAdditionTimestamp = additionTimestamp;
+    mEraseTimestamp = eraseTimestamp;
+    return mEventSensors;
+}
+
+const std::vector<IpmiSelReader::HotSwapEvent>& IpmiSelReader::getHotSwapEvents() const
+{
+    return mHotSwapEvents;
+}
+
+std::string IpmiSelReader::getLastEvent(uint32_t &timestamp, unsigned &count)
+{
+    common::ScopedLock lock(mMutex);
+    timestamp = mLastEventTimestamp;
+    count = mEventCount;
+    return mLastEvent;
+}
@@ -0,0 +1,100 @@
+/* IpmiSelReader.h
+ *
+ * Copyright (c) 2018 Oak Ridge National Laboratory.
+ * All rights reserved.
+ * See file LICENSE that is included with this distribution.
+ */
+
+#ifndef IPMIAPP_SRC_IPMISELREADER_H_
+#define IPMIAPP_SRC_IPMISELREADER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <freeipmi/freeipmi.h>
+#include <epicsTime.h>
+#include <epicsMutex.h>
+#include "IpmiConnectionManager.h"
+#include "IpmiSdrManager.h"
+
+/**
+ * @class IpmiSelReader
+ * @brief Incrementally reads the System Event Log of one connection.
+ *
+ * Remembers the last record id and SEL addition timestamp, on every poll
+ * it asks only for the SEL info and fetches the new entries when the
+ * addition timestamp moved. Events are decoded against the parsed SDR
+ * to find the sensor that generated them.
+ */
+class IpmiSelReader
+{
+public:
+
+    /**
+     * @brief PICMG FRU hot swap state change decoded from a SEL entry.
+     */
+    struct HotSwapEvent {
+        uint8_t entityId;
+        uint8_t entityInstance;
+        uint8_t state;                      //!< New M-state, M0 not installed to M7 communication lost.
+    };
+
+private:
+
+    IpmiConnectionManager &mConnMgr;
+    IpmiSdrManager &mSdrMgr;
+
+    ipmi_sel_ctx_t mSelCtx{nullptr};
+    ipmi_ctx_t mSelIpmiCtx{nullptr};        //!< Session mSelCtx was created with, recreate after reconnect.
+    fiid_obj_t mSelInfoRs{nullptr};
+
+    epicsTime mPollTime;
+    bool mPositioned{false};                //!< Last record id is known.
+    uint16_t mLastRecordId{0};
+    uint32_t mAdditionTimestamp{0};
+    uint32_t mEraseTimestamp{0};
+
+    epicsMutex mMutex;                      //!< Protects the last event fields.
+    std::string mLastEvent;
+    uint32_t mLastEventTimestamp{0};
+    unsigned mEventCount{0};
+
+    std::vector<std::string> mEventSensors; //!< Sensor keys with events in current poll.
+    std::vector<HotSwapEvent> mHotSwapEvents; //!< Hot swap transitions in current poll.
+
+    static double sPollPeriod;
+
+    void createSelContext();
+    void destroySelContext();
+    bool readSelInfo(uint16_t &entries, uint32_t &additionTimestamp, uint32_t &eraseTimestamp);
+    void readEntries(uint16_t start);
+    static int parseCallback(ipmi_sel_ctx_t ctx, void *data);
+    void handleEntry();
+
+public:
+    IpmiSelReader(IpmiConnectionManager &cmngr, IpmiSdrManager &smngr);
+    ~IpmiSelReader();
+
+    /**
+     * @brief Fetch new SEL entries if the poll period elapsed.
+     * @return sensor map keys that generated events since previous call
+     */
+    std::vector<std::string> process();
+
+    /**
+     * @brief Hot swap state changes found by the last process() call.
+     */
+    const std::vector<HotSwapEvent>& getHotSwapEvents() const;
+
+    /**
+     * @brief Text, timestamp and running count of the most recent SEL entry.
+     */
+    std::string getLastEvent(uint32_t &timestamp, unsigned &count);
+
+    /**
+     * @brief Set how often SEL info is checked, 0 disables SEL reading.
+     */
+    static void setPollPeriod(double seconds);
+};
+
+#endif ///IPMIAPP_SRC_IPMISELREADER_H_
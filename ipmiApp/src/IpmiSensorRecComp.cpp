@@ -6,6 +6,7 @@
 */
 
 #include "IpmiSensorRecComp.h"
+#include <cmath>
 #include <sstream>
 #include "IpmiSdrDefs.h"
 
@@ -13,29 +14,55 @@
 IpmiSensorRecComp::IpmiSensorRecComp(ipmi_sdr_ctx_t sdr, uint16_t record_id, uint8_t record_type)
     :IpmiSdrRec(record_id, record_type)
 {
-    int rv = (-1);
+    read_record_data(sdr);
+    parse(sdr);
+}
+
+IpmiSensorRecComp::IpmiSensorRecComp(ipmi_sdr_ctx_t sdr, uint16_t record_id, uint8_t record_type, const common::bytes_view &data)
+    :IpmiSdrRec(record_id, record_type, data)
+{
+    parse(sdr);
+}
 
-    this->record_data.size = ipmi_sdr_cache_record_read(sdr, this->record_data.data, IPMI_SDR_MAX_RECORD_LENGTH);
+void IpmiSensorRecComp::parse(ipmi_sdr_ctx_t sdr)
+{
+    int rv = (-1);
+    const void *data = this->record_data.data;
+    const unsigned int size = this->record_data.size;
 
-    rv = ipmi_sdr_parse_sensor_owner_id (sdr, NULL, 0, &sensor_owner_id_type, &sensor_owner_id);
+    rv = ipmi_sdr_parse_sensor_owner_id (sdr, data, size, &sensor_owner_id_type, &sensor_owner_id);
 
-    rv = ipmi_sdr_parse_sensor_owner_lun (sdr, NULL, 0, &sensor_owner_lun, &channel_number);
+    rv = ipmi_sdr_parse_sensor_owner_lun (sdr, data, size, &sensor_owner_lun, &channel_number);
 
-    rv = ipmi_sdr_parse_sensor_number (sdr, NULL, 0, &sensor_number);
+    rv = ipmi_sdr_parse_sensor_number (sdr, data, size, &sensor_number);
 
-    rv = ipmi_sdr_parse_entity_id_instance_type (sdr, NULL, 0, &entity_id, &entity_instance, &entity_instance_type);
+    rv = ipmi_sdr_parse_entity_id_instance_type (sdr, data, size, &entity_id, &entity_instance, &entity_instance_type);
 
-    rv = ipmi_sdr_parse_sensor_type (sdr, NULL, 0, &sensor_type);
+    rv = ipmi_sdr_parse_sensor_type (sdr, data, size, &sensor_type);
 
-    rv = ipmi_sdr_parse_event_reading_type_code (sdr, NULL, 0, &event_reading_type_code);
+    rv = ipmi_sdr_parse_event_reading_type_code (sdr, data, size, &event_reading_type_code);
 
     char id_str[IPMI_SDR_MAX_SENSOR_NAME_LENGTH] = {'\0'};
-    rv = ipmi_sdr_parse_id_string (sdr, NULL, 0, &id_str[0], IPMI_SDR_MAX_SENSOR_NAME_LENGTH);
+    rv = ipmi_sdr_parse_id_string (sdr, data, size, &id_str[0], IPMI_SDR_MAX_SENSOR_NAME_LENGTH);
     this->device_id_string = id_str;
 
-    rv = ipmi_sdr_parse_sensor_units (sdr, NULL, 0, &sensor_units_percentage, &sensor_units_modifier,
+    rv = ipmi_sdr_parse_sensor_units (sdr, data, size, &sensor_units_percentage, &sensor_units_modifier,
     &sensor_units_rate, &sensor_base_unit_type, &sensor_modifier_unit_type);
 
+    /** Only full records of analog sensors have conversion factors. */
+    int8_t r_exponent = 0;
+    int8_t b_exponent = 0;
+    int16_t m = 0;
+    int16_t b = 0;
+    uint8_t linearization = 0;
+    uint8_t analog_data_format = 0;
+    if(this->record_type == IPMI_SDR_FORMAT_FULL_SENSOR_RECORD &&
+       ipmi_sdr_parse_sensor_decoding_data (sdr, data, size, &r_exponent, &b_exponent, &m, &b,
+                                            &linearization, &analog_data_format) >= 0 &&
+       analog_data_format != IPMI_SDR_ANALOG_DATA_FORMAT_NOT_ANALOG &&
+       linearization == IPMI_SDR_LINEARIZATION_LINEAR)
+        this->resolution = std::abs(m) * pow(10, r_exponent);
+
     /**printf("%s, [%u, %u, %u, %u, %u]\n", id_str, sensor_units_percentage, sensor_units_modifier,
     sensor_units_rate, sensor_base_unit_type, sensor_modifier_unit_type);*/
 
@@ -92,8 +119,18 @@ std::string IpmiSensorRecComp::get_sensor_base_unit_type_str() const {
     return std::string("Invalid-Type");
 }
 
-const common::buffer<uint8_t, IPMI_SDR_MAX_RECORD_LENGTH> &IpmiSensorRecComp::get_record_data() const {
-    return this->record_data;
+double IpmiSensorRecComp::get_resolution() const {
+    return this->resolution;
+}
+
+std::string IpmiSensorRecComp::get_state_string(unsigned int offset) const {
+    char buf[64] = {'\0'};
+    int len = -1;
+    if(IPMI_EVENT_READING_TYPE_CODE_IS_GENERIC(this->event_reading_type_code))
+        len = ipmi_get_generic_event_message(this->event_reading_type_code, offset, buf, sizeof(buf));
+    else if(IPMI_EVENT_READING_TYPE_CODE_IS_SENSOR_SPECIFIC(this->event_reading_type_code))
+        len = ipmi_get_sensor_type_message(this->sensor_type, offset, buf, sizeof(buf));
+    return std::string(len > 0 ? buf : "");
 }
 
 std::string IpmiSensorRecComp::to_string() const {
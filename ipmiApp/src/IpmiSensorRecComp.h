@@ -29,9 +29,14 @@ private:
     uint8_t sensor_units_rate;
     uint8_t sensor_base_unit_type;
     uint8_t sensor_modifier_unit_type;
+    double resolution{0.0};             //!< Reading step in engineering units, 0 when not analog
+
+    void parse(ipmi_sdr_ctx_t sdr);
 
 public:
     IpmiSensorRecComp(ipmi_sdr_ctx_t sdr, uint16_t record_id, uint8_t record_type);
+    IpmiSensorRecComp(ipmi_sdr_ctx_t sdr, uint16_t record_id, uint8_t record_type, const common::bytes_view &data);
+    IpmiSensorRecComp(IpmiSensorRecComp&&) = default;
     ~IpmiSensorRecComp();
     uint8_t get_sensor_owner_id_type() const;
     uint8_t get_sensor_owner_id() const;
@@ -46,7 +51,19 @@ public:
     std::string get_sensor_base_unit_type_str() const;
     std::string get_entity_id_string() const;
 
-    const common::buffer<uint8_t, IPMI_SDR_MAX_RECORD_LENGTH> &get_record_data() const;
+    /**
+     * @brief Change of reading for one raw count, |M| * 10^R from the full sensor record.
+     * @return 0 for compact records and sensors without linear analog reading
+     */
+    double get_resolution() const;
+
+    /**
+     * @brief Name of discrete state at given offset, empty if not defined.
+     *
+     * Generic reading types use the generic event table, sensor specific
+     * reading type the table for this sensor type.
+     */
+    std::string get_state_string(unsigned int offset) const;
 
     std::string to_string() const;
 
@@ -0,0 +1,97 @@
+/* PollScheduler.cpp
+ *
+ * Copyright (c) 2018 Oak Ridge National Laboratory.
+ * All rights reserved.
+ * See file LICENSE that is included with this distribution.
+ */
+
+#include "PollScheduler.h"
+#include "common.h"
+#include <cmath>
+#include <set>
+
+PollScheduler::PollScheduler(double tick)
+: mTick(tick)
+, mStart(epicsTime::getCurrent())
+{
+}
+
+void PollScheduler::insert(size_t id)
+{
+    const Entry &entry = mEntries[id];
+    const uint64_t delta = (entry.due > mNow ? entry.due - mNow : 0);
+
+    if(delta < WHEEL_SIZE)
+        mInner[entry.due % WHEEL_SIZE].push_back(id);
+    else if(delta < (uint64_t)WHEEL_SIZE * WHEEL_SIZE)
+        mOuter[(entry.due / WHEEL_SIZE) % WHEEL_SIZE].push_back(id);
+    else
+        /** Farthest outer slot, gets re-inserted when cascaded. */
+        mOuter[(mNow / WHEEL_SIZE + WHEEL_SIZE - 1) % WHEEL_SIZE].push_back(id);
+}
+
+void PollScheduler::add(const std::string &key, double period)
+{
+    uint64_t ticks = std::max(1.0, std::ceil(period / mTick));
+
+    common::ScopedLock lock(mMutex);
+    auto it = mIndex.find(key);
+    if(it != mIndex.end())
+    {
+        /** Takes effect after the currently scheduled poll. */
+        Entry &entry = mEntries[it->second];
+        entry.period = std::min(entry.period, ticks);
+        return;
+    }
+
+    mEntries.push_back({key, ticks, mNow + 1});
+    mIndex[key] = mEntries.size() - 1;
+    insert(mEntries.size() - 1);
+}
+
+std::vector<std::string> PollScheduler::advance()
+{
+    std::set<size_t> due;
+    std::vector<std::string> keys;
+
+    common::ScopedLock lock(mMutex);
+    const uint64_t target = (epicsTime::getCurrent() - mStart) / mTick;
+
+    while(mNow < target)
+    {
+        mNow++;
+
+        if(mNow % WHEEL_SIZE == 0)
+        {
+            std::vector<size_t> cascade;
+            cascade.swap(mOuter[(mNow / WHEEL_SIZE) % WHEEL_SIZE]);
+            for(auto id : cascade)
+                insert(id);
+        }
+
+        std::vector<size_t> expired;
+        expired.swap(mInner[mNow % WHEEL_SIZE]);
+        for(auto id : expired)
+        {
+            Entry &entry = mEntries[id];
+            if(entry.due > mNow)
+            {
+                insert(id);
+                continue;
+            }
+            due.insert(id);
+            entry.due = mNow + entry.period;
+            insert(id);
+        }
+    }
+
+    for(auto id : due)
+        keys.push_back(mEntries[id].key);
+    return keys;
+}
+
+size_t PollScheduler::size()
+{
+    common::ScopedLock lock(mMutex);
+    return mEntries.size();
+}
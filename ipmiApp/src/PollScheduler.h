@@ -0,0 +1,77 @@
+/* PollScheduler.h
+ *
+ * Copyright (c) 2018 Oak Ridge National Laboratory.
+ * All rights reserved.
+ * See file LICENSE that is included with this distribution.
+ */
+
+#ifndef IPMIAPP_SRC_POLLSCHEDULER_H_
+#define IPMIAPP_SRC_POLLSCHEDULER_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include <epicsMutex.h>
+#include <epicsTime.h>
+
+/**
+ * @class PollScheduler
+ * @brief Hierarchical timer wheel deciding which entities are due for polling.
+ *
+ * Each key is registered once no matter how many records use it, with
+ * the shortest period any of them asked for. The inner wheel covers
+ * WHEEL_SIZE ticks, the outer one WHEEL_SIZE inner revolutions, longer
+ * periods are parked in the farthest outer slot and re-inserted when
+ * it cascades. Advancing costs only the entries in expired slots.
+ */
+class PollScheduler
+{
+private:
+
+    static const unsigned WHEEL_SIZE = 64;
+
+    struct Entry {
+        std::string key;
+        uint64_t period;                //!< In ticks, at least 1.
+        uint64_t due;                   //!< Absolute tick of next poll.
+    };
+
+    epicsMutex mMutex;
+    const double mTick;                 //!< Tick length in seconds.
+    const epicsTime mStart;
+    uint64_t mNow{0};                   //!< Last tick processed.
+    std::vector<Entry> mEntries;
+    std::map<std::string, size_t> mIndex;   //!< Entry index by key.
+    std::vector<size_t> mInner[WHEEL_SIZE];
+    std::vector<size_t> mOuter[WHEEL_SIZE];
+
+    void insert(size_t id);
+
+public:
+
+    /**
+     * @param tick resolution of the wheel in seconds
+     */
+    explicit PollScheduler(double tick=0.1);
+
+    /**
+     * @brief Register key for polling, shorter period wins for keys already registered.
+     * @param key opaque entity key
+     * @param period in seconds, rounded up to whole ticks
+     */
+    void add(const std::string &key, double period);
+
+    /**
+     * @brief Advance the wheel to current time.
+     * @return keys whose period expired since previous call, each key at most once
+     */
+    std::vector<std::string> advance();
+
+    /**
+     * @brief Number of registered keys.
+     */
+    size_t size();
+};
+
+#endif ///IPMIAPP_SRC_POLLSCHEDULER_H_
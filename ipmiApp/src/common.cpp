@@ -12,17 +12,223 @@
 
 #include <algorithm>
 #include <iterator>
+#include <map>
 #include <stdarg.h>
 #include <stdio.h>
 #include <string>
 #include <sstream>
 #include <iomanip>
 
+#include <epicsThread.h>
 #include <epicsTime.h>
 
 namespace common {
 
-static unsigned epicsipmiLogLevel = 4;
+static std::atomic<unsigned> epicsipmiLogLevel{4};
+
+static const size_t LOG_QUEUE_SIZE = 1024;      //!< Power of 2
+static const size_t LOG_MSG_SIZE = 512;         //!< Longer messages are truncated
+static const double LOG_REPEAT_PERIOD = 10.0;   //!< Seconds identical messages are collapsed
+static const double LOG_MAX_RATE = 100.0;       //!< Lines per second printed at most
+static const size_t LOG_MAX_TRACKED = 4096;     //!< Distinct messages remembered for collapsing
+
+/**
+ * @class LogQueue
+ * @brief Bounded multi-producer single-consumer ring of formatted messages.
+ *
+ * Producers claim a slot with one compare-and-swap and format right into
+ * it, the log thread prints. Each slot's sequence number tells whose turn
+ * it is, so no lock is needed on either side.
+ */
+extern "C" {
+    static void logThread(void* ctx);
+};
+
+class LogQueue {
+    public:
+        LogQueue()
+        {
+            for (size_t i = 0; i < LOG_QUEUE_SIZE; i++)
+                mSlots[i].seq.store(i, std::memory_order_relaxed);
+            epicsThreadCreate("ipmiLog", epicsThreadPriorityLow,
+                epicsThreadGetStackSize(epicsThreadStackSmall), (EPICSTHREADFUNC)&logThread, this);
+        }
+
+        void push(unsigned severity, const char* fmt, va_list args)
+        {
+            size_t pos = mHead.load(std::memory_order_relaxed);
+            Slot* slot;
+            while (true) {
+                slot = &mSlots[pos & (LOG_QUEUE_SIZE - 1)];
+                size_t seq = slot->seq.load(std::memory_order_acquire);
+                intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+                if (diff == 0) {
+                    if (mHead.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                } else if (diff < 0) {
+                    /** Full, log thread can't keep up. */
+                    mDropped.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                } else {
+                    pos = mHead.load(std::memory_order_relaxed);
+                }
+            }
+
+            slot->severity = severity;
+            epicsTimeGetCurrent(&slot->time);
+            vsnprintf(slot->text, sizeof(slot->text), fmt, args);
+            /** Signaling takes the event's mutex, only wake the log thread when it's
+             *  idle, it drains everything queued before going idle again. */
+            slot->seq.store(pos + 1, std::memory_order_seq_cst);
+            if (mIdle.load(std::memory_order_seq_cst) && mIdle.exchange(false))
+                mEvent.signal();
+        }
+
+        void flush()
+        {
+            mFlushing = true;
+            mEvent.signal();
+            mFlushed.wait(1.0);
+        }
+
+    private:
+        struct Slot {
+            std::atomic<size_t> seq;
+            unsigned severity;
+            epicsTimeStamp time;
+            char text[LOG_MSG_SIZE];
+        };
+
+        struct Repeat {
+            epicsTime first;            //!< When message was last printed
+            unsigned severity;
+            unsigned count{0};          //!< Times suppressed since
+        };
+
+        Slot mSlots[LOG_QUEUE_SIZE];
+        std::atomic<size_t> mHead{0};
+        size_t mTail{0};                //!< Only used by the log thread
+        std::atomic<unsigned long> mDropped{0};
+        std::atomic<bool> mFlushing{false};
+        std::atomic<bool> mIdle{false}; //!< Log thread is about to wait, next push signals it
+        epicsEvent mEvent;
+        epicsEvent mFlushed;
+        std::map<std::string, Repeat> mRepeats;
+        double mTokens{LOG_MAX_RATE};
+        epicsTime mTokensTime{epicsTime::getCurrent()};
+
+        static void print(unsigned severity, const epicsTimeStamp& time, const std::string& text)
+        {
+            static const char* severities[] = { "", "ERROR", "WARN", "INFO", "DEBUG" };
+            char timeText[40] = {'\0'};
+            epicsTimeToStrftime(timeText, sizeof(timeText), "[%Y/%m/%d %H:%M:%S.%03f] ", &time);
+            printf("%sepicsipmi %s: %s%s", timeText, severities[std::min(severity, 4u)], text.c_str(),
+                   (!text.empty() && text.back() == '\n') ? "" : "\n");
+        }
+
+        /** Rate limit, refills continuously up to one second worth of lines. */
+        bool takeToken(const epicsTime& now)
+        {
+            mTokens = std::min(LOG_MAX_RATE, mTokens + (now - mTokensTime) * LOG_MAX_RATE);
+            mTokensTime = now;
+            if (mTokens < 1.0)
+                return false;
+            mTokens -= 1.0;
+            return true;
+        }
+
+        void handle(unsigned severity, const epicsTimeStamp& time, const std::string& text)
+        {
+            epicsTime now = time;
+            auto it = mRepeats.find(text);
+            if (it != mRepeats.end()) {
+                it->second.count++;
+                return;
+            }
+            if (!mFlushing && !takeToken(now)) {
+                mDropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            print(severity, time, text);
+            if (mRepeats.size() < LOG_MAX_TRACKED)
+                mRepeats.insert({text, {now, severity}});
+        }
+
+        /** Summarize collapsed messages whose period is over, forget the quiet ones. */
+        void expire(bool all)
+        {
+            epicsTime now = epicsTime::getCurrent();
+            for (auto it = mRepeats.begin(); it != mRepeats.end(); ) {
+                double elapsed = now - it->second.first;
+                if (!all && elapsed < LOG_REPEAT_PERIOD) {
+                    ++it;
+                    continue;
+                }
+                if (it->second.count > 0) {
+                    std::string text = it->first;
+                    while (!text.empty() && text.back() == '\n')
+                        text.pop_back();
+                    text += " (repeated " + std::to_string(it->second.count) + " times in " + std::to_string((int)elapsed) + "s)";
+                    print(it->second.severity, now, text);
+                    /** Keep collapsing while it keeps coming. */
+                    it->second.first = now;
+                    it->second.count = 0;
+                    ++it;
+                } else {
+                    it = mRepeats.erase(it);
+                }
+            }
+
+            unsigned long dropped = mDropped.exchange(0);
+            if (dropped > 0)
+                print(2, now, std::to_string(dropped) + " log messages dropped");
+        }
+
+    public:
+        void run()
+        {
+            epicsTime lastExpire = epicsTime::getCurrent();
+            while (true) {
+                /** Pairs with push(): either it sees idle and signals, or the
+                 *  message is seen here and the thread doesn't wait. */
+                mIdle.store(true, std::memory_order_seq_cst);
+                if (mSlots[mTail & (LOG_QUEUE_SIZE - 1)].seq.load(std::memory_order_seq_cst) != mTail + 1)
+                    mEvent.wait(1.0);
+                mIdle.store(false, std::memory_order_relaxed);
+
+                while (true) {
+                    Slot& slot = mSlots[mTail & (LOG_QUEUE_SIZE - 1)];
+                    if (slot.seq.load(std::memory_order_acquire) != mTail + 1)
+                        break;
+                    handle(slot.severity, slot.time, slot.text);
+                    slot.seq.store(mTail + LOG_QUEUE_SIZE, std::memory_order_release);
+                    mTail++;
+                }
+
+                bool flushing = mFlushing.exchange(false);
+                if (flushing || (epicsTime::getCurrent() - lastExpire) >= 1.0) {
+                    expire(flushing);
+                    lastExpire = epicsTime::getCurrent();
+                }
+                fflush(stdout);
+                if (flushing)
+                    mFlushed.signal();
+            }
+        }
+};
+
+extern "C" {
+    static void logThread(void* ctx)
+    {
+        reinterpret_cast<LogQueue*>(ctx)->run();
+    }
+};
+
+static LogQueue& getLogQueue()
+{
+    static LogQueue queue;
+    return queue;
+}
 
 std::string hex_dump(uint8_t const * const buff, unsigned int const pos, size_t const len)
 {
@@ -40,36 +246,139 @@ std::string hex_dump(uint8_t const * const buff, unsigned int const pos, size_t
 
 void epicsipmi_log(unsigned severity, const std::string& fmt, ...)
 {
-    static std::string severities[] = {
-        "",
-        "ERROR",
-        "WARN",
-        "INFO",
-        "DEBUG"
-    };
-
-    if (severity <= epicsipmiLogLevel) {
-        std::string msg;
-
-        if (severity > 4)
-            severity = 4;
-
-        epicsTimeStamp now;
-        if (epicsTimeGetCurrent(&now) == 0) {
-            char nowText[40] = {'\0'};
-            epicsTimeToStrftime(nowText, sizeof(nowText), "[%Y/%m/%d %H:%M:%S.%03f] ", &now);
-            msg += nowText;
+    if (severity > epicsipmiLogLevel.load(std::memory_order_relaxed))
+        return;
+
+    va_list args;
+    va_start(args, fmt);
+    getLogQueue().push(severity, fmt.c_str(), args);
+    va_end(args);
+}
+
+void setLogLevel(unsigned level)
+{
+    epicsipmiLogLevel = level;
+}
+
+unsigned getLogLevel()
+{
+    return epicsipmiLogLevel;
+}
+
+void flushLog()
+{
+    getLogQueue().flush();
+}
+
+Semaphore::Semaphore(unsigned limit)
+    : mLimit(limit)
+{}
+
+void Semaphore::setLimit(unsigned limit)
+{
+    {
+        ScopedLock lock(mMutex);
+        mLimit = limit;
+    }
+    mEvent.signal();
+}
+
+void Semaphore::acquire()
+{
+    while (true) {
+        {
+            ScopedLock lock(mMutex);
+            if (mLimit == 0 || mUsed < mLimit) {
+                mUsed++;
+                return;
+            }
         }
-        if (fmt.back() != '\n')
-            msg += "epicsipmi " + severities[severity] + ": " + fmt + "\n";
-        else
-            msg += "epicsipmi " + severities[severity] + ": " + fmt;
-
-        va_list args;
-        va_start(args, fmt);
-        vprintf(msg.c_str(), args);
-        va_end(args);
+        // Limit might be raised without a release, don't wait forever
+        mEvent.wait(0.1);
     }
 }
 
+void Semaphore::release()
+{
+    {
+        ScopedLock lock(mMutex);
+        if (mUsed > 0)
+            mUsed--;
+    }
+    mEvent.signal();
+}
+
+void LatencyHistogram::add(double seconds)
+{
+    uint64_t usec = (seconds > 0.0 ? static_cast<uint64_t>(seconds * 1e6) : 0);
+    unsigned bucket;
+    if (usec < SUB_BUCKETS) {
+        bucket = usec;
+    } else {
+        /** Highest bit selects the octave, the next SUB_BITS the bucket within it. */
+        unsigned bit = 63 - __builtin_clzll(usec);
+        bucket = (bit - SUB_BITS + 1) * SUB_BUCKETS + ((usec >> (bit - SUB_BITS)) & (SUB_BUCKETS - 1));
+        bucket = std::min(bucket, NUM_BUCKETS - 1);
+    }
+    mBuckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    mSumUsec.fetch_add(usec, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::reset()
+{
+    for (auto& bucket: mBuckets)
+        bucket.store(0, std::memory_order_relaxed);
+    mSumUsec.store(0, std::memory_order_relaxed);
+}
+
+unsigned long LatencyHistogram::getCount() const
+{
+    unsigned long count = 0;
+    for (auto& bucket: mBuckets)
+        count += bucket.load(std::memory_order_relaxed);
+    return count;
+}
+
+double LatencyHistogram::getMean() const
+{
+    unsigned long count = getCount();
+    if (count == 0)
+        return 0.0;
+    return 1e-6 * mSumUsec.load(std::memory_order_relaxed) / count;
+}
+
+double LatencyHistogram::getPercentile(double fraction) const
+{
+    unsigned long counts[NUM_BUCKETS];
+    unsigned long total = 0;
+    for (unsigned i = 0; i < NUM_BUCKETS; i++) {
+        counts[i] = mBuckets[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0)
+        return 0.0;
+
+    unsigned long sum = 0;
+    for (unsigned i = 0; i < NUM_BUCKETS; i++) {
+        sum += counts[i];
+        if (sum >= fraction * total)
+            return getBucketLimit(i);
+    }
+    return getBucketLimit(NUM_BUCKETS - 1);
+}
+
+unsigned long LatencyHistogram::getBucketCount(unsigned bucket) const
+{
+    return (bucket < NUM_BUCKETS ? mBuckets[bucket].load(std::memory_order_relaxed) : 0);
+}
+
+double LatencyHistogram::getBucketLimit(unsigned bucket)
+{
+    if (bucket < SUB_BUCKETS)
+        return 1e-6 * (bucket + 1);
+    unsigned shift = bucket / SUB_BUCKETS - 1;
+    uint64_t upper = static_cast<uint64_t>(SUB_BUCKETS + bucket % SUB_BUCKETS + 1) << shift;
+    return 1e-6 * upper;
+}
+
 }; // namespace common
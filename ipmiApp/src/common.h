@@ -10,10 +10,14 @@
 
 #pragma once
 
+#include <epicsEvent.h>
 #include <epicsGuard.h>
 #include <epicsMutex.h>
 
+#include <atomic>
+#include <cstdint>
 #include <numeric>
+#include <type_traits>
 #include <string>
 #include <vector>
 
@@ -28,8 +32,26 @@ namespace common {
 
 std::string hex_dump(uint8_t const * const buff, unsigned int const pos, size_t const len);
 
+/**
+ * @brief Queue message for the log thread, never blocks on console output.
+ *
+ * Same message repeated within a few seconds is printed once and then
+ * summarized with the number of repeats. Messages exceeding the queue or
+ * the rate limit are dropped and counted.
+ */
 void epicsipmi_log(unsigned severity, const std::string& fmt, ...);
 
+/**
+ * @brief Set most verbose severity printed, 0 disables logging, 4 includes DEBUG.
+ */
+void setLogLevel(unsigned level);
+unsigned getLogLevel();
+
+/**
+ * @brief Print everything queued and pending repeat summaries, for IOC exit.
+ */
+void flushLog();
+
 template <template <class...> class Container, class Type, class ... Allocator>
 std::string merge(const Container<Type, std::allocator<std::string>>& container, const std::string& delimiter=" ")
 {
@@ -68,6 +90,139 @@ struct buffer {
     }
 };
 
+/**
+ * @brief Read-only view of bytes owned by someone else.
+ */
+struct bytes_view {
+    const uint8_t* data{nullptr};
+    unsigned int size{0};
+};
+
 typedef epicsGuard<epicsMutex> ScopedLock;
 
+/**
+ * @class Semaphore
+ * @brief Counting semaphore limiting how many threads run a section at once.
+ */
+class Semaphore {
+    public:
+        /**
+         * @param limit maximum number of concurrent holders, 0 means unlimited
+         */
+        explicit Semaphore(unsigned limit=0);
+        void setLimit(unsigned limit);
+        void acquire();
+        void release();
+    private:
+        epicsMutex mMutex;
+        epicsEvent mEvent;
+        unsigned mLimit;
+        unsigned mUsed{0};
+};
+
+/**
+ * @class LatencyHistogram
+ * @brief Durations counted in log-linear buckets, adding one is a single atomic increment.
+ *
+ * Like HDR histograms, each power of two microseconds is split into
+ * SUB_BUCKETS linear buckets, so durations from 100 us to half an hour
+ * are within 12.5% of their bucket's upper limit. The last bucket takes
+ * everything longer.
+ */
+class LatencyHistogram {
+    public:
+        static const unsigned SUB_BITS = 3;
+        static const unsigned SUB_BUCKETS = 1 << SUB_BITS;
+        static const unsigned MAX_BIT = 30;     //!< Highest bit of microseconds with own buckets
+        static const unsigned NUM_BUCKETS = (MAX_BIT - SUB_BITS + 2) * SUB_BUCKETS;
+
+        void add(double seconds);
+
+        /**
+         * @brief Start counting from scratch, concurrent add() may or may not be counted.
+         */
+        void reset();
+
+        /**
+         * @brief Number of durations added.
+         */
+        unsigned long getCount() const;
+
+        /**
+         * @brief Average of durations added in seconds, 0 when nothing was added.
+         */
+        double getMean() const;
+
+        /**
+         * @brief Upper limit of the bucket holding given fraction of durations.
+         * @param fraction between 0 and 1, 0.99 for 99th percentile
+         * @return seconds, 0 when nothing was added
+         */
+        double getPercentile(double fraction) const;
+
+        /**
+         * @brief Number of durations counted in given bucket.
+         */
+        unsigned long getBucketCount(unsigned bucket) const;
+
+        /**
+         * @brief Upper limit of bucket in seconds.
+         */
+        static double getBucketLimit(unsigned bucket);
+
+    private:
+        std::atomic<unsigned long> mBuckets[NUM_BUCKETS]{};
+        std::atomic<uint64_t> mSumUsec{0};
+};
+
+/**
+ * @class Mailbox
+ * @brief Hands the latest value from one writer to any number of readers.
+ *
+ * Two slots and a sequence number: the writer fills the slot readers are
+ * not pointed at and then flips the sequence, readers copy the current
+ * slot and retry if the writer got to their slot in the meantime. Neither
+ * side locks or allocates, hence T must be trivially copyable.
+ */
+template <typename T>
+class Mailbox {
+    static_assert(std::is_trivially_copyable<T>::value, "Mailbox requires trivially copyable type");
+
+    public:
+        /**
+         * @brief Publish new value, must only be called from one thread at a time.
+         */
+        void publish(const T& value)
+        {
+            /** Odd sequence means the slot after the current one is being written. */
+            const unsigned seq = mSeq.load(std::memory_order_relaxed);
+            mSeq.store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            mSlots[((seq >> 1) + 1) & 1] = value;
+            mSeq.store(seq + 2, std::memory_order_release);
+        }
+
+        /**
+         * @brief Copy the latest published value.
+         * @return false when nothing was published yet
+         */
+        bool read(T& value) const
+        {
+            while (true) {
+                const unsigned seq = mSeq.load(std::memory_order_acquire);
+                if (seq < 2)
+                    return false;
+                value = mSlots[(seq >> 1) & 1];
+                std::atomic_thread_fence(std::memory_order_acquire);
+                /** Our slot is only rewritten when the writer starts its second publish after seq. */
+                if (mSeq.load(std::memory_order_relaxed) - (seq & ~1u) <= 2)
+                    return true;
+            }
+        }
+
+    private:
+        T mSlots[2];
+        std::atomic<unsigned> mSeq{0};
+};
+
 }
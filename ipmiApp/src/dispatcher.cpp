@@ -13,6 +13,9 @@
 #include "print.h"
 #include "dispatcher.h"
 
+#include <alarm.h>
+
+#include <algorithm>
 #include <cstring>
 #include <map>
 #include <string>
@@ -67,7 +70,276 @@ bool connect(const std::string& conn_id, const std::string& hostname,
     return true;
 }
 
-std::shared_ptr<FreeIpmiProvider> checkEntityAddressType(const std::shared_ptr<EntityAddrType> entAddrType)
+unsigned getSdrGeneration(const Handle& handle)
+{
+    if (!handle.conn)
+        return 0;
+    return handle.conn->getSdrGeneration();
+}
+
+bool isPresent(const Handle& handle)
+{
+    if (!handle.conn || !handle.sensor)
+        return true;
+    return handle.conn->isPresent(*handle.sensor);
+}
+
+Provider::Entity getStat(const std::shared_ptr<const EntityAddrType> entAddrType)
+{
+    auto conn = _getConnection(entAddrType->getConnectionId());
+    if (!conn)
+        throw std::invalid_argument("Link field can't find device \'@" + entAddrType->getConnectionId() + "\'");
+
+    double value = 0.0;
+    auto stats = conn->getTaskStats();
+    /** Read once so VAL and the state string agree. */
+    ConnectionState state = conn->getConnectionState();
+    switch (entAddrType->getStat()) {
+        case EntityAddrType::Stat::QUEUE_DEPTH:     value = stats.queued;                                    break;
+        case EntityAddrType::Stat::READ_RATE:       value = stats.rate;                                      break;
+        case EntityAddrType::Stat::ERROR_RATE:      value = stats.errorRate;                                 break;
+        case EntityAddrType::Stat::ERRORS:          value = stats.errors;                                    break;
+        case EntityAddrType::Stat::TIMEOUTS:        value = conn->getTimeoutCount();                         break;
+        case EntityAddrType::Stat::RECONNECTS:      value = conn->getReconnectCount();                       break;
+        case EntityAddrType::Stat::LATENCY_AVG:     value = conn->getLatency().task.getMean() * 1e3;         break;
+        case EntityAddrType::Stat::LATENCY_P99:     value = conn->getLatency().task.getPercentile(0.99) * 1e3; break;
+        case EntityAddrType::Stat::SDR_GENERATION:  value = conn->getSdrGeneration();                        break;
+        case EntityAddrType::Stat::CONNECTED:       value = conn->isConnected();                             break;
+        case EntityAddrType::Stat::STATE:           value = static_cast<int>(state);                         break;
+    }
+
+    Provider::Entity entity;
+    entity.setField<Provider::Entity::VAL>(value);
+    if (entAddrType->getStat() == EntityAddrType::Stat::CONNECTED) {
+        /** bi records read the state mask, longin counters read VAL. */
+        entity.setField<Provider::Entity::STATE_MASK>(static_cast<unsigned>(value));
+    }
+    if (entAddrType->getStat() == EntityAddrType::Stat::STATE) {
+        /** Never connected yet is not an outage. */
+        const char* name = (state == ConnectionState::CONNECTED ? "connected" : conn->getSdrGeneration() == 0 ? "connecting" : "disconnected");
+        entity.setField<Provider::Entity::VAL_STRING>(name);
+    }
+    entity.sevr = epicsSevNone;
+    entity.stat = epicsAlarmNone;
+    return entity;
+}
+
+void addCallbackLatency(const Handle& handle, double seconds)
+{
+    if (!handle.conn)
+        return;
+    handle.conn->getLatency().callback.add(seconds);
+    if (handle.latency)
+        handle.latency->callback.add(seconds);
+}
+
+unsigned getSdrGeneration(const std::string& conn_id)
+{
+    auto conn = _getConnection(conn_id);
+    if (!conn)
+        return 0;
+    return conn->getSdrGeneration();
+}
+
+bool waitForConnections(double timeout)
+{
+    std::vector<std::pair<std::string, std::shared_ptr<FreeIpmiProvider>>> conns;
+    {
+        common::ScopedLock lock(g_mutex);
+        conns.assign(g_connections.begin(), g_connections.end());
+    }
+
+    bool ready = true;
+    epicsTime deadline = epicsTime::getCurrent() + timeout;
+    for (auto& conn: conns) {
+        double remaining = deadline - epicsTime::getCurrent();
+        if (!conn.second->waitReady(remaining > 0 ? remaining : 0)) {
+            LOG_WARN("connection '%s' not ready yet, records will bind once its SDR is loaded", conn.first.c_str());
+            ready = false;
+        }
+    }
+    return ready;
+}
+
+bool shutdown(double timeout)
+{
+    std::vector<std::pair<std::string, std::shared_ptr<FreeIpmiProvider>>> conns;
+    {
+        common::ScopedLock lock(g_mutex);
+        conns.assign(g_connections.begin(), g_connections.end());
+    }
+
+    /** Ask all first so that sessions close concurrently, each on its own thread. */
+    size_t dropped = 0;
+    for (auto& conn: conns)
+        dropped += conn.second->requestStop();
+    /** Release connections waiting for a connect slot, they quit right away. */
+    FreeIpmiProvider::setConnectParallelism(0);
+
+    unsigned stuck = 0;
+    epicsTime deadline = epicsTime::getCurrent() + timeout;
+    for (auto& conn: conns) {
+        double remaining = deadline - epicsTime::getCurrent();
+        if (!conn.second->stopThread(remaining > 0 ? remaining : 0.001)) {
+            LOG_WARN("connection '%s' didn't stop in time, abandoning it", conn.first.c_str());
+            /** Thread still uses it, destroying it on exit would block or crash. */
+            new std::shared_ptr<FreeIpmiProvider>(conn.second);
+            stuck++;
+        }
+    }
+
+    LOG_INFO("stopped %zu connections, %u abandoned, %zu queued tasks dropped", conns.size() - stuck, stuck, dropped);
+    return (stuck == 0);
+}
+
+void setConnectParallelism(unsigned limit)
+{
+    FreeIpmiProvider::setConnectParallelism(limit);
+}
+
+void printConnectReport()
+{
+    std::vector<std::pair<std::string, std::shared_ptr<FreeIpmiProvider>>> conns;
+    {
+        common::ScopedLock lock(g_mutex);
+        conns.assign(g_connections.begin(), g_connections.end());
+    }
+
+    unsigned nReady = 0;
+    double slowest = 0.0;
+    printf("%-16s %-24s %-8s %8s %10s %8s  %s\n", "Connection", "Host", "State", "Attempts", "Connect[s]", "SDR[s]", "Last error");
+    for (auto& conn: conns) {
+        auto stats = conn.second->getConnectStats();
+        double total = stats.connectTime + stats.sdrLoadTime;
+        if (stats.ready) {
+            nReady++;
+            slowest = std::max(slowest, total);
+        }
+        printf("%-16s %-24s %-8s %8u %10.3f %8.3f  %s\n", conn.first.c_str(), stats.hostname.c_str(),
+               (stats.ready ? "READY" : "PENDING"), stats.attempts, stats.connectTime, stats.sdrLoadTime,
+               stats.lastError.c_str());
+    }
+    printf("%u of %zu connections ready, slowest took %.3f s\n", nReady, conns.size(), slowest);
+}
+
+void printUpdateReport()
+{
+    std::vector<std::pair<std::string, std::shared_ptr<FreeIpmiProvider>>> conns;
+    {
+        common::ScopedLock lock(g_mutex);
+        conns.assign(g_connections.begin(), g_connections.end());
+    }
+
+    printf("%-16s %12s %12s %10s\n", "Connection", "Processed", "Suppressed", "Saved[%]");
+    for (auto& conn: conns) {
+        auto stats = conn.second->getTaskStats();
+        unsigned long total = stats.completed + stats.suppressed;
+        printf("%-16s %12lu %12lu %10.1f\n", conn.first.c_str(), stats.completed, stats.suppressed,
+               (total > 0 ? 100.0 * stats.suppressed / total : 0.0));
+    }
+}
+
+void printReport(int level)
+{
+    std::vector<std::pair<std::string, std::shared_ptr<FreeIpmiProvider>>> conns;
+    {
+        common::ScopedLock lock(g_mutex);
+        conns.assign(g_connections.begin(), g_connections.end());
+    }
+
+    printf("  %-16s %6s %8s %8s %8s %8s %8s %8s %10s %8s\n", "Connection", "Queue", "Tasks/s",
+           "p50[ms]", "p90[ms]", "p99[ms]", "Errors", "Timeouts", "Reconnects", "SDR gen");
+    for (auto& conn: conns) {
+        auto stats = conn.second->getTaskStats();
+        auto& latency = conn.second->getLatency().task;
+        printf("  %-16s %6zu %8.1f %8.1f %8.1f %8.1f %8lu %8u %10u %8u\n", conn.first.c_str(), stats.queued, stats.rate,
+               latency.getPercentile(0.5) * 1e3, latency.getPercentile(0.9) * 1e3, latency.getPercentile(0.99) * 1e3,
+               stats.errors, conn.second->getTimeoutCount(), conn.second->getReconnectCount(),
+               conn.second->getSdrGeneration());
+    }
+    if (level < 1)
+        return;
+
+    /** Empty buckets are skipped, the rest with their share of tasks. */
+    for (auto& conn: conns) {
+        auto& latency = conn.second->getLatency().task;
+        unsigned long count = latency.getCount();
+        if (count == 0)
+            continue;
+        printf("  %s task latency\n", conn.first.c_str());
+        for (unsigned i = 0; i < common::LatencyHistogram::NUM_BUCKETS; i++) {
+            unsigned long tasks = latency.getBucketCount(i);
+            if (tasks == 0)
+                continue;
+            printf("    <= %10.3f ms %10lu %5.1f%%\n", common::LatencyHistogram::getBucketLimit(i) * 1e3, tasks,
+                   100.0 * tasks / count);
+        }
+    }
+}
+
+/** One line of percentiles in ms, stages that never happened are skipped. */
+static void printLatency(const char* name, const common::LatencyHistogram& histogram)
+{
+    unsigned long count = histogram.getCount();
+    if (count == 0)
+        return;
+    printf("    %-12s %10lu %9.2f %9.2f %9.2f %9.2f\n", name, count, histogram.getPercentile(0.5) * 1e3,
+           histogram.getPercentile(0.9) * 1e3, histogram.getPercentile(0.99) * 1e3, histogram.getPercentile(1.0) * 1e3);
+}
+
+static void printLatency(const Provider::LatencyStats& stats)
+{
+    printLatency("queue", stats.queue);
+    printLatency("reading", stats.reading);
+    printLatency("thresholds", stats.thresholds);
+    printLatency("hysteresis", stats.hysteresis);
+    printLatency("write", stats.write);
+    printLatency("task", stats.task);
+    printLatency("callback", stats.callback);
+}
+
+void printLatencyReport(int level)
+{
+    std::vector<std::pair<std::string, std::shared_ptr<FreeIpmiProvider>>> conns;
+    {
+        common::ScopedLock lock(g_mutex);
+        conns.assign(g_connections.begin(), g_connections.end());
+    }
+
+    printf("    %-12s %10s %9s %9s %9s %9s\n", "Stage", "Count", "p50[ms]", "p90[ms]", "p99[ms]", "max[ms]");
+    for (auto& conn: conns) {
+        printf("  %s\n", conn.first.c_str());
+        printLatency(conn.second->getLatency());
+        if (level < 1)
+            continue;
+        for (auto& sensor: conn.second->getSensorLatencies()) {
+            printf("  %s %s\n", conn.first.c_str(), sensor.first.c_str());
+            printLatency(*sensor.second);
+        }
+    }
+}
+
+void resetLatency()
+{
+    std::vector<std::pair<std::string, std::shared_ptr<FreeIpmiProvider>>> conns;
+    {
+        common::ScopedLock lock(g_mutex);
+        conns.assign(g_connections.begin(), g_connections.end());
+    }
+
+    for (auto& conn: conns) {
+        conn.second->getLatency().reset();
+        for (auto& sensor: conn.second->getSensorLatencies())
+            sensor.second->reset();
+    }
+}
+
+void setSensorLatency(bool enabled)
+{
+    FreeIpmiProvider::setSensorLatency(enabled);
+}
+
+std::shared_ptr<FreeIpmiProvider> checkEntityAddressType(const std::shared_ptr<const EntityAddrType> entAddrType)
 {
     /** First verify that the Entity Address and Type object is good to go.*/
     if(!entAddrType)
@@ -134,6 +406,20 @@ std::shared_ptr<FreeIpmiProvider> checkEntityAddressType(const std::shared_ptr<E
             break;
         }
 
+        case EntityAddrType::Type::SEL:
+        case EntityAddrType::Type::STATS:
+        {
+            /** Every connection has SEL and statistics, nothing to verify. */
+            break;
+        }
+
+        case EntityAddrType::Type::FRU:
+        {
+            /** Throws when the FRU has no sensors. */
+            conn->getSnapshot(entAddrType);
+            break;
+        }
+
         default:
             throw std::runtime_error("Could not find sensor in map by key \'" + entAddrType->getEntityAddressTypeAsString() + "\'");
             break;
@@ -142,30 +428,90 @@ std::shared_ptr<FreeIpmiProvider> checkEntityAddressType(const std::shared_ptr<E
     return conn;
 }
 
+IOSCANPVT getIoScan(const std::shared_ptr<const EntityAddrType> entAddrType)
+{
+    if(!entAddrType)
+        throw std::runtime_error("EntityAddrType object derrived from record link field is null.");
+
+    auto conn = _getConnection(entAddrType->getConnectionId());
+    if(!conn)
+        throw std::invalid_argument("Link field can't find device \'@" + entAddrType->getConnectionId() + "\'");
+
+    return conn->getIoScan(entAddrType);
+}
+
+const common::Mailbox<Provider::Entity>* addPoll(const std::shared_ptr<const EntityAddrType> entAddrType, double period)
+{
+    if(!entAddrType)
+        throw std::runtime_error("EntityAddrType object derrived from record link field is null.");
+
+    auto conn = _getConnection(entAddrType->getConnectionId());
+    if(!conn)
+        throw std::invalid_argument("Link field can't find device \'@" + entAddrType->getConnectionId() + "\'");
+
+    return conn->addPoll(entAddrType, period);
+}
+
 /** Just veriry that the link field is valid and that we can touch the
  *  objects defined.
 **/
 ///void checkLink(const std::string& address) {
-void checkLink(const std::shared_ptr<EntityAddrType> entAddrType) {
+void checkLink(const std::shared_ptr<const EntityAddrType> entAddrType) {
     
     /** First verify that the Entity Address and Type object is good to go.*/
     checkEntityAddressType(entAddrType);
 }
 
+void resolve(const std::shared_ptr<const EntityAddrType> entAddrType, Handle& handle)
+{
+    handle.sensor = nullptr;
+    handle.sensorKey.clear();
+    handle.snapshot = nullptr;
+    handle.command = nullptr;
+    handle.latency = nullptr;
+    if(entAddrType)
+        handle.conn = _getConnection(entAddrType->getConnectionId());
+
+    checkEntityAddressType(entAddrType);
+
+    if(entAddrType->getEntityAddressType() == EntityAddrType::Type::SENSOR)
+    {
+        handle.sensorKey = entAddrType->getSensorIdAsKey();
+        handle.sensor = handle.conn->findSensorByMapKey(handle.sensorKey);
+        handle.latency = handle.conn->getSensorLatency(handle.sensorKey);
+    }
+    else if(entAddrType->getEntityAddressType() == EntityAddrType::Type::FRU)
+    {
+        handle.snapshot = handle.conn->getSnapshot(entAddrType);
+    }
+    else if(entAddrType->getEntityAddressType() == EntityAddrType::Type::OEM_CMD)
+    {
+        handle.command = handle.conn->getOemCommand(entAddrType);
+    }
+}
+
 ///bool scheduleGet(const std::string& address, const std::function<void()>& cb, Provider::Entity& entity)
-bool scheduleGet(const std::shared_ptr<EntityAddrType> entAddrType, const std::function<void()>& cb, Provider::Entity& entity)
+bool scheduleGet(const Handle& handle, const std::shared_ptr<const EntityAddrType> entAddrType, const std::function<void()>& cb,
+                 common::Mailbox<Provider::Entity>& result, Provider::ChangeFilter* filter)
 {
-    /** First verify that the Entity Address and Type object is good to go.*/
-    auto conn = checkEntityAddressType(entAddrType);
-    return conn->schedule( Provider::Task(entAddrType, cb, entity) );
-    
+    /** Link was verified when the handle was resolved. */
+    if(!handle.conn)
+        throw std::runtime_error("Record link not resolved to a connection.");
+    if(handle.snapshot)
+        return handle.conn->schedule( Provider::Task(entAddrType, cb, result, handle.snapshot) );
+
+    Provider::Task task(entAddrType, cb, result, handle.sensor);
+    task.filter = filter;
+    task.latency = handle.latency.get();
+    return handle.conn->schedule(std::move(task));
 }
 
-bool scheduleWrite(const std::shared_ptr<EntityAddrType> entAddrType, const std::function<void()>& cb, Provider::Entity& entity)
+bool scheduleWrite(const Handle& handle, const std::shared_ptr<const EntityAddrType> entAddrType, const std::function<void()>& cb,
+                   const Provider::Entity& request, common::Mailbox<Provider::Entity>& result)
 {
-    /** First verify that the Entity Address and Type object is good to go.*/
-    auto conn = checkEntityAddressType(entAddrType);
-    return conn->schedule( Provider::Task(entAddrType, cb, entity) );
+    if(!handle.conn)
+        throw std::runtime_error("Record link not resolved to a connection.");
+    return handle.conn->schedule( Provider::Task(entAddrType, cb, result, request, handle.command) );
 }
 
 }; // namespace dispatcher
@@ -10,11 +10,15 @@
 
 #pragma once
 
+#include <dbScan.h>
+
 #include <functional>
 #include <provider.h>
 #include <vector>
 #include "EntityAddrType.h"
 
+class FreeIpmiProvider;
+
 /**
  * @namespace Dispatcher
  * @brief Manages IPMI objects and distributes EPICS shell interfaces or EPICS records requests.
@@ -31,6 +35,21 @@ enum class AuthType {
     NONE,
 };
 
+/**
+ * @brief Connection and entity resolved from a record link.
+ *
+ * Records keep one so that scans don't search for the connection and
+ * the SDR record every time, it's refreshed when the SDR is reloaded.
+ */
+struct Handle {
+    std::shared_ptr<FreeIpmiProvider> conn;
+    std::shared_ptr<IpmiSensorRecComp> sensor;  //!< Only for SENSOR links, keeps its SDR alive.
+    std::string sensorKey;                      //!< Only for SENSOR links.
+    std::shared_ptr<Provider::Snapshot> snapshot; //!< Only for FRU links, shared by all records of the FRU.
+    std::shared_ptr<const Provider::Command> command; //!< Only for OEM_CMD links, handler resolved once.
+    std::shared_ptr<Provider::LatencyStats> latency; //!< Only for SENSOR links when per-sensor latency is enabled.
+};
+
 /**
  * @brief Establishes connection with IPMI sub-system.
  * @param connection_id unique connection id
@@ -40,9 +59,11 @@ enum class AuthType {
  * @param auth_type one of 'none', 'plain', 'md2', 'md5'
  * @param protocol to be used
  * @param privlevel privilege level to use for all queries, one of 'user', 'operator', 'admin'
- * @return true on connection success, false otherwise
+ * @return true when connection was registered, false otherwise
  *
- * For now only IpmiTool implementation is supported by this function.
+ * Connection is established and SDR loaded in the background by the
+ * connection's processing thread, this function doesn't block.
+ * For now only FreeIPMI implementation is supported by this function.
  */
 bool connect(const std::string& connection_id, const std::string& hostname,
              const std::string& username, const std::string& password,
@@ -50,13 +71,134 @@ bool connect(const std::string& connection_id, const std::string& hostname,
              const std::string& privlevel);
 
 
+/**
+ * @brief Returns how many times the connection has loaded its SDR.
+ * @param connection_id unique connection id
+ * @return 0 when connection doesn't exist or SDR was not loaded yet
+ *
+ * Records use this to retry binding to their IPMI entity only when
+ * there's something new to bind to.
+ */
+unsigned getSdrGeneration(const std::string& connection_id);
+
+/**
+ * @brief Returns how many times the handle's connection has loaded its SDR.
+ * @return 0 when handle is not resolved or SDR was not loaded yet
+ */
+unsigned getSdrGeneration(const Handle& handle);
+
+/**
+ * @brief False when the handle's sensor is on a FRU that was hot swapped out or deactivated.
+ *
+ * Cheap check that lets records go to alarm without waiting for a read to time out.
+ */
+bool isPresent(const Handle& handle);
+
+/**
+ * @brief Read one of the module's own counters of the link's connection.
+ * @exception std::invalid_argument when connection doesn't exist
+ *
+ * No IPMI traffic, works while the connection is down.
+ */
+Provider::Entity getStat(const std::shared_ptr<const EntityAddrType> entAddrType);
+
+/**
+ * @brief Count time from task result published until record processed it.
+ */
+void addCallbackLatency(const Handle& handle, double seconds);
+
+/**
+ * @brief Wait for all connections to load their SDR.
+ * @param timeout maximum time in seconds to wait for all connections together
+ * @return true when all connections are ready
+ */
+bool waitForConnections(double timeout);
+
+/**
+ * @brief Limit how many connections establish session and load SDR at once.
+ * @param limit maximum concurrent connects, 0 for unlimited
+ *
+ * Only affects connections that haven't started connecting yet.
+ */
+void setConnectParallelism(unsigned limit);
+
+/**
+ * @brief Stop all connections and close their sessions in parallel.
+ * @param timeout maximum time in seconds to wait for all connections together
+ * @return true when all connections stopped in time
+ *
+ * Queued tasks are dropped. Connections still stuck in an IPMI call
+ * when timeout expires are abandoned and never destroyed.
+ */
+bool shutdown(double timeout);
+
+/**
+ * @brief Print per-connection connect and SDR load times and failures.
+ */
+void printConnectReport();
+
+/**
+ * @brief Print per-connection number of records processed with a result and released unchanged.
+ */
+void printUpdateReport();
+
+/**
+ * @brief Print per-connection task throughput, latency and error counters.
+ * @param level 0 prints one line per connection, higher levels add histogram of task latency
+ */
+void printReport(int level);
+
+/**
+ * @brief Print latency percentiles of each task stage per connection.
+ * @param level 0 prints connections only, 1 adds every sensor with per-sensor latency
+ */
+void printLatencyReport(int level);
+
+/**
+ * @brief Clear latency histograms of all connections and sensors.
+ */
+void resetLatency();
+
+/**
+ * @brief Keep latency of each sensor too, for records that bind afterwards.
+ */
+void setSensorLatency(bool enabled);
+
+/**
+ * @brief Return scan list for records with SCAN set to I/O Intr.
+ * @param entAddrType parsed record link
+ * @return scan list processed when SEL reports new event for the entity
+ * @exception std::runtime_error when connection doesn't exist or entity doesn't support I/O Intr
+ */
+IOSCANPVT getIoScan(const std::shared_ptr<const EntityAddrType> entAddrType);
+
+/**
+ * @brief Have the connection poll the entity on behalf of I/O Intr records.
+ * @param entAddrType parsed record link
+ * @param period in seconds, connection uses the shortest period requested for the same entity
+ * @return mailbox with the latest polled value, shared by all records of the entity
+ * @exception std::runtime_error when connection doesn't exist or entity can't be polled
+ *
+ * Entity is read once per period regardless of how many records use it,
+ * records on its I/O Intr scan list are processed only when the reading changed.
+ */
+const common::Mailbox<Provider::Entity>* addPoll(const std::shared_ptr<const EntityAddrType> entAddrType, double period);
+
 /**
  * @brief Verify that record link is indeed valid IPMI address
  * @param address to be checked
  * @throw Throws exception
  */
 ///void checkLink(const std::string& address);
-void checkLink(const std::shared_ptr<EntityAddrType> entAddrType);
+void checkLink(const std::shared_ptr<const EntityAddrType> entAddrType);
+
+/**
+ * @brief Verify record link and resolve its connection and entity.
+ * @param entAddrType parsed record link
+ * @param handle populated with the connection even when entity can't be found
+ * @throw std::runtime_error when connection or entity doesn't exist
+ */
+void resolve(const std::shared_ptr<const EntityAddrType> entAddrType, Handle& handle);
 
 /**
  * @brief Finds existing IPMI sub-system and schedules asynchronous processing.
@@ -74,7 +216,9 @@ template<typename T>
 bool process(T* rec);
 
 ///bool scheduleGet(const std::string& address, const std::function<void()>& cb, Provider::Entity& entity);
-bool scheduleGet(const std::shared_ptr<EntityAddrType> entAddrType, const std::function<void()>& cb, Provider::Entity& entity);
-bool scheduleWrite(const std::shared_ptr<EntityAddrType> entAddrType, const std::function<void()>& cb, Provider::Entity& entity);
+bool scheduleGet(const Handle& handle, const std::shared_ptr<const EntityAddrType> entAddrType, const std::function<void()>& cb,
+                 common::Mailbox<Provider::Entity>& result, Provider::ChangeFilter* filter=nullptr);
+bool scheduleWrite(const Handle& handle, const std::shared_ptr<const EntityAddrType> entAddrType, const std::function<void()>& cb,
+                   const Provider::Entity& request, common::Mailbox<Provider::Entity>& result);
 
 }; // namespace
@@ -8,9 +8,21 @@
  * @date Oct 2018
  */
 
+#include <aaiRecord.h>
 #include <aiRecord.h>
+#include <biRecord.h>
 #include <boRecord.h>
+#include <longinRecord.h>
+#include <mbbiRecord.h>
+#include <mbbiDirectRecord.h>
+#include <stringinRecord.h>
+#include <waveformRecord.h>
+#include <dbAccess.h>
 #include <dbBase.h>
+#include <dbLock.h>
+#include <dbStaticLib.h>
+#include <dbScan.h>
+#include <menuFtype.h>
 #include <alarm.h>
 #include <callback.h>
 #include <cantProceed.h>
@@ -18,48 +30,236 @@
 #include <epicsExport.h>
 #include <recGbl.h>
 
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
 #include <limits>
+#include <typeinfo>
 
+#include "BootProfiler.h"
 #include "common.h"
+#include "CompletionQueue.h"
 #include "dispatcher.h"
 #include "EntityAddrType.h"
+#include "IpmiSensorRecComp.h"
 #include <sstream>
 #include <iostream>
 #include <memory>
 
 struct IpmiRecord {
     CALLBACK callback;
-    Provider::Entity entity;
-    std::shared_ptr<EntityAddrType> entAddrType{nullptr};
+    common::Mailbox<Provider::Entity> mailbox; //!< Written by the connection thread
+    Provider::Entity entity;    //!< Record's own copy of the latest value
+    std::shared_ptr<const EntityAddrType> entAddrType{nullptr};
+    dispatcher::Handle handle;  //!< Connection and entity resolved at bind time
+    bool bound{false};          //!< Link was verified against the connection's SDR
+    unsigned generation{0};     //!< SDR generation of the last bind attempt
+    const common::Mailbox<Provider::Entity>* polled{nullptr}; //!< On I/O Intr list of an entity polled by the connection
+    bool statesResolved{false}; //!< Discrete state names and severities were taken from the sensor
+    bool ownStates{false};      //!< mbbi states were filled in by device support
+    bool fromSnapshot{false};   //!< FRU status or names, copied from snapshot refreshed by the FRU values record
+    Provider::ChangeFilter filter; //!< Lets connection skip processing when reading didn't change
+    dbCommon* rec{nullptr};
+    const std::type_info* recordType{nullptr}; //!< Selects records printed by each dset's report
+    std::atomic<unsigned long> scans{0};    //!< Reads requested by record processing
+    epicsTime scheduled;                    //!< When the pending read was scheduled
+    epicsTime completed;                    //!< When connection published result, handed over through CompletionQueue
+    std::atomic<double> lastLatency{0.0};   //!< Seconds from scheduling to second pass of last read
+    std::string lastError;                  //!< Guarded by g_recordsMutex, cleared by the next successful read or write
 };
 
+/** All records with IPMI device support, for reports. Only appended
+ *  during iocInit, records are never removed.
+*/
+static epicsMutex g_recordsMutex;
+static std::vector<IpmiRecord*> g_records;
+
+static void setLastError(IpmiRecord* ctx, const std::string& error)
+{
+    common::ScopedLock lock(g_recordsMutex);
+    ctx->lastError = error;
+}
+
+/** Only the record's own processing writes lastError, checking it unlocked is safe. */
+static void clearLastError(IpmiRecord* ctx)
+{
+    if (ctx->lastError.empty())
+        return;
+    common::ScopedLock lock(g_recordsMutex);
+    ctx->lastError.clear();
+}
+
+/** Info tag value, empty when record doesn't have it. */
+static std::string getInfo(dbCommon* rec, const char* name)
+{
+    std::string value;
+    DBENTRY entry;
+    dbInitEntry(pdbbase, &entry);
+    if (dbFindRecord(&entry, rec->name) == 0 && dbFindInfo(&entry, name) == 0)
+        value = dbGetInfoString(&entry);
+    dbFinishEntry(&entry);
+    return value;
+}
+
+/** Deadband from the link takes precedence over the 'ipmi:deadband' info tag,
+ *  'auto' uses sensor's resolution. Only sensor reads are suppressed.
+*/
+static void configureFilter(dbCommon* rec, IpmiRecord* ctx)
+{
+    ctx->filter.deadband = -1.0;
+    if (!ctx->handle.sensor)
+        return;
+
+    bool isAuto = ctx->entAddrType->isDeadbandAuto();
+    double deadband = ctx->entAddrType->getDeadband();
+    if (!isAuto && deadband < 0.0) {
+        std::string info = getInfo(rec, "ipmi:deadband");
+        if (info.empty())
+            return;
+        std::transform(info.begin(), info.end(), info.begin(), ::tolower);
+        isAuto = (info == "auto");
+        deadband = atof(info.c_str());
+    }
+
+    if (isAuto)
+        /** Readings less than one raw count apart are the same reading. */
+        ctx->filter.deadband = ctx->handle.sensor->get_resolution() / 2;
+    else
+        ctx->filter.deadband = deadband;
+
+    std::string maxAge = getInfo(rec, "ipmi:maxage");
+    if (!maxAge.empty())
+        ctx->filter.maxAge = atof(maxAge.c_str());
+}
+
+/** Finish pending read without processing the record, unless it was
+ *  asked to process again meanwhile or a put-notify waits for it.
+ *  Only full processing runs the forward link and completes the notify.
+*/
+static void releaseRecord(CALLBACK* callback, dbCommon* rec)
+{
+    dbScanLock(rec);
+    const bool process = (rec->rpro != 0 || rec->ppn != nullptr);
+    if (!process)
+        rec->pact = 0;
+    else
+        reinterpret_cast<IpmiRecord*>(rec->dpvt)->completed = epicsTime::getCurrent();
+    dbScanUnlock(rec);
+
+    if (process)
+        CompletionQueue::getInstance().request(callback, rec);
+}
+
+/** Verify the record link against the connection's SDR and resolve it.
+ *  The SDR is loaded in the background, so records may come up before their
+ *  connection is ready. Binding is only re-attempted when the connection
+ *  has loaded a new SDR since the previous attempt, otherwise it's just
+ *  a check of the resolved connection's generation counter.
+*/
 template<typename T>
-long initInpRecord(T* rec)
+static bool bindRecord(T* rec, IpmiRecord *ctx)
 {
-    
+    const unsigned generation = (ctx->handle.conn ?
+                                 dispatcher::getSdrGeneration(ctx->handle) :
+                                 dispatcher::getSdrGeneration(ctx->entAddrType->getConnectionId()));
+    if (generation == ctx->generation)
+        return ctx->bound;
+
+    ctx->generation = generation;
+    ctx->bound = false;
+    try {
+        dispatcher::resolve(ctx->entAddrType, ctx->handle);
+        ctx->bound = true;
+        configureFilter(reinterpret_cast<dbCommon*>(rec), ctx);
+    }
+    catch(const std::exception &e) {
+        LOG_ERROR("Record Bind \'" + std::string(rec->name) + "\': " + e.what() + '\n');
+    }
+    return ctx->bound;
+}
+
+template<typename T>
+static long initRecord(T* rec, const char* link)
+{
+    /** Connection is known once the link is parsed, links that don't parse are profiled without one. */
+    BootProfiler::Timer profile("", "", "init_record");
     void *buffer = callocMustSucceed(1, sizeof(IpmiRecord), "ipmi::initGeneric");
     rec->dpvt = new (buffer) IpmiRecord;
+    IpmiRecord *ctx = reinterpret_cast<IpmiRecord*>(rec->dpvt);
+    ctx->filter.release = std::bind(releaseRecord, &ctx->callback, reinterpret_cast<dbCommon*>(rec));
+    ctx->rec = reinterpret_cast<dbCommon*>(rec);
+    ctx->recordType = &typeid(T);
+    {
+        common::ScopedLock lock(g_recordsMutex);
+        g_records.push_back(ctx);
+    }
 
-    std::shared_ptr<EntityAddrType> eaddrt = nullptr;
     try {
-        /** The connection has already been initialized and the SDR read.
-         * So this call will not only verify the connection is correct but
-         * it will also verify that the Sensor exist.
-        */
-        eaddrt = std::make_shared<EntityAddrType>(rec->inp.value.instio.string);
-        
-        dispatcher::checkLink(eaddrt);
-        IpmiRecord *ctx = reinterpret_cast<IpmiRecord*>(rec->dpvt);
-        ctx->entAddrType = eaddrt;
+        ctx->entAddrType = EntityAddrType::intern(link);
+        profile.setConnection(ctx->entAddrType->getConnectionId());
     }
     catch(const std::exception &e) {
         LOG_ERROR("Record Init \'" + std::string(rec->name) + "\': " + e.what() + '\n');
         return -1;
     }
+
+    if (dispatcher::getSdrGeneration(ctx->entAddrType->getConnectionId()) == 0) {
+        LOG_INFO("Record Init \'" + std::string(rec->name) + "\': connection \'" +
+                 ctx->entAddrType->getConnectionId() + "\' not ready, will bind when SDR is loaded\n");
+    } else if (!bindRecord(rec, ctx)) {
+        return -1;
+    }
+
+    profile.done();
     return 0;
 }
 
-static long processAiRecord(aiRecord* rec)
+template<typename T>
+long initInpRecord(T* rec)
+{
+    return initRecord(rec, rec->inp.value.instio.string);
+}
+
+/** Poll period from the link takes precedence over the 'ipmi:poll' info tag. */
+static double getPollPeriod(dbCommon* rec, const std::shared_ptr<const EntityAddrType>& entAddrType)
+{
+    if (entAddrType->getPollPeriod() > 0.0)
+        return entAddrType->getPollPeriod();
+
+    return atof(getInfo(rec, "ipmi:poll").c_str());
+}
+
+static long getIoIntInfo(int cmd, dbCommon* rec, IOSCANPVT* io)
+{
+    IpmiRecord *ctx = reinterpret_cast<IpmiRecord*>(rec->dpvt);
+    if (ctx == nullptr || ctx->entAddrType == nullptr)
+        return -1;
+
+    try {
+        *io = dispatcher::getIoScan(ctx->entAddrType);
+
+        /** Connection keeps polling after the record leaves I/O Intr,
+         *  other records may still depend on it.
+        */
+        ctx->polled = nullptr;
+        double period = getPollPeriod(rec, ctx->entAddrType);
+        if (cmd == 0 && period > 0.0)
+            ctx->polled = dispatcher::addPoll(ctx->entAddrType, period);
+    }
+    catch(const std::exception &e) {
+        LOG_ERROR("Record I/O Intr \'" + std::string(rec->name) + "\': " + e.what() + '\n');
+        return -1;
+    }
+    return 0;
+}
+
+/** First pass of input record processing schedules the read, polled
+ *  I/O Intr records take the connection's latest value right away.
+ *  @return 1 on second pass when ctx->entity has new value, 0 when read
+ *          was scheduled, -1 on error
+*/
+template<typename T>
+static long readInpRecord(T* rec)
 {
     IpmiRecord *ctx = reinterpret_cast<IpmiRecord*>(rec->dpvt);
     
@@ -71,38 +271,77 @@ static long processAiRecord(aiRecord* rec)
         return -1;
     }
 
-    /** We never fully initialized. Maybe the device was offline during IOC boot,
-     *  which kept the entityAddrType from getting created.
-     *  Let's try to get the entityAddrType again and recover.
-    */
+    /** Link couldn't be parsed, nothing will fix that at runtime. */
     if(ctx->entAddrType == nullptr) {
-        std::shared_ptr<EntityAddrType> eaddrt = nullptr;
-        try
-        {
-            eaddrt = std::make_shared<EntityAddrType>(rec->inp.value.instio.string);
-            dispatcher::checkLink(eaddrt);
-            ctx->entAddrType = eaddrt;
+        recGblSetSevr(rec, epicsAlarmUDF, epicsSevInvalid);
+        return -1;
+    }
+
+    /** Module's own counters, read right away and available while the connection is down. */
+    if(ctx->entAddrType->getEntityAddressType() == EntityAddrType::Type::STATS) {
+        ctx->scans++;
+        try {
+            ctx->entity = dispatcher::getStat(ctx->entAddrType);
+        } catch (const std::exception &e) {
+            setLastError(ctx, e.what());
+            recGblSetSevr(rec, epicsAlarmUDF, epicsSevInvalid);
+            return -1;
         }
-        catch(const std::exception &e)
-        {
-            LOG_ERROR("Record Process \'" + std::string(rec->name) +
-            "\': failed to parse inout string - " + e.what() + '\n');
+        clearLastError(ctx);
+        return 1;
+    }
+
+    /** Connection not ready or the entity is not in its SDR (yet). */
+    if(!bindRecord(rec, ctx)) {
+        setLastError(ctx, "not bound to connection's SDR");
+        recGblSetSevr(rec, epicsAlarmComm, epicsSevInvalid);
+        return -1;
+    }
+
+    /** FRU was hot swapped out, don't wait for the read to time out. */
+    if(!dispatcher::isPresent(ctx->handle)) {
+        setLastError(ctx, "FRU not present");
+        recGblSetSevr(rec, epicsAlarmComm, epicsSevInvalid);
+        return -1;
+    }
+
+    /** Snapshot is refreshed by the FRU values record. */
+    if (ctx->fromSnapshot)
+        return 1;
+
+    /** Connection already read it, no need to queue a task. */
+    if (ctx->polled && rec->pact == 0) {
+        ctx->scans++;
+        if (!ctx->polled->read(ctx->entity)) {
+            recGblSetSevr(rec, epicsAlarmUDF, epicsSevInvalid);
             return -1;
         }
+        if (ctx->entity.sevr == epicsSevInvalid)
+            setLastError(ctx, "read failed");
+        else
+            clearLastError(ctx);
+        return 1;
     }
-    
+
     if (rec->pact == 0) {
         rec->pact = 1;
+        ctx->scans++;
+        ctx->scheduled = epicsTime::getCurrent();
 
-        std::function<void()> cb = std::bind(callbackRequestProcessCallback, &ctx->callback, rec->prio, rec);
+        std::function<void()> cb = [ctx, rec]() {
+            ctx->completed = epicsTime::getCurrent();
+            CompletionQueue::getInstance().request(&ctx->callback, reinterpret_cast<dbCommon*>(rec));
+        };
 
         try
         {
-            dispatcher::scheduleGet(ctx->entAddrType, cb, ctx->entity);
+            dispatcher::scheduleGet(ctx->handle, ctx->entAddrType, cb, ctx->mailbox,
+                                    (ctx->filter.deadband >= 0.0 ? &ctx->filter : nullptr));
         }
         catch(const std::exception& e)
         {
             LOG_ERROR("Record Process \'" + std::string(rec->name) + "\': " + e.what() + '\n');
+            setLastError(ctx, e.what());
             recGblSetSevr(rec, epicsAlarmUDF, epicsSevInvalid);
 
             /** Try again, next time around*/
@@ -115,65 +354,403 @@ static long processAiRecord(aiRecord* rec)
 
     // This is the second pass, we got new value now update the record
     rec->pact = 0;
+    epicsTime now = epicsTime::getCurrent();
+    ctx->lastLatency = now - ctx->scheduled;
+    dispatcher::addCallbackLatency(ctx->handle, now - ctx->completed);
+    ctx->mailbox.read(ctx->entity);
+    if (ctx->entity.sevr == epicsSevInvalid)
+        setLastError(ctx, "read failed");
+    else
+        clearLastError(ctx);
+    return 1;
+}
+
+/** Alarm limits rarely change, only write them and notify monitors when they do.
+ *  @return true when limit or its severity changed
+*/
+template<typename T, typename L, typename S>
+static bool updateLimit(T* rec, L& limit, S& severity, double value, int sevr)
+{
+    bool changed = false;
+    if (limit != value) {
+        limit = value;
+        db_post_events(rec, &limit, DBE_VALUE | DBE_LOG);
+        changed = true;
+    }
+    if (severity != sevr) {
+        severity = sevr;
+        db_post_events(rec, &severity, DBE_VALUE | DBE_LOG);
+        changed = true;
+    }
+    return changed;
+}
+
+static long processAiRecord(aiRecord* rec)
+{
+    long status = readInpRecord(rec);
+    if (status != 1)
+        return status;
 
-    rec->val = ctx->entity.getField<double>("VAL", rec->val);
+    IpmiRecord *ctx = reinterpret_cast<IpmiRecord*>(rec->dpvt);
+
+    rec->val = ctx->entity.getField<Provider::Entity::VAL>(rec->val);
     /**
      * Use the 'THRESHOLDS' to check the readable bits that are associated.
-     * int thresholds = ctx->entity.getField<int>("THRESHOLDS", 0);
+     * int thresholds = ctx->entity.getField<Provider::Entity::THRESHOLDS_READABLE>(0);
      * */
     /** Do we have thresholds? Check the readable status bits to find out.
      *  also, these are only available on threshold-type sensors.
     */
 
-    if(ctx->entity.hasField("HIHI"))
+    bool changed = false;
+    if(ctx->entity.hasField<Provider::Entity::HIHI>())
+        changed |= updateLimit(rec, rec->hihi, rec->hhsv, ctx->entity.getField<Provider::Entity::HIHI>(rec->hihi), MAJOR_ALARM);
+    if(ctx->entity.hasField<Provider::Entity::HIGH>())
+        changed |= updateLimit(rec, rec->high, rec->hsv, ctx->entity.getField<Provider::Entity::HIGH>(rec->high), MINOR_ALARM);
+    if(ctx->entity.hasField<Provider::Entity::LOW>())
+        changed |= updateLimit(rec, rec->low, rec->lsv, ctx->entity.getField<Provider::Entity::LOW>(rec->low), MINOR_ALARM);
+    if(ctx->entity.hasField<Provider::Entity::LOLO>())
+        changed |= updateLimit(rec, rec->lolo, rec->llsv, ctx->entity.getField<Provider::Entity::LOLO>(rec->lolo), MAJOR_ALARM);
+    if(ctx->entity.hasField<Provider::Entity::HYST>() && rec->hyst != ctx->entity.getField<Provider::Entity::HYST>(rec->hyst))
     {
-        rec->hihi = ctx->entity.getField<double>("HIHI", rec->hihi);
-        rec->hhsv = MAJOR_ALARM;
+        rec->hyst = ctx->entity.getField<Provider::Entity::HYST>(rec->hyst);
+        db_post_events(rec, &rec->hyst, DBE_VALUE | DBE_LOG);
+        changed = true;
     }
-    if(ctx->entity.hasField("HIGH"))
-    {
-        rec->high = ctx->entity.getField<double>("HIGH", rec->high);
-        rec->hsv = MINOR_ALARM;
+
+#ifdef DBE_PROPERTY
+    /** Tell clients to re-read the control and alarm limits. */
+    if(changed)
+        db_post_events(rec, &rec->val, DBE_PROPERTY);
+#endif
+
+    (void)recGblSetSevr(rec, ctx->entity.stat, ctx->entity.sevr);
+
+    return 2;
+}
+
+static long processStringinRecord(stringinRecord* rec)
+{
+    long status = readInpRecord(rec);
+    if (status != 1)
+        return status;
+
+    IpmiRecord *ctx = reinterpret_cast<IpmiRecord*>(rec->dpvt);
+    std::string val = ctx->entity.getField<Provider::Entity::VAL_STRING>(std::string());
+    strncpy(rec->val, val.c_str(), sizeof(rec->val) - 1);
+    rec->val[sizeof(rec->val) - 1] = '\0';
+
+    (void)recGblSetSevr(rec, ctx->entity.stat, ctx->entity.sevr);
+
+    return 0;
+}
+
+/** Severity of a discrete state given the sensor's reading type, follows
+ *  the meaning of generic reading types in IPMI specification Table 42-2.
+ *  Sensor specific states carry no severity.
+*/
+static epicsEnum16 getStateSeverity(uint8_t readingType, unsigned offset)
+{
+    switch (readingType) {
+    case IPMI_EVENT_READING_TYPE_CODE_STATE:                // Deasserted, Asserted
+    case IPMI_EVENT_READING_TYPE_CODE_PREDICTIVE_FAILURE:   // Deasserted, Asserted
+        return (offset == 1 ? MINOR_ALARM : NO_ALARM);
+    case IPMI_EVENT_READING_TYPE_CODE_LIMIT:                // Not Exceeded, Exceeded
+        return (offset == 1 ? MAJOR_ALARM : NO_ALARM);
+    case IPMI_EVENT_READING_TYPE_CODE_TRANSITION_SEVERITY:
+        if (offset == 1 || offset == 4)                     // to Non-Critical
+            return MINOR_ALARM;
+        if (offset == 2 || offset == 3 || offset == 5 || offset == 6) // to Critical or Non-recoverable
+            return MAJOR_ALARM;
+        return NO_ALARM;
+    case IPMI_EVENT_READING_TYPE_CODE_DEVICE_PRESENT:       // Removed, Inserted
+    case IPMI_EVENT_READING_TYPE_CODE_DEVICE_ENABLED:       // Disabled, Enabled
+        return (offset == 0 ? MINOR_ALARM : NO_ALARM);
+    default:
+        return NO_ALARM;
     }
-    if(ctx->entity.hasField("LOW"))
-    {
-        rec->low = ctx->entity.getField<double>("LOW", rec->low);
-        rec->lsv = MINOR_ALARM;
+}
+
+/** Number of states in discrete sensor's mask, bit 15 is reserved. */
+static const unsigned MAX_STATES = 15;
+
+/** Name the states from the sensor, unless the database already did. */
+static void resolveStates(mbbiRecord* rec, IpmiRecord* ctx)
+{
+    epicsUInt32 *values = &rec->zrvl;
+    char (*strings)[sizeof(rec->zrst)] = &rec->zrst;
+    epicsEnum16 *severities = &rec->zrsv;
+
+    for (unsigned i = 0; i < 16; i++) {
+        if (values[i] != 0 || strings[i][0] != '\0')
+            return;
     }
-    if(ctx->entity.hasField("LOLO"))
-    {
-        rec->lolo = ctx->entity.getField<double>("LOLO", rec->lolo);
-        rec->llsv = MAJOR_ALARM;
+
+    const IpmiSensorRecComp &sensor = *ctx->handle.sensor;
+    for (unsigned i = 0; i < MAX_STATES; i++) {
+        std::string state = sensor.get_state_string(i);
+        if (state.empty())
+            continue;
+        values[i] = 1u << i;
+        strncpy(strings[i], state.c_str(), sizeof(rec->zrst) - 1);
+        severities[i] = getStateSeverity(sensor.get_event_reading_type_code(), i);
+        ctx->ownStates = true;
     }
 
-    auto sevr = ctx->entity.getField<int>("SEVR", epicsSevNone);
-    auto stat = ctx->entity.getField<int>("STAT", epicsAlarmNone);
-    (void)recGblSetSevr(rec, stat, sevr);
+    /** Unnamed slots would otherwise match an empty mask with value 0,
+     *  the slot of reserved bit 15 names that case instead.
+     */
+    if (ctx->ownStates) {
+        for (unsigned i = 0; i < MAX_STATES; i++)
+            values[i] = 1u << i;
+        values[MAX_STATES] = 0;
+        strncpy(strings[MAX_STATES], "No state asserted", sizeof(rec->zrst) - 1);
+        severities[MAX_STATES] = NO_ALARM;
+    }
+    rec->sdef = (ctx->ownStates ? 1 : 0);
 
-    return 2;
+#ifdef DBE_PROPERTY
+    /** Clients connected before the SDR was loaded need the new strings. */
+    if (ctx->ownStates)
+        db_post_events(rec, &rec->val, DBE_PROPERTY);
+#endif
 }
 
-static long initBoRecord(boRecord* rec)
+/** Single bit MASK selects one state, name it and its complement. */
+static void resolveStates(biRecord* rec, IpmiRecord* ctx)
 {
-    void *buffer = callocMustSucceed(1, sizeof(IpmiRecord), "ipmi::initGeneric");
-    rec->dpvt = new (buffer) IpmiRecord;
+    if (rec->mask == 0 || (rec->mask & (rec->mask - 1)) != 0 || rec->onam[0] != '\0' || rec->znam[0] != '\0')
+        return;
 
-    std::shared_ptr<EntityAddrType> eaddrt = nullptr;
-    try {
-        /** The connection has already been initialized and the SDR read.
-         * So this call will not only verify the connection is correct but
-         * it will also verify that the Sensor exist.
-        */
-        eaddrt = std::make_shared<EntityAddrType>(rec->out.value.instio.string);
-        dispatcher::checkLink(eaddrt);
-        
-        IpmiRecord *ctx = reinterpret_cast<IpmiRecord*>(rec->dpvt);
-        ctx->entAddrType = eaddrt;
+    const IpmiSensorRecComp &sensor = *ctx->handle.sensor;
+    unsigned offset = 0;
+    while ((rec->mask >> offset) != 1)
+        offset++;
+
+    std::string state = sensor.get_state_string(offset);
+    strncpy(rec->onam, state.c_str(), sizeof(rec->onam) - 1);
+    rec->osv = getStateSeverity(sensor.get_event_reading_type_code(), offset);
+
+    /** Generic two-state types pair offsets 0 and 1. */
+    if (offset == 1 && IPMI_EVENT_READING_TYPE_CODE_IS_GENERIC(sensor.get_event_reading_type_code())) {
+        state = sensor.get_state_string(0);
+        strncpy(rec->znam, state.c_str(), sizeof(rec->znam) - 1);
+        rec->zsv = getStateSeverity(sensor.get_event_reading_type_code(), 0);
     }
-    catch(const std::exception &e) {
-        LOG_ERROR("Record Init \'" + std::string(rec->name) + "\': " + e.what() + '\n');
+
+#ifdef DBE_PROPERTY
+    db_post_events(rec, &rec->val, DBE_PROPERTY);
+#endif
+}
+
+/** States are resolved once, as soon as the record binds to its sensor. */
+template<typename T>
+static void resolveRecordStates(T* rec)
+{
+    IpmiRecord *ctx = reinterpret_cast<IpmiRecord*>(rec->dpvt);
+    if (ctx == nullptr || ctx->statesResolved || !ctx->bound || !ctx->handle.sensor)
+        return;
+
+    resolveStates(rec, ctx);
+    ctx->statesResolved = true;
+}
+
+template<typename T>
+static long initDiscreteRecord(T* rec)
+{
+    long status = initInpRecord(rec);
+    if (status == 0)
+        resolveRecordStates(rec);
+    return status;
+}
+
+/** Discrete sensors report asserted states as a bit mask, threshold sensors
+ *  report their threshold event states the same way.
+*/
+static epicsUInt32 getStateMask(const IpmiRecord* ctx, epicsUInt32 mask)
+{
+    epicsUInt32 states = ctx->entity.getField<Provider::Entity::STATE_MASK>(0u);
+    return (mask != 0 ? states & mask : states);
+}
+
+static long processBiRecord(biRecord* rec)
+{
+    long status = readInpRecord(rec);
+    if (status != 1)
+        return status;
+
+    IpmiRecord *ctx = reinterpret_cast<IpmiRecord*>(rec->dpvt);
+    resolveRecordStates(rec);
+    rec->rval = getStateMask(ctx, rec->mask);
+
+    (void)recGblSetSevr(rec, ctx->entity.stat, ctx->entity.sevr);
+
+    return 0;
+}
+
+static long processMbbiRecord(mbbiRecord* rec)
+{
+    long status = readInpRecord(rec);
+    if (status != 1)
+        return status;
+
+    IpmiRecord *ctx = reinterpret_cast<IpmiRecord*>(rec->dpvt);
+    resolveRecordStates(rec);
+    epicsUInt32 states = getStateMask(ctx, rec->mask);
+
+    /** More states may be asserted at once, show the most severe one. */
+    if (ctx->ownStates && states != 0) {
+        const epicsEnum16 *severities = &rec->zrsv;
+        unsigned selected = MAX_STATES;
+        for (unsigned i = 0; i < MAX_STATES; i++) {
+            if ((states & (1u << i)) && (selected == MAX_STATES || severities[i] > severities[selected]))
+                selected = i;
+        }
+        states = 1u << selected;
+    }
+    rec->rval = states;
+
+    (void)recGblSetSevr(rec, ctx->entity.stat, ctx->entity.sevr);
+
+    return 0;
+}
+
+static long processMbbiDirectRecord(mbbiDirectRecord* rec)
+{
+    long status = readInpRecord(rec);
+    if (status != 1)
+        return status;
+
+    IpmiRecord *ctx = reinterpret_cast<IpmiRecord*>(rec->dpvt);
+    rec->rval = getStateMask(ctx, rec->mask);
+
+    (void)recGblSetSevr(rec, ctx->entity.stat, ctx->entity.sevr);
+
+    return 0;
+}
+
+static long processLonginRecord(longinRecord* rec)
+{
+    long status = readInpRecord(rec);
+    if (status != 1)
+        return status;
+
+    IpmiRecord *ctx = reinterpret_cast<IpmiRecord*>(rec->dpvt);
+    if (ctx->entAddrType->getEntityAddressType() == EntityAddrType::Type::STATS) {
+        /** Counters outgrow the 16 bit state mask. */
+        rec->val = static_cast<epicsInt32>(ctx->entity.getField<Provider::Entity::VAL>(rec->val));
+    } else {
+        rec->val = getStateMask(ctx, 0);
+    }
+
+    (void)recGblSetSevr(rec, ctx->entity.stat, ctx->entity.sevr);
+
+    return 0;
+}
+
+/** FRU links need array type matching the selected field, SEL needs characters. */
+template<typename T>
+static long initArrayRecord(T* rec)
+{
+    long status = initRecord(rec, rec->inp.value.instio.string);
+    IpmiRecord *ctx = reinterpret_cast<IpmiRecord*>(rec->dpvt);
+    if (status != 0)
+        return status;
+
+    bool valid = false;
+    if (ctx->entAddrType->getEntityAddressType() != EntityAddrType::Type::FRU) {
+        valid = (rec->ftvl == menuFtypeCHAR || rec->ftvl == menuFtypeUCHAR);
+    } else {
+        switch (ctx->entAddrType->getFruField()) {
+        case EntityAddrType::FruField::VALUES:
+            valid = (rec->ftvl == menuFtypeDOUBLE || rec->ftvl == menuFtypeFLOAT);
+            break;
+        case EntityAddrType::FruField::STATUS:
+            valid = (rec->ftvl == menuFtypeSHORT || rec->ftvl == menuFtypeUSHORT);
+            ctx->fromSnapshot = true;
+            break;
+        case EntityAddrType::FruField::NAMES:
+            valid = (rec->ftvl == menuFtypeSTRING);
+            ctx->fromSnapshot = true;
+            break;
+        }
+    }
+
+    if (!valid) {
+        LOG_ERROR("Record Init \'" + std::string(rec->name) + "\': FTVL doesn't match link type\n");
         return -1;
     }
+    return 0;
+}
+
+/** Copy array selected by FRU link, in the same sensor order for all fields. */
+template<typename T>
+static void copySnapshot(T* rec, IpmiRecord* ctx)
+{
+    Provider::Snapshot &snapshot = *ctx->handle.snapshot;
+    common::ScopedLock lock(snapshot.mutex);
+    const size_t n = std::min<size_t>(snapshot.sensors.size(), rec->nelm);
+
+    switch (ctx->entAddrType->getFruField()) {
+    case EntityAddrType::FruField::VALUES:
+        for (size_t i = 0; i < n; i++) {
+            if (rec->ftvl == menuFtypeFLOAT)
+                reinterpret_cast<epicsFloat32*>(rec->bptr)[i] = snapshot.values[i];
+            else
+                reinterpret_cast<epicsFloat64*>(rec->bptr)[i] = snapshot.values[i];
+        }
+        break;
+    case EntityAddrType::FruField::STATUS:
+        for (size_t i = 0; i < n; i++)
+            reinterpret_cast<epicsUInt16*>(rec->bptr)[i] = snapshot.severities[i];
+        break;
+    case EntityAddrType::FruField::NAMES:
+        for (size_t i = 0; i < n; i++) {
+            char *name = reinterpret_cast<char*>(rec->bptr) + i * MAX_STRING_SIZE;
+            strncpy(name, snapshot.names[i].c_str(), MAX_STRING_SIZE - 1);
+            name[MAX_STRING_SIZE - 1] = '\0';
+        }
+        break;
+    }
+    rec->nord = n;
+
+    /** STATUS and NAMES records don't read, alarm is that of the read which filled the snapshot. */
+    if (ctx->fromSnapshot) {
+        ctx->entity.stat = snapshot.stat;
+        ctx->entity.sevr = snapshot.sevr;
+    }
+}
+
+template<typename T>
+static long processArrayRecord(T* rec)
+{
+    long status = readInpRecord(rec);
+    if (status != 1)
+        return status;
+
+    IpmiRecord *ctx = reinterpret_cast<IpmiRecord*>(rec->dpvt);
+    if (ctx->handle.snapshot) {
+        copySnapshot(rec, ctx);
+    } else {
+        std::string val = ctx->entity.getField<Provider::Entity::VAL_STRING>(std::string());
+        if (rec->nelm > 0) {
+            size_t len = std::min<size_t>(val.size(), rec->nelm - 1);
+            memcpy(rec->bptr, val.c_str(), len);
+            reinterpret_cast<char*>(rec->bptr)[len] = '\0';
+            rec->nord = len + 1;
+        }
+    }
+
+    (void)recGblSetSevr(rec, ctx->entity.stat, ctx->entity.sevr);
+
+    return 0;
+}
+
+static long initBoRecord(boRecord* rec)
+{
+    long status = initRecord(rec, rec->out.value.instio.string);
+    if (status != 0)
+        return status;
 
     rec->rval = 0;
     return 0;
@@ -193,41 +770,41 @@ static long processBoRecord(boRecord* rec)
         return -1;
     }
 
-    /** We never fully initialized. Maybe the device was offline during IOC boot,
-     *  which kept the entityAddrType from getting created.
-     *  Let's try to get the entityAddrType again and recover.
-    */
+    /** Link couldn't be parsed, nothing will fix that at runtime. */
     if(ctx->entAddrType == nullptr)
     {
-        std::shared_ptr<EntityAddrType> eaddrt = nullptr;
-        try
-        {
-            eaddrt = std::make_shared<EntityAddrType>(rec->out.value.instio.string);
-            dispatcher::checkLink(eaddrt);
-            ctx->entAddrType = eaddrt;
-        }
-        catch(const std::exception &e)
-        {
-            LOG_ERROR("Record Process \'" + std::string(rec->name) +
-            "\': failed to parse inout string - " + e.what() + '\n');
-            return -1;
-        }
+        recGblSetSevr(rec, epicsAlarmUDF, epicsSevInvalid);
+        return -1;
+    }
+
+    /** Connection not ready or the entity is not in its SDR (yet). */
+    if(!bindRecord(rec, ctx))
+    {
+        recGblSetSevr(rec, epicsAlarmComm, epicsSevInvalid);
+        return -1;
     }
     
     if (rec->pact == 0)
     {
         rec->pact = 1;
-        std::function<void()> cb = std::bind(callbackRequestProcessCallback, &ctx->callback, rec->prio, rec);
+        ctx->scans++;
+        ctx->scheduled = epicsTime::getCurrent();
+        std::function<void()> cb = [ctx, rec]() {
+            ctx->completed = epicsTime::getCurrent();
+            CompletionQueue::getInstance().request(&ctx->callback, reinterpret_cast<dbCommon*>(rec));
+        };
         try
         {
             ///TODO: I am not sure if we are going to need a callback or not. But for now we use it.
             /// Currently, the only ouput is a reboot command that doed not return anything.
-            ctx->entity["VAL"] = rec->val;
-            dispatcher::scheduleWrite(ctx->entAddrType, cb, ctx->entity);
+            Provider::Entity request;
+            request.setField<Provider::Entity::VAL>(rec->val);
+            dispatcher::scheduleWrite(ctx->handle, ctx->entAddrType, cb, request, ctx->mailbox);
         }
         catch(const std::exception& e)
         {
             LOG_ERROR("Record Process \'" + std::string(rec->name) + "\': " + e.what() + '\n');
+            setLastError(ctx, e.what());
             recGblSetSevr(rec, epicsAlarmUDF, epicsSevInvalid);
 
             /** Try again, next time around*/
@@ -240,10 +817,52 @@ static long processBoRecord(boRecord* rec)
 
     // This is the second pass, we got new value now update the record
     rec->pact = 0;
+    epicsTime now = epicsTime::getCurrent();
+    ctx->lastLatency = now - ctx->scheduled;
+    dispatcher::addCallbackLatency(ctx->handle, now - ctx->completed);
+    ctx->mailbox.read(ctx->entity);
+    if (ctx->entity.sevr != epicsSevNone) {
+        /** Provider logged the details, stat tells timeout, refused or failed to send. */
+        if (ctx->entity.hasField<Provider::Entity::COMP_CODE>()) {
+            char error[40];
+            snprintf(error, sizeof(error), "write refused, completion code 0x%02X",
+                     ctx->entity.getField<Provider::Entity::COMP_CODE>(0u));
+            setLastError(ctx, error);
+        } else {
+            setLastError(ctx, "write failed");
+        }
+        recGblSetSevr(rec, ctx->entity.stat, ctx->entity.sevr);
+    } else {
+        clearLastError(ctx);
+    }
+
+    return 0;
+}
 
+/** Per-record counters of the dset's record type, printed at level 1 and up. */
+template<typename T>
+static long reportRecords(int level)
+{
+    if (level < 1)
+        return 0;
+
+    common::ScopedLock lock(g_recordsMutex);
+    for (auto ctx: g_records) {
+        if (*ctx->recordType != typeid(T))
+            continue;
+        printf("    %-40s scans=%lu latency=%.1fms%s%s\n", ctx->rec->name, ctx->scans.load(),
+               ctx->lastLatency * 1e3, (ctx->lastError.empty() ? "" : " error="), ctx->lastError.c_str());
+    }
     return 0;
 }
 
+/** dbior calls every dset's report, connections are printed once from ai. */
+static long reportAiRecords(int level)
+{
+    dispatcher::printReport(level);
+    return reportRecords<aiRecord>(level);
+}
+
 extern "C" {
 
 struct {
@@ -256,10 +875,10 @@ struct {
    DEVSUPFUN       special_linconv;
 } devEpicsIpmiAi = {
    6, // number
-   NULL,                                // report
+   (DEVSUPFUN)reportAiRecords,          // report
    NULL,                                // once-per-IOC initialization
    (DEVSUPFUN)initInpRecord<aiRecord>,  // once-per-record initialization
-   NULL,                                // get_ioint_info
+   (DEVSUPFUN)getIoIntInfo,             // get_ioint_info
    (DEVSUPFUN)processAiRecord,
    NULL                                 // special_linconv
 };
@@ -274,7 +893,7 @@ struct {
    DEVSUPFUN       write_bo;
 } devEpicsIpmiBo = {
    5, // number
-   NULL,                                // report
+   (DEVSUPFUN)reportRecords<boRecord>,  // report
    NULL,                                // once-per-IOC initialization
    (DEVSUPFUN)initBoRecord,  // once-per-record initialization
    NULL,                                // get_ioint_info
@@ -282,6 +901,125 @@ struct {
 };
 epicsExportAddress(dset, devEpicsIpmiBo);
 
+struct {
+   long            number;
+   DEVSUPFUN       report;
+   DEVSUPFUN       init;
+   DEVSUPFUN       init_record;
+   DEVSUPFUN       get_ioint_info;
+   DEVSUPFUN       read_stringin;
+} devEpicsIpmiStringin = {
+   5, // number
+   (DEVSUPFUN)reportRecords<stringinRecord>, // report
+   NULL,                                // once-per-IOC initialization
+   (DEVSUPFUN)initInpRecord<stringinRecord>, // once-per-record initialization
+   (DEVSUPFUN)getIoIntInfo,             // get_ioint_info
+   (DEVSUPFUN)processStringinRecord
+};
+epicsExportAddress(dset, devEpicsIpmiStringin);
+
+struct {
+   long            number;
+   DEVSUPFUN       report;
+   DEVSUPFUN       init;
+   DEVSUPFUN       init_record;
+   DEVSUPFUN       get_ioint_info;
+   DEVSUPFUN       read_wf;
+} devEpicsIpmiWaveform = {
+   5, // number
+   (DEVSUPFUN)reportRecords<waveformRecord>, // report
+   NULL,                                // once-per-IOC initialization
+   (DEVSUPFUN)initArrayRecord<waveformRecord>, // once-per-record initialization
+   (DEVSUPFUN)getIoIntInfo,             // get_ioint_info
+   (DEVSUPFUN)processArrayRecord<waveformRecord>
+};
+epicsExportAddress(dset, devEpicsIpmiWaveform);
+
+struct {
+   long            number;
+   DEVSUPFUN       report;
+   DEVSUPFUN       init;
+   DEVSUPFUN       init_record;
+   DEVSUPFUN       get_ioint_info;
+   DEVSUPFUN       read_aai;
+} devEpicsIpmiAai = {
+   5, // number
+   (DEVSUPFUN)reportRecords<aaiRecord>, // report
+   NULL,                                // once-per-IOC initialization
+   (DEVSUPFUN)initArrayRecord<aaiRecord>, // once-per-record initialization
+   (DEVSUPFUN)getIoIntInfo,             // get_ioint_info
+   (DEVSUPFUN)processArrayRecord<aaiRecord>
+};
+epicsExportAddress(dset, devEpicsIpmiAai);
+
+struct {
+   long            number;
+   DEVSUPFUN       report;
+   DEVSUPFUN       init;
+   DEVSUPFUN       init_record;
+   DEVSUPFUN       get_ioint_info;
+   DEVSUPFUN       read_bi;
+} devEpicsIpmiBi = {
+   5, // number
+   (DEVSUPFUN)reportRecords<biRecord>,  // report
+   NULL,                                // once-per-IOC initialization
+   (DEVSUPFUN)initDiscreteRecord<biRecord>, // once-per-record initialization
+   (DEVSUPFUN)getIoIntInfo,             // get_ioint_info
+   (DEVSUPFUN)processBiRecord
+};
+epicsExportAddress(dset, devEpicsIpmiBi);
+
+struct {
+   long            number;
+   DEVSUPFUN       report;
+   DEVSUPFUN       init;
+   DEVSUPFUN       init_record;
+   DEVSUPFUN       get_ioint_info;
+   DEVSUPFUN       read_mbbi;
+} devEpicsIpmiMbbi = {
+   5, // number
+   (DEVSUPFUN)reportRecords<mbbiRecord>, // report
+   NULL,                                // once-per-IOC initialization
+   (DEVSUPFUN)initDiscreteRecord<mbbiRecord>, // once-per-record initialization
+   (DEVSUPFUN)getIoIntInfo,             // get_ioint_info
+   (DEVSUPFUN)processMbbiRecord
+};
+epicsExportAddress(dset, devEpicsIpmiMbbi);
+
+struct {
+   long            number;
+   DEVSUPFUN       report;
+   DEVSUPFUN       init;
+   DEVSUPFUN       init_record;
+   DEVSUPFUN       get_ioint_info;
+   DEVSUPFUN       read_mbbi;
+} devEpicsIpmiMbbiDirect = {
+   5, // number
+   (DEVSUPFUN)reportRecords<mbbiDirectRecord>, // report
+   NULL,                                // once-per-IOC initialization
+   (DEVSUPFUN)initInpRecord<mbbiDirectRecord>, // once-per-record initialization
+   (DEVSUPFUN)getIoIntInfo,             // get_ioint_info
+   (DEVSUPFUN)processMbbiDirectRecord
+};
+epicsExportAddress(dset, devEpicsIpmiMbbiDirect);
+
+struct {
+   long            number;
+   DEVSUPFUN       report;
+   DEVSUPFUN       init;
+   DEVSUPFUN       init_record;
+   DEVSUPFUN       get_ioint_info;
+   DEVSUPFUN       read_longin;
+} devEpicsIpmiLongin = {
+   5, // number
+   (DEVSUPFUN)reportRecords<longinRecord>, // report
+   NULL,                                // once-per-IOC initialization
+   (DEVSUPFUN)initInpRecord<longinRecord>, // once-per-record initialization
+   (DEVSUPFUN)getIoIntInfo,             // get_ioint_info
+   (DEVSUPFUN)processLonginRecord
+};
+epicsExportAddress(dset, devEpicsIpmiLongin);
+
 
 
 }; // extern "C"
@@ -8,14 +8,23 @@
  * @date Oct 2018
  */
 
+#include "BootProfiler.h"
 #include "common.h"
+#include "CompletionQueue.h"
 #include "dispatcher.h"
+#include "IpmiSelReader.h"
 
+#include <cstdio>
 #include <map>
 
+#include <epicsExit.h>
 #include <epicsExport.h>
+#include <initHooks.h>
 #include <iocsh.h>
 
+static double g_initWait = 0.0; //!< Max time iocInit waits for connections to load their SDR
+static double g_shutdownTimeout = 5.0; //!< Max time IOC exit waits for connections to close their sessions
+
 // ipmiConnect(conn_id, host_name, [username], [password], [protocol], [privlevel])
 static const iocshArg ipmiConnectArg0 = { "connection id",  iocshArgString };
 static const iocshArg ipmiConnectArg1 = { "host name",      iocshArgString };
@@ -76,12 +85,211 @@ extern "C" void ipmiConnectCallFunc(const iocshArgBuf* args) {
     dispatcher::connect(conn_id, hostname, username, password, authType, protocol, privLevel);
 }
 
+// ipmiInitWait(timeout)
+static const iocshArg ipmiInitWaitArg0 = { "timeout",      iocshArgDouble };
+static const iocshArg* ipmiInitWaitArgs[] = {
+    &ipmiInitWaitArg0
+};
+static const iocshFuncDef ipmiInitWaitFuncDef = { "ipmiInitWait", 1, ipmiInitWaitArgs };
+
+extern "C" void ipmiInitWaitCallFunc(const iocshArgBuf* args) {
+    if (args[0].dval < 0) {
+        printf("Usage: ipmiInitWait <timeout>\n");
+        printf("Maximum seconds iocInit waits for all connections to load their SDR, 0 means don't wait\n");
+        return;
+    }
+    g_initWait = args[0].dval;
+}
+
+// ipmiConnectParallel(limit)
+static const iocshArg ipmiConnectParallelArg0 = { "limit",      iocshArgInt };
+static const iocshArg* ipmiConnectParallelArgs[] = {
+    &ipmiConnectParallelArg0
+};
+static const iocshFuncDef ipmiConnectParallelFuncDef = { "ipmiConnectParallel", 1, ipmiConnectParallelArgs };
+
+extern "C" void ipmiConnectParallelCallFunc(const iocshArgBuf* args) {
+    if (args[0].ival < 0) {
+        printf("Usage: ipmiConnectParallel <limit>\n");
+        printf("Maximum connections establishing session and loading SDR at once, 0 means unlimited\n");
+        return;
+    }
+    dispatcher::setConnectParallelism(args[0].ival);
+}
+
+// ipmiShutdownTimeout(seconds)
+static const iocshArg ipmiShutdownTimeoutArg0 = { "seconds",      iocshArgDouble };
+static const iocshArg* ipmiShutdownTimeoutArgs[] = {
+    &ipmiShutdownTimeoutArg0
+};
+static const iocshFuncDef ipmiShutdownTimeoutFuncDef = { "ipmiShutdownTimeout", 1, ipmiShutdownTimeoutArgs };
+
+extern "C" void ipmiShutdownTimeoutCallFunc(const iocshArgBuf* args) {
+    if (args[0].dval <= 0) {
+        printf("Usage: ipmiShutdownTimeout <seconds>\n");
+        printf("Maximum seconds IOC exit waits for all connections to close their sessions\n");
+        return;
+    }
+    g_shutdownTimeout = args[0].dval;
+}
+
+// ipmiLogLevel(level)
+static const iocshArg ipmiLogLevelArg0 = { "level",      iocshArgInt };
+static const iocshArg* ipmiLogLevelArgs[] = {
+    &ipmiLogLevelArg0
+};
+static const iocshFuncDef ipmiLogLevelFuncDef = { "ipmiLogLevel", 1, ipmiLogLevelArgs };
+
+extern "C" void ipmiLogLevelCallFunc(const iocshArgBuf* args) {
+    if (args[0].ival < 0 || args[0].ival > 4) {
+        printf("Usage: ipmiLogLevel <level>\n");
+        printf("Most verbose messages printed: 0 none, 1 ERROR, 2 WARN, 3 INFO, 4 DEBUG (currently %u)\n", common::getLogLevel());
+        return;
+    }
+    common::setLogLevel(args[0].ival);
+}
+
+// ipmiLatencyReport([level])
+static const iocshArg ipmiLatencyReportArg0 = { "level",      iocshArgInt };
+static const iocshArg* ipmiLatencyReportArgs[] = {
+    &ipmiLatencyReportArg0
+};
+static const iocshFuncDef ipmiLatencyReportFuncDef = { "ipmiLatencyReport", 1, ipmiLatencyReportArgs };
+
+extern "C" void ipmiLatencyReportCallFunc(const iocshArgBuf* args) {
+    dispatcher::printLatencyReport(args[0].ival);
+}
+
+// ipmiLatencyReset()
+static const iocshFuncDef ipmiLatencyResetFuncDef = { "ipmiLatencyReset", 0, nullptr };
+
+extern "C" void ipmiLatencyResetCallFunc(const iocshArgBuf* args) {
+    dispatcher::resetLatency();
+}
+
+// ipmiLatencyPerSensor(enable)
+static const iocshArg ipmiLatencyPerSensorArg0 = { "enable",      iocshArgInt };
+static const iocshArg* ipmiLatencyPerSensorArgs[] = {
+    &ipmiLatencyPerSensorArg0
+};
+static const iocshFuncDef ipmiLatencyPerSensorFuncDef = { "ipmiLatencyPerSensor", 1, ipmiLatencyPerSensorArgs };
+
+extern "C" void ipmiLatencyPerSensorCallFunc(const iocshArgBuf* args) {
+    if (args[0].ival < 0 || args[0].ival > 1) {
+        printf("Usage: ipmiLatencyPerSensor <0|1>\n");
+        printf("Keep latency histograms of each sensor too, affects records bound afterwards\n");
+        return;
+    }
+    dispatcher::setSensorLatency(args[0].ival == 1);
+}
+
+// ipmiConnectAll([timeout])
+static const iocshArg ipmiConnectAllArg0 = { "timeout",      iocshArgDouble };
+static const iocshArg* ipmiConnectAllArgs[] = {
+    &ipmiConnectAllArg0
+};
+static const iocshFuncDef ipmiConnectAllFuncDef = { "ipmiConnectAll", 1, ipmiConnectAllArgs };
+
+extern "C" void ipmiConnectAllCallFunc(const iocshArgBuf* args) {
+    if (args[0].dval < 0) {
+        printf("Usage: ipmiConnectAll [timeout]\n");
+        printf("Wait for all connections to load their SDR and print summary, 0 only prints summary\n");
+        return;
+    }
+    if (args[0].dval > 0)
+        dispatcher::waitForConnections(args[0].dval);
+    dispatcher::printConnectReport();
+}
+
+// ipmiSelPollPeriod(seconds)
+static const iocshArg ipmiSelPollPeriodArg0 = { "seconds",      iocshArgDouble };
+static const iocshArg* ipmiSelPollPeriodArgs[] = {
+    &ipmiSelPollPeriodArg0
+};
+static const iocshFuncDef ipmiSelPollPeriodFuncDef = { "ipmiSelPollPeriod", 1, ipmiSelPollPeriodArgs };
+
+extern "C" void ipmiSelPollPeriodCallFunc(const iocshArgBuf* args) {
+    if (args[0].dval < 0) {
+        printf("Usage: ipmiSelPollPeriod <seconds>\n");
+        printf("How often to check SEL for new events, 0 disables SEL reading\n");
+        return;
+    }
+    IpmiSelReader::setPollPeriod(args[0].dval);
+}
+
+// ipmiUpdateReport()
+static const iocshFuncDef ipmiUpdateReportFuncDef = { "ipmiUpdateReport", 0, nullptr };
+
+extern "C" void ipmiUpdateReportCallFunc(const iocshArgBuf* args) {
+    dispatcher::printUpdateReport();
+}
+
+// ipmiCompletionReport()
+static const iocshFuncDef ipmiCompletionReportFuncDef = { "ipmiCompletionReport", 0, nullptr };
+
+extern "C" void ipmiCompletionReportCallFunc(const iocshArgBuf* args) {
+    auto stats = CompletionQueue::getInstance().getStats();
+    printf("Records processed: %lu in %lu batches, largest batch %zu\n", stats.processed, stats.batches, stats.maxBatch);
+    printf("Ring: %zu entries, highest occupancy %zu, overflows to EPICS callback queue %lu\n",
+           stats.capacity, stats.maxQueued, stats.overflows);
+    printf("Completion latency: avg %.6f s, max %.6f s\n", stats.avgLatency, stats.maxLatency);
+}
+
+// ipmiBootReport([json file])
+static const iocshArg ipmiBootReportArg0 = { "json file",    iocshArgString };
+static const iocshArg* ipmiBootReportArgs[] = {
+    &ipmiBootReportArg0
+};
+static const iocshFuncDef ipmiBootReportFuncDef = { "ipmiBootReport", 1, ipmiBootReportArgs };
+
+extern "C" void ipmiBootReportCallFunc(const iocshArgBuf* args) {
+    if (args[0].sval == nullptr || args[0].sval[0] == '\0') {
+        BootProfiler::getInstance().print();
+        return;
+    }
+
+    FILE* file = fopen(args[0].sval, "w");
+    if (file == nullptr) {
+        printf("ERROR: Can't open '%s' for writing\n", args[0].sval);
+        return;
+    }
+    fputs(BootProfiler::getInstance().toJson().c_str(), file);
+    fclose(file);
+}
+
+static void ipmiInitHook(initHookState state)
+{
+    if (state == initHookAtBeginning && g_initWait > 0) {
+        dispatcher::waitForConnections(g_initWait);
+    }
+}
+
+static void ipmiAtExit(void*)
+{
+    dispatcher::shutdown(g_shutdownTimeout);
+    common::flushLog();
+}
+
 static void epicsipmiRegistrar ()
 {
     static bool initialized  = false;
     if (!initialized) {
         initialized = false;
         iocshRegister(&ipmiConnectFuncDef, ipmiConnectCallFunc);
+        iocshRegister(&ipmiInitWaitFuncDef, ipmiInitWaitCallFunc);
+        iocshRegister(&ipmiConnectParallelFuncDef, ipmiConnectParallelCallFunc);
+        iocshRegister(&ipmiConnectAllFuncDef, ipmiConnectAllCallFunc);
+        iocshRegister(&ipmiShutdownTimeoutFuncDef, ipmiShutdownTimeoutCallFunc);
+        iocshRegister(&ipmiLogLevelFuncDef, ipmiLogLevelCallFunc);
+        iocshRegister(&ipmiLatencyReportFuncDef, ipmiLatencyReportCallFunc);
+        iocshRegister(&ipmiLatencyResetFuncDef, ipmiLatencyResetCallFunc);
+        iocshRegister(&ipmiLatencyPerSensorFuncDef, ipmiLatencyPerSensorCallFunc);
+        iocshRegister(&ipmiSelPollPeriodFuncDef, ipmiSelPollPeriodCallFunc);
+        iocshRegister(&ipmiUpdateReportFuncDef, ipmiUpdateReportCallFunc);
+        iocshRegister(&ipmiCompletionReportFuncDef, ipmiCompletionReportCallFunc);
+        iocshRegister(&ipmiBootReportFuncDef, ipmiBootReportCallFunc);
+        initHookRegister(ipmiInitHook);
+        epicsAtExit(ipmiAtExit, nullptr);
     }
 }
 
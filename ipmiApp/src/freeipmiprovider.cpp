@@ -13,6 +13,13 @@
 #include <sstream>
 #include "IpmiException.h"
 
+#include <alarm.h>
+
+/** Plenty for a crate full of boards, yet avoids hundreds of sessions
+ *  hammering the network and the IOC at boot.
+ */
+common::Semaphore FreeIpmiProvider::sConnectSlots(16);
+std::atomic<bool> FreeIpmiProvider::sSensorLatency{false};
 
 FreeIpmiProvider::FreeIpmiProvider(const std::string& conn_id, const std::string& hostname,
                                    const std::string& username, const std::string& password,
@@ -25,9 +32,13 @@ FreeIpmiProvider::FreeIpmiProvider(const std::string& conn_id, const std::string
     authtype, protocol, privlevel);
 
     mSdrManager = new IpmiSdrManager(*mConnManager);
+    mSelReader = new IpmiSelReader(*mConnManager, *mSdrManager);
+    scanIoInit(&mSelScan);
+    mConnectStats.hostname = hostname;
 
-    ///TODO: Check that the info is there before we print it.
-    std::cout << mSdrManager->getHeaderAsString() << std::endl;
+    /** Connecting and reading the SDR is done by the processing thread,
+     *  the constructor only registers the connection.
+    */
     start();
 }
 
@@ -37,12 +48,61 @@ FreeIpmiProvider::~FreeIpmiProvider()
         LOG_WARN("Processing thread did not stop");
 }
 
+bool FreeIpmiProvider::isReady()
+{
+    return mSdrManager->sdrStateIsInitialized();
+}
+
+unsigned FreeIpmiProvider::getSdrGeneration()
+{
+    return mSdrManager->getGeneration();
+}
+
+bool FreeIpmiProvider::waitReady(double timeout)
+{
+    if(isReady())
+        return true;
+    mReadyEvent.wait(timeout);
+    return isReady();
+}
+
+FreeIpmiProvider::ConnectStats FreeIpmiProvider::getConnectStats()
+{
+    common::ScopedLock lock(mStatsMutex);
+    return mConnectStats;
+}
+
+unsigned FreeIpmiProvider::getReconnectCount()
+{
+    return mConnManager->getReconnectCount();
+}
+
+unsigned FreeIpmiProvider::getTimeoutCount()
+{
+    return mConnManager->getTimeoutCount();
+}
+
+bool FreeIpmiProvider::isConnected()
+{
+    return mConnManager->isConnected();
+}
+
+ConnectionState FreeIpmiProvider::getConnectionState()
+{
+    return mConnManager->getConnectionState();
+}
+
+void FreeIpmiProvider::setConnectParallelism(unsigned limit)
+{
+    sConnectSlots.setLimit(limit);
+}
+
 bool FreeIpmiProvider::is_valid_oem_cmd(const std::string &vendor_id, const std::string &command)
 {
     return mConnManager->is_valid_oem_command(vendor_id, command);
 }
 
-FreeIpmiProvider::Entity FreeIpmiProvider::getEntityValue(const std::shared_ptr<EntityAddrType> entAddrType) {
+FreeIpmiProvider::Entity FreeIpmiProvider::getEntityValue(const std::shared_ptr<const EntityAddrType> entAddrType) {
 
     if(!entAddrType) {
         throw std::runtime_error("In method FreeIpmiProvider::getEntityValue(...) EntityAddrType parameter is null.");
@@ -62,6 +122,10 @@ FreeIpmiProvider::Entity FreeIpmiProvider::getEntityValue(const std::shared_ptr<
         ///TODO: Finish getPicmgLedReading(entAddrType);
         ///entity = getPicmgLedReading(entAddrType);
         break;
+
+    case EntityAddrType::Type::SEL:
+        entity = getSelEvent();
+        break;
     
     default:
         throw std::runtime_error("Invalid Entity address type \'" + entAddrType->getEntityAddressTypeAsString() + "\'");
@@ -71,12 +135,21 @@ FreeIpmiProvider::Entity FreeIpmiProvider::getEntityValue(const std::shared_ptr<
     return entity;
 }
 
-void FreeIpmiProvider::write_oem_command(const std::shared_ptr<EntityAddrType> entAddrType, Entity &entity)
+std::shared_ptr<const FreeIpmiProvider::Command> FreeIpmiProvider::getOemCommand(const std::shared_ptr<const EntityAddrType> entAddrType)
 {
-    mConnManager->write_oem_command(entAddrType, entity);
+    auto [vendorId, command, cmdArgs] = entAddrType->get_oem_command();
+    auto handler = IpmiConnectionManager::findOemHandler(vendorId, command);
+    if (!handler)
+        return nullptr;
+
+    /** Connections live as long as the IOC, entAddrType is immutable and keeps the arguments. */
+    auto connManager = mConnManager;
+    return std::make_shared<const Command>([connManager, handler, entAddrType](Entity &entity) {
+        connManager->write_oem_command(handler, std::get<2>(entAddrType->get_oem_command()), entity);
+    });
 }
 
-FreeIpmiProvider::Entity FreeIpmiProvider::getPicmgLedReading(const std::shared_ptr<EntityAddrType> entAddrType) {
+FreeIpmiProvider::Entity FreeIpmiProvider::getPicmgLedReading(const std::shared_ptr<const EntityAddrType> entAddrType) {
     
     throw std::runtime_error("getPicmgLedReading() is unsupported currently...");
     if(!entAddrType) {
@@ -97,7 +170,7 @@ FreeIpmiProvider::Entity FreeIpmiProvider::getPicmgLedReading(const std::shared_
     ///return readPicmgLed(this->m_ctx.ipmi,led);
 }
 
-FreeIpmiProvider::Entity FreeIpmiProvider::getSensorReading(const std::shared_ptr<EntityAddrType> entAddrType) {
+FreeIpmiProvider::Entity FreeIpmiProvider::getSensorReading(const std::shared_ptr<const EntityAddrType> entAddrType) {
 
     
     if(!entAddrType) {
@@ -115,6 +188,328 @@ FreeIpmiProvider::Entity FreeIpmiProvider::getSensorReading(const std::shared_pt
     
 }
 
+bool FreeIpmiProvider::readSensorValue(const std::shared_ptr<IpmiSensorRecComp> sensor, Entity& entity, ReadError& error,
+                                       WireTime& wire) {
+
+    return mConnManager->tryReadSensor(sensor, entity, error, &wire);
+}
+
+std::shared_ptr<FreeIpmiProvider::LatencyStats> FreeIpmiProvider::getSensorLatency(const std::string& sensorKey) {
+
+    if (!sSensorLatency)
+        return nullptr;
+
+    common::ScopedLock lock(mLatencyMutex);
+    auto &stats = mSensorLatencies[sensorKey];
+    if (!stats)
+        stats = std::make_shared<LatencyStats>();
+    return stats;
+}
+
+std::map<std::string, std::shared_ptr<FreeIpmiProvider::LatencyStats>> FreeIpmiProvider::getSensorLatencies() {
+
+    common::ScopedLock lock(mLatencyMutex);
+    return mSensorLatencies;
+}
+
+void FreeIpmiProvider::setSensorLatency(bool enabled) {
+
+    sSensorLatency = enabled;
+}
+
+std::string FreeIpmiProvider::formatReadError(const IpmiSensorRecComp& sensor, const ReadError& error) {
+
+    return mConnManager->formatReadError(sensor, error);
+}
+
+std::shared_ptr<FreeIpmiProvider::Snapshot> FreeIpmiProvider::getSnapshot(const std::shared_ptr<const EntityAddrType> entAddrType) {
+
+    if (entAddrType->getEntityAddressType() != EntityAddrType::Type::FRU)
+        throw std::runtime_error("Snapshot not supported for \'" + entAddrType->getEntityAddressTypeAsString() + "\'");
+
+    const std::string key = entAddrType->getFruKey();
+    std::shared_ptr<Snapshot> snapshot;
+    {
+        common::ScopedLock lock(mScanMutex);
+        auto &slot = mSnapshots[key];
+        if (!slot)
+            slot.reset(new Snapshot);
+        snapshot = slot;
+    }
+
+    const unsigned generation = mSdrManager->getGeneration();
+    common::ScopedLock lock(snapshot->mutex);
+    if (snapshot->generation != generation) {
+        snapshot->sensors = mSdrManager->findFruSensors(key);
+        snapshot->names.clear();
+        for (auto &sensor : snapshot->sensors)
+            snapshot->names.push_back(sensor->get_device_id_string());
+        snapshot->values.assign(snapshot->sensors.size(), 0.0);
+        snapshot->severities.assign(snapshot->sensors.size(), epicsSevInvalid);
+        snapshot->generation = generation;
+    }
+
+    if (snapshot->sensors.empty())
+        throw std::runtime_error("Could not find sensors of FRU \'" + (key.empty() ? std::string("*") : key) + "\'");
+    return snapshot;
+}
+
+/** Threshold readings are checked against their own limits, discrete ones carry no severity. */
+static int getReadingSeverity(const Provider::Entity &reading)
+{
+    const double value = reading.getField<Provider::Entity::VAL>(0.0);
+    if ((reading.hasField<Provider::Entity::HIHI>() && value >= reading.getField<Provider::Entity::HIHI>(0.0)) ||
+        (reading.hasField<Provider::Entity::LOLO>() && value <= reading.getField<Provider::Entity::LOLO>(0.0)))
+        return epicsSevMajor;
+    if ((reading.hasField<Provider::Entity::HIGH>() && value >= reading.getField<Provider::Entity::HIGH>(0.0)) ||
+        (reading.hasField<Provider::Entity::LOW>() && value <= reading.getField<Provider::Entity::LOW>(0.0)))
+        return epicsSevMinor;
+    return epicsSevNone;
+}
+
+FreeIpmiProvider::Entity FreeIpmiProvider::readSnapshot(Snapshot &snapshot) {
+
+    std::vector<std::shared_ptr<IpmiSensorRecComp>> sensors;
+    unsigned generation;
+    {
+        common::ScopedLock lock(snapshot.mutex);
+        sensors = snapshot.sensors;
+        generation = snapshot.generation;
+    }
+
+    /** Records may copy from the snapshot meanwhile, don't hold the lock while reading. */
+    std::vector<double> values(sensors.size(), 0.0);
+    std::vector<int> severities(sensors.size(), epicsSevInvalid);
+    unsigned failed = 0;
+    for (size_t i = 0; i < sensors.size(); i++) {
+        try
+        {
+            Entity reading;
+            ReadError error;
+            WireTime wire;
+            bool read = mConnManager->tryReadSensor(sensors[i], reading, error, &wire);
+            getLatency().add(wire);
+            if (!read)
+            {
+                failed++;
+                continue;
+            }
+            values[i] = reading.getField<Entity::VAL>(0.0);
+            severities[i] = getReadingSeverity(reading);
+        }
+        catch (const std::exception &e)
+        {
+            failed++;
+        }
+    }
+
+    Entity entity;
+    entity.setField<Entity::COUNT>(sensors.size());
+    entity.setField<Entity::VAL>(failed);
+    if (failed == sensors.size()) {
+        entity.sevr = epicsSevInvalid;
+        entity.stat = epicsAlarmComm;
+    }
+
+    {
+        common::ScopedLock lock(snapshot.mutex);
+        /** Sensors were resolved again from a new SDR, these readings don't match them. */
+        if (snapshot.generation == generation) {
+            snapshot.values.swap(values);
+            snapshot.severities.swap(severities);
+            snapshot.stat = entity.stat;
+            snapshot.sevr = entity.sevr;
+        }
+    }
+    return entity;
+}
+
+FreeIpmiProvider::Entity FreeIpmiProvider::getSelEvent() {
+
+    Entity entity;
+    uint32_t timestamp = 0;
+    unsigned count = 0;
+    entity.setField<Entity::VAL_STRING>(mSelReader->getLastEvent(timestamp, count));
+    entity.setField<Entity::TIMESTAMP>(timestamp);
+    entity.setField<Entity::COUNT>(count);
+    return entity;
+}
+
+IOSCANPVT FreeIpmiProvider::getIoScan(const std::shared_ptr<const EntityAddrType> entAddrType) {
+
+    switch (entAddrType->getEntityAddressType()) {
+
+    case EntityAddrType::Type::SEL:
+        return mSelScan;
+
+    case EntityAddrType::Type::SENSOR:
+    {
+        /** Records may register before the SDR is loaded, key is all we need. */
+        common::ScopedLock lock(mScanMutex);
+        auto it = mSensorScans.find(entAddrType->getSensorIdAsKey());
+        if (it == mSensorScans.end()) {
+            IOSCANPVT scan;
+            scanIoInit(&scan);
+            it = mSensorScans.insert({entAddrType->getSensorIdAsKey(), scan}).first;
+        }
+        return it->second;
+    }
+
+    default:
+        throw std::runtime_error("I/O Intr not supported for \'" + entAddrType->getEntityAddressTypeAsString() + "\'");
+    }
+}
+
+const common::Mailbox<FreeIpmiProvider::Entity>* FreeIpmiProvider::addPoll(const std::shared_ptr<const EntityAddrType> entAddrType, double period) {
+
+    if (entAddrType->getEntityAddressType() != EntityAddrType::Type::SENSOR)
+        throw std::runtime_error("Polling not supported for \'" + entAddrType->getEntityAddressTypeAsString() + "\'");
+
+    const std::string key = entAddrType->getSensorIdAsKey();
+    common::Mailbox<Entity>* mailbox;
+    {
+        common::ScopedLock lock(mScanMutex);
+        auto &slot = mPolledValues[key];
+        if (!slot)
+            slot.reset(new common::Mailbox<Entity>);
+        mailbox = slot.get();
+    }
+
+    mPoller.add(key, period);
+    return mailbox;
+}
+
+void FreeIpmiProvider::processPoll() {
+
+    for(auto &key : mPoller.advance()) {
+        Entity entity;
+        bool read = false;
+        try
+        {
+            /** Failing reads are common during outages, don't pay for exceptions. */
+            std::shared_ptr<IpmiSensorRecComp> sp = mSdrManager->findSensorByMapKey(key);
+            ReadError error;
+            WireTime wire;
+            read = (sp && isPresent(*sp) && mConnManager->tryReadSensor(sp, entity, error, &wire));
+            getLatency().add(wire);
+        }
+        catch(const std::exception& e)
+        {
+            read = false;
+        }
+        entity.sevr = (read ? epicsSevNone : epicsSevInvalid);
+        entity.stat = (read ? epicsAlarmNone : epicsAlarmComm);
+
+        common::Mailbox<Entity>* mailbox;
+        IOSCANPVT scan = nullptr;
+        {
+            common::ScopedLock lock(mScanMutex);
+            mailbox = mPolledValues[key].get();
+            auto it = mSensorScans.find(key);
+            if(it != mSensorScans.end())
+                scan = it->second;
+        }
+
+        /** One read per sensor, records only get woken up when there's something new. */
+        Entity previous;
+        if(mailbox->read(previous) && previous == entity)
+            continue;
+        mailbox->publish(entity);
+
+        if(scan)
+            scanIoRequest(scan);
+    }
+}
+
+void FreeIpmiProvider::processSel() {
+
+    uint32_t timestamp;
+    unsigned before, after;
+    std::vector<std::string> sensors;
+    mSelReader->getLastEvent(timestamp, before);
+    try
+    {
+        sensors = mSelReader->process();
+    }
+    catch(const std::exception& e)
+    {
+        LOG_DEBUG("SEL read failed for \'" + mConnManager->getConnectionId() + "\' - " + e.what());
+    }
+    mSelReader->getLastEvent(timestamp, after);
+
+    if(after != before)
+        scanIoRequest(mSelScan);
+
+    processHotSwap(mSelReader->getHotSwapEvents());
+
+    common::ScopedLock lock(mScanMutex);
+    for(auto &key : sensors) {
+        auto it = mSensorScans.find(key);
+        if(it != mSensorScans.end())
+            scanIoRequest(it->second);
+    }
+}
+
+void FreeIpmiProvider::processHotSwap(const std::vector<IpmiSelReader::HotSwapEvent>& events) {
+
+    /** Device may have been power cycled, what was missing should be tried again. */
+    if(mConnManager->getReconnectCount() != mReconnects)
+    {
+        mReconnects = mConnManager->getReconnectCount();
+        common::ScopedLock lock(mPresenceMutex);
+        mAbsentFrus.clear();
+        mAbsentCount = 0;
+    }
+
+    for(auto &event : events)
+    {
+        /** M4 active and M5 deactivation requested still have payload power,
+         *  anything else can't be read until the FRU reaches M4 again. */
+        const bool active = (event.state == 4 || event.state == 5);
+        const uint16_t fru = (event.entityId << 8) | event.entityInstance;
+        bool changed;
+        {
+            common::ScopedLock lock(mPresenceMutex);
+            changed = (active ? mAbsentFrus.erase(fru) > 0 : mAbsentFrus.insert(fru).second);
+            mAbsentCount = mAbsentFrus.size();
+        }
+        if(!changed)
+            continue;
+
+        const std::string fruKey = std::to_string(event.entityId) + ":" + std::to_string(event.entityInstance);
+        LOG_INFO("FRU %s on \'%s\' %s (M%u)", fruKey.c_str(), mConnManager->getConnectionId().c_str(),
+                 (active ? "activated" : "deactivated"), (unsigned) event.state);
+
+        /** Sensors come and go with the FRU, records bind to new ones with the next SDR generation. */
+        if(active || event.state == 0)
+            mSdrManager->requestCheck();
+
+        /** Wake up I/O Intr records of the FRU so they see the change right away. */
+        common::ScopedLock lock(mScanMutex);
+        for(auto &sensor : mSdrManager->findFruSensors(fruKey))
+        {
+            auto it = mSensorScans.find(IpmiSdrRepository::makeSensorKey(*sensor));
+            if(it != mSensorScans.end())
+                scanIoRequest(it->second);
+        }
+    }
+}
+
+void FreeIpmiProvider::close() {
+
+    if(mConnManager)
+        mConnManager->close();
+}
+
+bool FreeIpmiProvider::isPresent(const IpmiSensorRecComp& sensor) {
+
+    if(mAbsentCount == 0)
+        return true;
+
+    common::ScopedLock lock(mPresenceMutex);
+    return (mAbsentFrus.count((sensor.get_entity_id() << 8) | sensor.get_entity_instance()) == 0);
+}
+
 std::shared_ptr<IpmiSensorRecComp> FreeIpmiProvider::findSensorByMapKey(std::string key) {
 
     return mSdrManager->findSensorByMapKey(key);
@@ -122,18 +517,79 @@ std::shared_ptr<IpmiSensorRecComp> FreeIpmiProvider::findSensorByMapKey(std::str
 
 std::shared_ptr<PicmgLed> FreeIpmiProvider::getPicmgLedByAddress(uint8_t fru_id, uint8_t led_id) {
     
-    std::shared_ptr<IpmiFruDevLocRec> pfru = nullptr;
-    std::shared_ptr<PicmgLed> ppicmgled = nullptr;
-    pfru = mSdrManager->getFruByDeviceSlaveAddress(fru_id);
-    if(pfru) {
-        ppicmgled = pfru.get()->getStatusLedById(led_id);
+    return mSdrManager->getPicmgLed(fru_id, led_id);
+}
+
+void FreeIpmiProvider::processInitialConnect()
+{
+    sConnectSlots.acquire();
+
+    /** Shutdown released the waiters, don't open a session just to close it. */
+    if(isStopping())
+    {
+        sConnectSlots.release();
+        return;
+    }
+
+    bool attempt = mConnManager->isReconnectDue();
+    std::string error;
+    double sdrParseTime = 0.0;
+    try
+    {
+        mConnManager->process();
+        if(mConnManager->isConnected())
+        {
+            epicsTime start = epicsTime::getCurrent();
+            mSdrManager->process();
+            sdrParseTime = epicsTime::getCurrent() - start;
+            if(!isReady())
+                error = "SDR not loaded";
+        }
+    }
+    catch(const std::exception& e)
+    {
+        error = e.what();
+    }
+
+    sConnectSlots.release();
+
+    {
+        common::ScopedLock lock(mStatsMutex);
+        if(attempt)
+        {
+            mConnectStats.attempts++;
+            mConnectStats.connectTime = mConnManager->getConnectDuration();
+            mConnectStats.sdrLoadTime = mConnManager->getSdrCacheDuration();
+        }
+        mConnectStats.sdrLoadTime += sdrParseTime;
+        mConnectStats.ready = isReady();
+        /** Don't repeat the same failure on every pass. */
+        if(!error.empty() && error != mConnectStats.lastError)
+            LOG_WARN("Can't connect to '" + mConnManager->getConnectionId() + "' @ '" +
+                     mConnManager->getHostname() + "' - " + error);
+        if(!error.empty())
+            mConnectStats.lastError = error;
+    }
+
+    if(isReady())
+    {
+        std::cout << mSdrManager->getHeaderAsString() << std::endl;
+        mReadyEvent.signal();
     }
-    
-    return ppicmgled;
 }
 
 void FreeIpmiProvider::process() {
 
+    /** Until the SDR is loaded for the first time, don't hold a connect slot
+     *  while waiting for the next reconnect attempt.
+     */
+    if(mConnManager && mSdrManager && !isReady())
+    {
+        if((mConnManager->isConnected() && mSdrManager->isLoadDue()) || mConnManager->isReconnectDue())
+            processInitialConnect();
+        return;
+    }
+
     try
     {
         if(mConnManager)
@@ -143,7 +599,20 @@ void FreeIpmiProvider::process() {
             {
                 if(mSdrManager && mConnManager->isConnected())
                 {
+                    const unsigned generation = mSdrManager->getGeneration();
                     mSdrManager->process();
+                    if(mSdrManager->getGeneration() != generation)
+                    {
+                        std::cout << mSdrManager->getHeaderAsString() << std::endl;
+                        mReadyEvent.signal();
+                    }
+                    else if(getTaskStats().queued == 0)
+                    {
+                        /** Reads go first, LEDs are probed one FRU at a time when the queue is empty. */
+                        mSdrManager->discoverNextLeds();
+                    }
+                    processSel();
+                    processPoll();
                 }
             }
             catch(const std::exception& e)
@@ -13,8 +13,12 @@
 #include "common.h"
 #include "provider.h"
 
+#include <dbScan.h>
+#include <epicsEvent.h>
 #include <epicsTime.h>
 
+#include <map>
+#include <set>
 #include <string>
 #include <vector>
 #include <iostream>
@@ -24,18 +28,72 @@
 #include "IpmiFruDevLocRec.h"
 #include "IpmiSdrManager.h"
 #include "IpmiConnectionManager.h"
+#include "IpmiSelReader.h"
+#include "PollScheduler.h"
 
 class FreeIpmiProvider : public Provider
 {
+    public:
+
+        /**
+         * @brief Timing and outcome of establishing the connection.
+         */
+        struct ConnectStats {
+            std::string hostname;
+            unsigned attempts{0};           //!< Number of connect attempts so far.
+            double connectTime{0.0};        //!< Seconds to establish the IPMI session.
+            double sdrLoadTime{0.0};        //!< Seconds to download/open SDR cache and parse it.
+            bool ready{false};              //!< SDR was loaded at least once.
+            std::string lastError;          //!< Reason for the last failed attempt.
+        };
+
     private:
 
         IpmiConnectionManager *mConnManager{nullptr};
         IpmiSdrManager *mSdrManager{nullptr};
+        epicsEvent mReadyEvent;             //!< Signaled every time a new SDR was loaded.
+        IpmiSelReader *mSelReader{nullptr};
+        epicsMutex mScanMutex;
+        std::map<std::string, IOSCANPVT> mSensorScans; //!< I/O Intr lists by sensor map key.
+        IOSCANPVT mSelScan;                 //!< I/O Intr list of SEL records.
+        PollScheduler mPoller;              //!< Sensors polled on behalf of I/O Intr records.
+        std::map<std::string, std::unique_ptr<common::Mailbox<Entity>>> mPolledValues; //!< Last polled reading by sensor map key, map protected by mScanMutex.
+        std::map<std::string, std::shared_ptr<Snapshot>> mSnapshots; //!< FRU snapshots by FRU key, map protected by mScanMutex.
+        epicsMutex mStatsMutex;
+        ConnectStats mConnectStats;
+        epicsMutex mPresenceMutex;
+        std::set<uint16_t> mAbsentFrus;     //!< FRUs hot swap reported not active, (entity id << 8 | instance).
+        std::atomic<size_t> mAbsentCount{0}; //!< Size of mAbsentFrus, lets lookups skip the lock.
+        unsigned mReconnects{0};            //!< Reconnect count when absent FRUs were last validated.
+        static common::Semaphore sConnectSlots; //!< Limits connections being established at once.
+        static std::atomic<bool> sSensorLatency;  //!< Keep latency per sensor too.
+        epicsMutex mLatencyMutex;
+        std::map<std::string, std::shared_ptr<LatencyStats>> mSensorLatencies; //!< By sensor key, never removed.
+
+        /**
+         * @brief Connect and load SDR while holding one of the global connect slots.
+         */
+        void processInitialConnect();
+
+        /**
+         * @brief Read new SEL entries and wake up I/O Intr records they affect.
+         */
+        void processSel();
+
+        /**
+         * @brief Read sensors whose poll period expired and wake up I/O Intr records when reading changed.
+         */
+        void processPoll();
+
+        /**
+         * @brief Track FRUs going in and out of active state, re-check SDR when they come and go.
+         */
+        void processHotSwap(const std::vector<IpmiSelReader::HotSwapEvent>& events);
 
     public:
 
         /**
-         * @brief Instantiate new FreeIpmiProvider object and connect it to IPMI device
+         * @brief Instantiate new FreeIpmiProvider object, connecting to IPMI device is done in the background
          * @param conn_id
          * @param hostname
          * @param username
@@ -43,7 +101,7 @@ class FreeIpmiProvider : public Provider
          * @param authtype
          * @param protocol
          * @param privlevel
-         * @exception std::runtime_error when can't connect
+         * @exception std::runtime_error on invalid connection parameters
          */
         FreeIpmiProvider(const std::string& conn_id, const std::string& hostname,
                          const std::string& username, const std::string& password,
@@ -55,17 +113,120 @@ class FreeIpmiProvider : public Provider
          */
         ~FreeIpmiProvider();
 
+        /**
+         * @brief Check whether the connection has loaded its SDR at least once.
+         */
+        bool isReady();
+
+        /**
+         * @brief Number of times the SDR was (re)loaded, 0 means not loaded yet.
+         */
+        unsigned getSdrGeneration();
+
+        /**
+         * @brief Wait for the processing thread to load the SDR.
+         * @param timeout in seconds
+         * @return true if the SDR is loaded
+         */
+        bool waitReady(double timeout);
+
+        /**
+         * @brief Return a copy of connection establishment statistics.
+         */
+        ConnectStats getConnectStats();
+
+        /**
+         * @brief Number of times the session was re-established after the first connect.
+         */
+        unsigned getReconnectCount();
+
+        /**
+         * @brief False when sensor's FRU was hot swapped out or deactivated.
+         */
+        bool isPresent(const IpmiSensorRecComp& sensor);
+
+        /**
+         * @brief Number of sensor reads that failed on session timeout.
+         */
+        unsigned getTimeoutCount();
+
+        /**
+         * @brief True while session is established, safe from any thread.
+         */
+        bool isConnected();
+
+        /**
+         * @brief Session state as the connection manager keeps it, safe from any thread.
+         */
+        ConnectionState getConnectionState();
+
+        /**
+         * @brief Limit how many connections establish session and load SDR at the same time.
+         * @param limit maximum concurrent connects, 0 for unlimited
+         */
+        static void setConnectParallelism(unsigned limit);
+
+        /**
+         * @brief Return I/O Intr scan list processed when SEL reports event for given entity.
+         * @exception std::runtime_error when entity type doesn't support I/O Intr
+         */
+        IOSCANPVT getIoScan(const std::shared_ptr<const EntityAddrType> entAddrType);
+
+        /**
+         * @brief Poll entity in the background, I/O Intr records are processed when its value changes.
+         * @param entAddrType entity to poll, only sensors are supported
+         * @param period in seconds, shortest period requested for the same sensor is used
+         * @return mailbox with latest reading, valid for the lifetime of the provider
+         * @exception std::runtime_error when entity type can't be polled
+         */
+        const common::Mailbox<Entity>* addPoll(const std::shared_ptr<const EntityAddrType> entAddrType, double period);
+
+        /**
+         * @brief Return snapshot shared by all records of a FRU, sensors are resolved again after SDR reload.
+         * @param entAddrType FRU link
+         * @exception std::runtime_error when FRU has no sensors or SDR is not loaded
+         */
+        std::shared_ptr<Snapshot> getSnapshot(const std::shared_ptr<const EntityAddrType> entAddrType);
+
+        Entity getSelEvent();
+
         std::shared_ptr<IpmiSensorRecComp> findSensorByMapKey(std::string key);
         std::shared_ptr<PicmgLed> getPicmgLedByAddress(uint8_t fru_id, uint8_t led_id);
         ///std::shared_ptr<IpmiFruDevLocRec> get_fru_by_device_slave_address(const uint8_t slave_address);
         static Entity read_sensor(ipmi_sdr_ctx_t sdr, ipmi_sensor_read_ctx_t sensors,
             const std::shared_ptr<IpmiSensorRecComp> record);
         static Entity readPicmgLed(ipmi_ctx_t ipmi, const std::shared_ptr<PicmgLed> picmgLed);
-        Entity getEntityValue(const std::shared_ptr<EntityAddrType> entAddrType) override;
-        void write_oem_command(const std::shared_ptr<EntityAddrType> entAddrType, Entity &entity);
+        Entity getEntityValue(const std::shared_ptr<const EntityAddrType> entAddrType) override;
+        bool readSensorValue(const std::shared_ptr<IpmiSensorRecComp> sensor, Entity& entity, ReadError& error,
+                             WireTime& wire) override;
+        std::string formatReadError(const IpmiSensorRecComp& sensor, const ReadError& error) override;
+
+        /**
+         * @brief Latency of tasks reading given sensor, shared by all its records.
+         * @return nullptr unless per-sensor latency is enabled
+         */
+        std::shared_ptr<LatencyStats> getSensorLatency(const std::string& sensorKey);
+
+        /**
+         * @brief Return per-sensor latency by sensor key, for reports.
+         */
+        std::map<std::string, std::shared_ptr<LatencyStats>> getSensorLatencies();
+
+        /**
+         * @brief Collect latency per sensor for records bound from now on, costs about 13 kB per sensor.
+         */
+        static void setSensorLatency(bool enabled);
+
+        /**
+         * @brief Resolve OEM command handler and arguments once, for the write lane.
+         * @return Command or nullptr when vendor or command is not supported.
+         */
+        std::shared_ptr<const Command> getOemCommand(const std::shared_ptr<const EntityAddrType> entAddrType);
+        Entity readSnapshot(Snapshot &snapshot) override;
         void process() override;
-        Entity getSensorReading(const std::shared_ptr<EntityAddrType> entAddrType);
-        Entity getPicmgLedReading(const std::shared_ptr<EntityAddrType> entAddrType);
+        void close() override;
+        Entity getSensorReading(const std::shared_ptr<const EntityAddrType> entAddrType);
+        Entity getPicmgLedReading(const std::shared_ptr<const EntityAddrType> entAddrType);
         static int compareSdrRecordKeys(ipmi_sdr_ctx_t sdr, const std::shared_ptr<IpmiSensorRecComp> record);
         bool is_valid_oem_cmd(const std::string &vendor_id, const std::string &command);
         
@@ -55,7 +55,7 @@ FreeIpmiProvider::Entity FreeIpmiProvider::read_sensor(ipmi_sdr_ctx_t sdr, ipmi_
     uint8_t readingRaw = 0;
     double* reading = nullptr;
     uint16_t eventMask = 0;
-    const common::buffer<uint8_t, IPMI_SDR_MAX_RECORD_LENGTH> &data = record->get_record_data();
+    const common::bytes_view &data = record->get_record_data();
 
     int rv = ipmi_sensor_read(sensors, data.data, data.size, sharedOffset, &readingRaw, &reading, &eventMask);
 
@@ -89,15 +89,16 @@ FreeIpmiProvider::Entity FreeIpmiProvider::read_sensor(ipmi_sdr_ctx_t sdr, ipmi_
     */
     if(IPMI_EVENT_READING_TYPE_CODE_IS_THRESHOLD(record->get_event_reading_type_code())) {
         if(reading) {
-            entity["VAL"] = std::round(*reading * 100.0) / 100.0;
+            entity.setField<Entity::VAL>(std::round(*reading * 100.0) / 100.0);
             free(reading);
         }
         else
-            entity["VAL"] = (double) eventMask;
+            entity.setField<Entity::VAL>((double) eventMask);
     }
     else {
-        entity["VAL"] = (double) eventMask;
+        entity.setField<Entity::VAL>((double) eventMask);
     }
+    entity.setField<Entity::STATE_MASK>(eventMask);
 
     return entity;
 }
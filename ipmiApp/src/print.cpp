@@ -21,7 +21,7 @@
 
 namespace print {
 
-void printScanReport(const std::string& header, const std::vector<Provider::Entity>& entities)
+void printScanReport(const std::string& header, const std::vector<std::pair<std::string, Provider::Entity>>& entities)
 {
     size_t len = entities.size();
     uint8_t indent = 1;
@@ -32,35 +32,23 @@ void printScanReport(const std::string& header, const std::vector<Provider::Enti
 
     std::cout << header << std::endl;
     unsigned i = 1;
-    for (auto& entity: entities) {
+    for (auto& [desc, entity]: entities) {
         std::cout << std::right << std::setw(indent) << i++ << ": ";
 
-        auto desc = entity.getField<std::string>("DESC", "<missing desc>");
-        std::cout << std::left << std::setw(41) << desc.substr(0, 41) << " ";
-
-        auto stringValue = entity.getField<std::string>("VAL", "<UDF string value>");
-        auto doubleValue = entity.getField<double>     ("VAL", std::numeric_limits<double>::min());
-        auto intValue    = entity.getField<int>        ("VAL", std::numeric_limits<int>::min());
-        if (intValue != std::numeric_limits<int>::min())
-            std::cout << intValue << " ";
-        else if (doubleValue != std::numeric_limits<double>::min())
-            std::cout << std::setprecision(2) << std::fixed << doubleValue << " ";
-        else if (stringValue != "<UDF string value>")
-            std::cout << stringValue << " ";
+        std::cout << std::left << std::setw(41) << (desc.empty() ? "<missing desc>" : desc.substr(0, 41)) << " ";
+
+        if (entity.hasField<Provider::Entity::VAL>())
+            std::cout << std::setprecision(2) << std::fixed << entity.getField<Provider::Entity::VAL>(0.0) << " ";
+        else if (entity.hasField<Provider::Entity::VAL_STRING>())
+            std::cout << entity.getField<Provider::Entity::VAL_STRING>(std::string()) << " ";
         else
             std::cout << "N/A ";
 
-        auto unit = entity.getField<std::string>("UNIT", "");
-        if (unit != "")
-            std::cout << unit << " ";
-
-        auto stat = entity.getField<int>("STAT", epicsAlarmNone);
-        if (stat != epicsAlarmNone && stat < ALARM_NSTATUS)
-            std::cout << epicsAlarmConditionStrings[stat] << " ";
+        if (entity.stat != epicsAlarmNone && entity.stat < ALARM_NSTATUS)
+            std::cout << epicsAlarmConditionStrings[entity.stat] << " ";
 
-        auto sevr = entity.getField<int>("SEVR", epicsSevNone);
-        if (sevr != epicsSevNone && sevr < ALARM_NSEV)
-            std::cout << epicsAlarmSeverityStrings[sevr] << " ";
+        if (entity.sevr != epicsSevNone && entity.sevr < ALARM_NSEV)
+            std::cout << epicsAlarmSeverityStrings[entity.sevr] << " ";
 
         std::cout << std::endl;
     }
@@ -78,7 +66,7 @@ static std::string _epicsEscape(const std::string& str)
     return escaped;
 }
 
-std::string getRecordType(const Provider::Entity& entity)
+std::string getRecordType(const RecordFields& entity)
 {
     static const std::vector<std::string> fields = {
         "ZRVL", "ZRST", "ONVL", "ONST", "TWVL", "TWST", "THVL", "THST",
@@ -107,7 +95,7 @@ std::string getRecordType(const Provider::Entity& entity)
     return "";
 }
 
-static void printRecordAnalog(FILE* dbfile, const std::string& recordName, const Provider::Entity& entity)
+static void printRecordAnalog(FILE* dbfile, const std::string& recordName, const RecordFields& entity)
 {
     auto doubleValue = entity.getField<double>     ("VAL", std::numeric_limits<double>::min());
     auto intValue    = entity.getField<int>        ("VAL", std::numeric_limits<int>::min());
@@ -164,7 +152,7 @@ static void printRecordAnalog(FILE* dbfile, const std::string& recordName, const
     fprintf(dbfile,     "}\n");
 }
 
-static void printRecordLong(FILE* dbfile, const std::string& recordName, const Provider::Entity& entity)
+static void printRecordLong(FILE* dbfile, const std::string& recordName, const RecordFields& entity)
 {
     auto intValue    = entity.getField<int>        ("VAL", 0);
 
@@ -205,7 +193,7 @@ static void printRecordLong(FILE* dbfile, const std::string& recordName, const P
     fprintf(dbfile,     "}\n");
 }
 
-static void printRecordEnum(FILE* dbfile, const std::string& recordName, const Provider::Entity& entity)
+static void printRecordEnum(FILE* dbfile, const std::string& recordName, const RecordFields& entity)
 {
     auto intValue = entity.getField<int>        ("VAL", 0);
 
@@ -237,7 +225,7 @@ static void printRecordEnum(FILE* dbfile, const std::string& recordName, const P
     fprintf(dbfile,     "}\n");
 }
 
-static void printRecordString(FILE* dbfile, const std::string& recordName, const Provider::Entity& entity)
+static void printRecordString(FILE* dbfile, const std::string& recordName, const RecordFields& entity)
 {
     auto stringValue = entity.getField<std::string>("VAL", "<UDF string value>");
 
@@ -256,7 +244,7 @@ static void printRecordString(FILE* dbfile, const std::string& recordName, const
     fprintf(dbfile,     "}\n");
 }
 
-void printRecord(FILE* dbfile, const std::string& prefix, const Provider::Entity& entity)
+void printRecord(FILE* dbfile, const std::string& prefix, const RecordFields& entity)
 {
     auto name = entity.getField<std::string>("NAME", "");
     if (name == "") {
@@ -12,13 +12,42 @@
 
 #include "provider.h"
 
+#include <map>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace print {
 
-void printScanReport(const std::string& header, const std::vector<Provider::Entity>& entities);
+/**
+ * @class RecordFields
+ * @brief EPICS record fields by name, used to generate database records.
+ *
+ * Unlike Provider::Entity which carries readings, record templates can
+ * have any field of any record type.
+ */
+class RecordFields : public std::map<std::string, Provider::Variant> {
+    public:
+        template <typename T>
+        T getField(const std::string& field, const T& default_) const
+        {
+            auto it = find(field);
+            if (it != end()) {
+                auto ptr = std::get_if<T>(&it->second);
+                if (ptr)
+                    return *ptr;
+            }
+            return default_;
+        }
+};
+
+/**
+ * @brief Print one line per entity with its description, value and alarm.
+ * @param header printed first
+ * @param entities pairs of description and value
+ */
+void printScanReport(const std::string& header, const std::vector<std::pair<std::string, Provider::Entity>>& entities);
 
-void printRecord(FILE* dbfile, const std::string& prefix, const Provider::Entity& entity);
+void printRecord(FILE* dbfile, const std::string& prefix, const RecordFields& entity);
 
 }; // namespace print
@@ -14,6 +14,7 @@
 #include <alarm.h>
 #include <epicsThread.h>
 
+#include <algorithm>
 #include <limits>
 #include <iostream>
 
@@ -25,6 +26,47 @@ extern "C" {
     }
 };
 
+const double Provider::WRITE_QUEUE_TIMEOUT = 10.0;
+
+/** Seconds same sensor read failure is only counted after being logged. */
+static const double READ_ERROR_LOG_PERIOD = 10.0;
+
+/**
+ * @brief Record alarm for a write the device refused with IPMI completion code.
+ *
+ * Busy or timed out device may take the same write later, a malformed or
+ * unsupported request never will.
+ */
+static void compCodeAlarm(uint8_t code, int& stat, int& sevr)
+{
+    switch (code) {
+        case 0xC0:  // Node busy
+        case 0xC3:  // Timeout while processing command
+        case 0xCE:  // Response could not be provided
+            stat = epicsAlarmTimeout;
+            sevr = epicsSevMajor;
+            break;
+        case 0xD4:  // Insufficient privilege level
+        case 0xD5:  // Not supported in present state
+        case 0xD6:  // Sub-function disabled or unavailable
+            stat = epicsAlarmWriteAccess;
+            sevr = epicsSevMajor;
+            break;
+        case 0xC1:  // Invalid command
+        case 0xC2:  // Invalid for given LUN
+        case 0xC7:  // Request data length invalid
+        case 0xC9:  // Parameter out of range
+        case 0xCC:  // Invalid data field in request
+            stat = epicsAlarmWrite;
+            sevr = epicsSevInvalid;
+            break;
+        default:
+            stat = epicsAlarmWrite;
+            sevr = epicsSevMajor;
+            break;
+    }
+}
+
 Provider::Provider(const std::string& conn_id)
 : mConnId(conn_id)
 {
@@ -36,20 +78,34 @@ Provider::~Provider()
     stopThread();
 }
 
-bool Provider::stopThread(double timeout)
+size_t Provider::requestStop()
 {
-    if (m_tasks.processing) {
-        m_tasks.processing = false;
-        m_tasks.event.signal();
+    common::ScopedLock lock(m_tasks.mutex);
+    size_t dropped = m_tasks.queue.size() + m_tasks.writes.size();
+    m_tasks.queue.clear();
+    m_tasks.writes.clear();
+    m_tasks.processing = false;
+    m_tasks.event.signal();
+    return dropped;
+}
 
-        if (timeout > 0)
-            return m_tasks.stopped.wait(timeout);
+bool Provider::stopThread(double timeout)
+{
+    requestStop();
 
-        m_tasks.stopped.wait();
-    }
+    if (m_tasks.exited)
+        return true;
+    if (timeout > 0)
+        return (m_tasks.stopped.wait(timeout) || m_tasks.exited);
+    m_tasks.stopped.wait();
     return true;
 }
 
+bool Provider::isStopping() const
+{
+    return !m_tasks.processing;
+}
+
 void Provider::start() {
 
     epicsThreadCreate(mConnId.c_str(), epicsThreadPriorityLow,
@@ -59,70 +115,258 @@ void Provider::start() {
 bool Provider::schedule(const Task&& task)
 {
     m_tasks.mutex.lock();
-    m_tasks.queue.emplace_back(task);
+    if (task.command) {
+        /** Identical links share EntityAddrType, so records with the same link
+         *  have the same target. Only merge when no value would get lost, newer
+         *  write from the same record or the same value from another record. */
+        auto it = std::find_if(m_tasks.writes.begin(), m_tasks.writes.end(), [&task](const Task& queued) {
+            return queued.entAddrTyp == task.entAddrTyp && (&queued.result == &task.result || queued.request == task.request);
+        });
+        if (it != m_tasks.writes.end()) {
+            it->request = task.request;
+            it->coalesced.push_back({task.callback, &task.result});
+        } else {
+            m_tasks.writes.emplace_back(task);
+            m_tasks.writes.back().queued = epicsTime::getCurrent();
+        }
+    } else {
+        m_tasks.queue.emplace_back(task);
+        m_tasks.queue.back().queued = epicsTime::getCurrent();
+    }
     m_tasks.event.signal();
     m_tasks.mutex.unlock();
     return true;
 }
 
+Provider::TaskStats Provider::getTaskStats()
+{
+    TaskStats stats;
+    stats.completed = m_tasks.completed;
+    stats.suppressed = m_tasks.suppressed;
+    stats.errors = m_tasks.errors;
+    stats.rate = m_tasks.rate;
+    stats.errorRate = m_tasks.errorRate;
+    m_tasks.mutex.lock();
+    stats.queued = m_tasks.queue.size() + m_tasks.writes.size();
+    m_tasks.mutex.unlock();
+    return stats;
+}
+
+Provider::LatencyStats& Provider::getLatency()
+{
+    return m_tasks.latency;
+}
+
+void Provider::LatencyStats::add(const WireTime& wire)
+{
+    /** Nothing was sent when there was no session. */
+    if (wire.reading > 0.0)
+        reading.add(wire.reading);
+    if (wire.thresholds > 0.0)
+        thresholds.add(wire.thresholds);
+    if (wire.hysteresis > 0.0)
+        hysteresis.add(wire.hysteresis);
+}
+
+void Provider::LatencyStats::reset()
+{
+    for (auto histogram: {&queue, &reading, &thresholds, &hysteresis, &write, &task, &callback})
+        histogram->reset();
+}
+
+void Provider::updateRate()
+{
+    epicsTime now = epicsTime::getCurrent();
+    double elapsed = now - m_tasks.rateStart;
+    if (elapsed < 1.0)
+        return;
+
+    unsigned long done = m_tasks.completed + m_tasks.suppressed;
+    unsigned long errors = m_tasks.errors;
+    m_tasks.rate = (done - m_tasks.rateCount) / elapsed;
+    m_tasks.errorRate = (errors - m_tasks.rateErrors) / elapsed;
+    m_tasks.rateStart = now;
+    m_tasks.rateCount = done;
+    m_tasks.rateErrors = errors;
+}
+
+void Provider::fail(Task& task, Entity& entity, int stat, int sevr, const std::string& error)
+{
+    /** Keep the last good value, only flag it. */
+    entity = Entity();
+    task.result.read(entity);
+    entity.clearField<Entity::COMP_CODE>();
+    entity.sevr = sevr;
+    entity.stat = stat;
+    m_tasks.errors++;
+    LOG_ERROR(error);
+
+    /** Records copying from the snapshot didn't read, they show the alarm of this read. */
+    if (task.snapshot) {
+        common::ScopedLock lock(task.snapshot->mutex);
+        task.snapshot->stat = stat;
+        task.snapshot->sevr = sevr;
+    }
+}
+
+void Provider::readFailed(Task& task, Entity& entity, const ReadError& error)
+{
+    entity = Entity();
+    task.result.read(entity);
+    entity.sevr = epicsSevInvalid;
+    entity.stat = epicsAlarmComm;
+    m_tasks.errors++;
+
+    /** Failures of different sensors are logged on their own, each names its sensor. */
+    epicsTime now = epicsTime::getCurrent();
+    auto& logged = m_tasks.logged[task.entAddrTyp.get()];
+    if (logged.entAddrTyp && error == logged.error && (now - logged.time) < READ_ERROR_LOG_PERIOD) {
+        logged.unlogged++;
+        return;
+    }
+    if (logged.unlogged > 0)
+        LOG_ERROR("%lu more reads of sensor '%s' on '%s' failed the same way", logged.unlogged,
+                  task.entAddrTyp->getSensorIdAsKey().c_str(), mConnId.c_str());
+    if (common::getLogLevel() >= 1)
+        LOG_ERROR("%s", formatReadError(*task.sensor, error).c_str());
+    logged.entAddrTyp = task.entAddrTyp;
+    logged.error = error;
+    logged.time = now;
+    logged.unlogged = 0;
+}
+
 void Provider::tasksThread()
 {
+    m_tasks.rateStart = epicsTime::getCurrent();
     while (m_tasks.processing) {
         
         process();
+        updateRate();
         m_tasks.mutex.lock();
 
-        if (m_tasks.queue.empty()) {
+        if (m_tasks.queue.empty() && m_tasks.writes.empty()) {
             m_tasks.mutex.unlock();
             ///m_tasks.event.wait();
             epicsThreadSleep(0.1);
             continue;
         }
 
-        Task task = std::move(m_tasks.queue.front());
-        m_tasks.queue.pop_front();
+        std::list<Task>& lane = (m_tasks.writes.empty() ? m_tasks.queue : m_tasks.writes);
+        Task task = std::move(lane.front());
+        lane.pop_front();
         m_tasks.mutex.unlock();
 
         const EntityAddrType::Type ADDRESS_TYPE = task.entAddrTyp->getEntityAddressType();
+        Entity entity;
+        epicsTime start = epicsTime::getCurrent();
+        m_tasks.latency.queue.add(start - task.queued);
+        if (task.latency)
+            task.latency->queue.add(start - task.queued);
 
         try {
             
             switch (ADDRESS_TYPE)
             {
                 case EntityAddrType::Type::SENSOR:
+                case EntityAddrType::Type::SEL:
                 {
-                    Entity ent = getEntityValue(task.entAddrTyp);
-
-                    for (auto& kv: ent)
-                    {
-                        task.entity[kv.first] = std::move(kv.second);
+                    /** Fresh entity, alarm from a previous failure is not carried over. */
+                    if (task.sensor) {
+                        ReadError error;
+                        WireTime wire;
+                        bool read = readSensorValue(task.sensor, entity, error, wire);
+                        m_tasks.latency.add(wire);
+                        if (task.latency)
+                            task.latency->add(wire);
+                        if (!read) {
+                            readFailed(task, entity, error);
+                            break;
+                        }
+                    } else {
+                        entity = getEntityValue(task.entAddrTyp);
                     }
-                    /** We have to set these back to normal if we had
-                     * set them below in the catch... otherwise they
-                     * stay in alarm.
-                    */
-                    task.entity["SEVR"] = (int)epicsSevNone;
-                    task.entity["STAT"] = (int)epicsAlarmNone;
+                    entity.sevr = epicsSevNone;
+                    entity.stat = epicsAlarmNone;
+                    break;
+                }
+                case EntityAddrType::Type::FRU:
+                {
+                    /** All sensors in one task, per sensor failures are in the snapshot. */
+                    entity = readSnapshot(*task.snapshot);
+                    break;
                 }
                 case EntityAddrType::Type::OEM_CMD:
                 {
-                    write_oem_command(task.entAddrTyp, task.entity);
+                    if (!task.command)
+                        throw syntax_error("OEM command not resolved");
+                    /** Don't act on a command that was given long ago, e.g. while disconnected. */
+                    if ((start - task.queued) > WRITE_QUEUE_TIMEOUT)
+                        throw timeout_error("OEM command not sent, waited " + std::to_string(start - task.queued) + " s in queue");
+                    entity = task.request;
+                    entity.sevr = epicsSevNone;
+                    entity.stat = epicsAlarmNone;
+                    epicsTime sent = epicsTime::getCurrent();
+                    (*task.command)(entity);
+                    m_tasks.latency.write.add(epicsTime::getCurrent() - sent);
+                    break;
                 }
+                default:
+                    break;
             }
-            
-            
 
+        } catch (timeout_error &e) {
+            fail(task, entity, epicsAlarmTimeout, epicsSevInvalid, e.what());
+        } catch (syntax_error &e) {
+            fail(task, entity, epicsAlarmWrite, epicsSevInvalid, e.what());
+        } catch (process_error &e) {
+            /** Device understood the request but refused it. */
+            int stat = epicsAlarmWrite, sevr = epicsSevMajor;
+            if (e.code != 0)
+                compCodeAlarm(e.code, stat, sevr);
+            fail(task, entity, stat, sevr, e.what());
+            if (e.code != 0)
+                entity.setField<Entity::COMP_CODE>(e.code);
         } catch (std::runtime_error &e) {
-            task.entity["SEVR"] = (int)epicsSevInvalid;
-            task.entity["STAT"] = (int)epicsAlarmComm;
-            LOG_ERROR(e.what());
+            fail(task, entity, epicsAlarmComm, epicsSevInvalid, e.what());
         } catch (...) {
-            task.entity["SEVR"] = (int)epicsSevInvalid;
-            task.entity["STAT"] = (int)epicsAlarmComm;
-            LOG_ERROR("Unhandled exception getting IPMI entity");
+            fail(task, entity, epicsAlarmComm, epicsSevInvalid, "Unhandled exception getting IPMI entity");
+        }
+        double taskTime = epicsTime::getCurrent() - start;
+        m_tasks.latency.task.add(taskTime);
+        if (task.latency)
+            task.latency->task.add(taskTime);
+
+        /** Nothing new for the record, let it go without processing. */
+        if (task.filter && task.filter->deadband >= 0.0) {
+            Entity previous;
+            epicsTime now = epicsTime::getCurrent();
+            if (task.result.read(previous) && entity.isNear(previous, task.filter->deadband) &&
+                (now - task.filter->lastReport) < task.filter->maxAge) {
+                task.filter->suppressed++;
+                m_tasks.suppressed++;
+                task.filter->release();
+                continue;
+            }
+            task.filter->lastReport = now;
         }
+
+        /** This thread is the only writer of the mailbox. */
+        task.result.publish(entity);
+        m_tasks.completed++;
         task.callback();
+        for (auto& coalesced: task.coalesced) {
+            coalesced.result->publish(entity);
+            m_tasks.completed++;
+            coalesced.callback();
+        }
     }
 
+    /** Free the BMC session slot now rather than let it time out. */
+    try {
+        close();
+    } catch (std::exception &e) {
+        LOG_WARN("Can't close session for '%s' - %s", mConnId.c_str(), e.what());
+    }
+    m_tasks.exited = true;
     m_tasks.stopped.signal();
 }
@@ -10,10 +10,20 @@
 
 #pragma once
 
+#include <alarm.h>
 #include <epicsEvent.h>
 #include <epicsMutex.h>
+#include <epicsTime.h>
 
+#include "common.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <string>
+#include <string_view>
 #include <list>
 #include <map>
 #include <memory>
@@ -32,35 +42,272 @@
 class Provider {
     public:
         typedef std::variant<int,double,std::string> Variant;           //!< Generic container for entity fields
-        class Entity : public std::map<std::string, Variant> {
+
+        /**
+         * @class Entity
+         * @brief Value read from or written to an IPMI entity.
+         *
+         * Fixed set of fields with a mask telling which ones were set. Field
+         * is selected by template argument, so accessing it compiles to a
+         * member access. String value is kept in a fixed buffer, entity is
+         * trivially copyable and never allocates.
+         */
+        class Entity {
             public:
-                template <typename T>
-                T getField(const std::string& field, const T& default_) const
+                static const size_t VAL_STRING_SIZE = 256;  //!< Including terminating null, fits any SEL entry text.
+
+                enum Field : uint16_t {
+                    VAL                 = 1 << 0,   //!< Numeric value, sensor reading or value to write
+                    VAL_STRING          = 1 << 1,   //!< Text value, e.g. SEL event
+                    HIHI                = 1 << 2,
+                    HIGH                = 1 << 3,
+                    LOW                 = 1 << 4,
+                    LOLO                = 1 << 5,
+                    HYST                = 1 << 6,
+                    THRESHOLDS_READABLE = 1 << 7,   //!< Bit mask from Get Sensor Thresholds
+                    TIMESTAMP           = 1 << 8,
+                    COUNT               = 1 << 9,
+                    STATE_MASK          = 1 << 10,  //!< Asserted discrete states, bit N is state offset N
+                    COMP_CODE           = 1 << 11,  //!< IPMI completion code of a refused write
+                };
+
+                int sevr{0};                        //!< Alarm severity, epicsSevNone unless set
+                int stat{0};                        //!< Alarm status, epicsAlarmNone unless set
+
+                template <Field F>
+                bool hasField() const
+                {
+                    return (mPresent & F) != 0;
+                }
+
+                template <Field F, typename T>
+                T getField(const T& default_) const
+                {
+                    if (!hasField<F>())
+                        return default_;
+                    if constexpr (F == VAL_STRING)
+                        return T(mValString);
+                    else
+                        return static_cast<T>(field<F>(*this));
+                }
+
+                template <Field F, typename T>
+                void setField(const T& value)
                 {
-                    auto it = find(field);
-                    if (it != end()) {
-                        auto ptr = std::get_if<T>(&it->second);
-                        if (ptr)
-                            return *ptr;
+                    if constexpr (F == VAL_STRING) {
+                        size_t len = std::min<size_t>(std::string_view(value).size(), VAL_STRING_SIZE - 1);
+                        memcpy(mValString, std::string_view(value).data(), len);
+                        mValString[len] = '\0';
+                    } else {
+                        field<F>(*this) = value;
                     }
-                    return default_;
+                    mPresent |= F;
+                }
+
+                template <Field F>
+                void clearField()
+                {
+                    mPresent &= ~F;
+                }
+
+                bool operator==(const Entity& other) const
+                {
+                    return mPresent == other.mPresent && sevr == other.sevr && stat == other.stat &&
+                           mVal == other.mVal && strcmp(mValString, other.mValString) == 0 &&
+                           mHihi == other.mHihi && mHigh == other.mHigh && mLow == other.mLow &&
+                           mLolo == other.mLolo && mHyst == other.mHyst &&
+                           mThresholdsReadable == other.mThresholdsReadable &&
+                           mTimestamp == other.mTimestamp && mCount == other.mCount &&
+                           mStateMask == other.mStateMask && mCompCode == other.mCompCode;
+                }
+
+                bool operator!=(const Entity& other) const
+                {
+                    return !(*this == other);
+                }
+
+                /**
+                 * @brief Same as ==, except VAL may differ by up to deadband.
+                 */
+                bool isNear(const Entity& other, double deadband) const
+                {
+                    Entity same = other;
+                    same.mVal = mVal;
+                    return *this == same && std::fabs(mVal - other.mVal) <= deadband;
                 }
-                
-                bool hasField(const std::string& field)
+
+            private:
+                uint16_t mPresent{0};
+                double mVal{0.0};
+                char mValString[VAL_STRING_SIZE]{};
+                double mHihi{0.0};
+                double mHigh{0.0};
+                double mLow{0.0};
+                double mLolo{0.0};
+                double mHyst{0.0};
+                int mThresholdsReadable{0};
+                uint32_t mTimestamp{0};
+                uint32_t mCount{0};
+                uint16_t mStateMask{0};
+                uint8_t mCompCode{0};
+
+                /** Shared by const and non-const accessors. */
+                template <Field F, typename E>
+                static auto& field(E& e)
                 {
-                    auto it = find(field);
-                    return (it != end());
+                    if constexpr (F == VAL) return e.mVal;
+                    else if constexpr (F == HIHI) return e.mHihi;
+                    else if constexpr (F == HIGH) return e.mHigh;
+                    else if constexpr (F == LOW) return e.mLow;
+                    else if constexpr (F == LOLO) return e.mLolo;
+                    else if constexpr (F == HYST) return e.mHyst;
+                    else if constexpr (F == THRESHOLDS_READABLE) return e.mThresholdsReadable;
+                    else if constexpr (F == TIMESTAMP) return e.mTimestamp;
+                    else if constexpr (F == STATE_MASK) return e.mStateMask;
+                    else if constexpr (F == COMP_CODE) return e.mCompCode;
+                    else return e.mCount;
                 }
         };
+
+        /**
+         * @brief Why a sensor read failed, compact so that failing is as cheap as reading.
+         *
+         * Text is made by formatReadError() only when the failure gets logged.
+         */
+        struct ReadError {
+            enum class Reason : uint8_t {
+                NONE,
+                DISCONNECTED,                   //!< No session, waiting to reconnect
+                NO_CONTEXT,                     //!< Sensor read context not created
+                SESSION_TIMEOUT,                //!< Session timed out during read, connection dropped
+                IPMI,                           //!< Device or FreeIPMI reported error in code
+            };
+            Reason reason{Reason::NONE};
+            int code{0};                        //!< FreeIPMI sensor read error number
+
+            bool operator==(const ReadError& other) const { return reason == other.reason && code == other.code; }
+            bool operator!=(const ReadError& other) const { return !(*this == other); }
+        };
+
+        /**
+         * @brief Seconds one sensor read spent on the wire, 0 for steps that were skipped.
+         */
+        struct WireTime {
+            double reading{0.0};                //!< Get Sensor Reading
+            double thresholds{0.0};             //!< Get Sensor Thresholds, only when limits weren't cached
+            double hysteresis{0.0};             //!< Get Sensor Hysteresis, only when limits weren't cached
+        };
+
+        /**
+         * @brief Where the time goes from scheduling a task until the record processed its result.
+         *
+         * Kept per connection and optionally per sensor, all histograms are lock-free.
+         */
+        struct LatencyStats {
+            common::LatencyHistogram queue;     //!< Scheduled until connection thread took it
+            common::LatencyHistogram reading;   //!< Get Sensor Reading on the wire
+            common::LatencyHistogram thresholds;//!< Get Sensor Thresholds on the wire
+            common::LatencyHistogram hysteresis;//!< Get Sensor Hysteresis on the wire
+            common::LatencyHistogram write;     //!< OEM command on the wire
+            common::LatencyHistogram task;      //!< Taken until result published, wire time included
+            common::LatencyHistogram callback;  //!< Result published until record processed it
+
+            void add(const WireTime& wire);
+            void reset();
+        };
+
+        /**
+         * @brief Write resolved once when the record binds, e.g. OEM command with its handler and arguments.
+         *
+         * Runs on the connection thread, throws one of the Provider errors on failure.
+         */
+        typedef std::function<void(Entity&)> Command;
+
+        /**
+         * @brief Readings of all sensors of a FRU or connection, taken in one task.
+         *
+         * Shared by all records linked to the same FRU, the values record
+         * refreshes it and status and names records copy from it.
+         */
+        struct Snapshot {
+            epicsMutex mutex;                   //!< Protects all members
+            unsigned generation{0};             //!< SDR generation sensors were resolved from
+            std::vector<std::shared_ptr<IpmiSensorRecComp>> sensors;
+            std::vector<std::string> names;     //!< Sensor id strings
+            std::vector<double> values;         //!< Last reading of each sensor
+            std::vector<int> severities;        //!< Alarm severity of each reading, invalid when read failed
+            int stat{epicsAlarmUDF};            //!< Alarm of the last read of all sensors, UDF until the first one
+            int sevr{epicsSevInvalid};
+        };
+
+        /**
+         * @brief Record's change suppression, evaluated by the connection thread.
+         *
+         * Owned by the record, connection thread only touches it while
+         * the record's read task is pending.
+         */
+        struct ChangeFilter {
+            double deadband{-1.0};              //!< Smallest VAL change to report, negative disables suppression
+            double maxAge{60.0};                //!< Report unchanged value after this many seconds anyway
+            epicsTime lastReport;               //!< When record last got a new value
+            std::atomic<unsigned long> suppressed{0}; //!< Reads that didn't process the record
+            std::function<void()> release;      //!< Completes pending read without processing the record
+        };
+
+        /**
+         * @brief Outcome of completed tasks.
+         */
+        struct TaskStats {
+            unsigned long completed{0};         //!< Records processed with the result
+            unsigned long suppressed{0};        //!< Records released without processing, nothing changed
+            unsigned long errors{0};            //!< Tasks that failed to read or write
+            size_t queued{0};                   //!< Tasks waiting to be processed
+            double rate{0.0};                   //!< Tasks per second over the last second or more
+            double errorRate{0.0};              //!< Failed tasks per second over the same period
+        };
+
         struct Task {
-            std::shared_ptr<EntityAddrType> entAddrTyp;
+            std::shared_ptr<const EntityAddrType> entAddrTyp;
             std::function<void()> callback;
-            Entity& entity;
+            common::Mailbox<Entity>& result;            //!< Record's mailbox, result is published before callback.
+            std::shared_ptr<IpmiSensorRecComp> sensor;  //!< Sensor resolved by the record, skips the SDR lookup.
+            Entity request;                             //!< Value to write, unused for reads.
+            std::shared_ptr<Snapshot> snapshot;         //!< Filled in by FRU reads instead of result.
+            ChangeFilter* filter{nullptr};              //!< Suppress completion when result didn't change.
+            LatencyStats* latency{nullptr};             //!< Per-sensor latency, when enabled.
+            std::shared_ptr<const Command> command;     //!< Resolved write, goes to the write lane.
+            epicsTime queued;                           //!< When task was scheduled, for write timeout and latency.
+
+            /** Writes merged into this one while it was still queued, see schedule(). */
+            struct Coalesced {
+                std::function<void()> callback;
+                common::Mailbox<Entity>* result;
+            };
+            std::vector<Coalesced> coalesced;
             
-            Task(std::shared_ptr<EntityAddrType> entAddrTyp_, const std::function<void()>& cb, Entity& entity_)
+            Task(std::shared_ptr<const EntityAddrType> entAddrTyp_, const std::function<void()>& cb, common::Mailbox<Entity>& result_,
+                 std::shared_ptr<IpmiSensorRecComp> sensor_=nullptr)
+                : entAddrTyp(entAddrTyp_)
+                , callback(cb)
+                , result(result_)
+                , sensor(sensor_)
+            {};
+
+            Task(std::shared_ptr<const EntityAddrType> entAddrTyp_, const std::function<void()>& cb, common::Mailbox<Entity>& result_,
+                 const Entity& request_, std::shared_ptr<const Command> command_=nullptr)
                 : entAddrTyp(entAddrTyp_)
                 , callback(cb)
-                , entity(entity_)
+                , result(result_)
+                , request(request_)
+                , command(command_)
+            {};
+
+            Task(std::shared_ptr<const EntityAddrType> entAddrTyp_, const std::function<void()>& cb, common::Mailbox<Entity>& result_,
+                 std::shared_ptr<Snapshot> snapshot_)
+                : entAddrTyp(entAddrTyp_)
+                , callback(cb)
+                , result(result_)
+                , snapshot(snapshot_)
             {};
         };
 
@@ -71,15 +318,29 @@ class Provider {
             using std::runtime_error::runtime_error;
         };
         struct process_error : public std::runtime_error {
+            uint8_t code;                       //!< IPMI completion code, 0 when the reply itself was malformed
+            process_error(const std::string& what, uint8_t code_=0)
+                : std::runtime_error(what)
+                , code(code_)
+            {};
+        };
+        struct timeout_error : public std::runtime_error {
             using std::runtime_error::runtime_error;
         };
 
+        static const double WRITE_QUEUE_TIMEOUT;//!< Seconds a write may wait in the write lane before it's dropped, time on the wire not included.
+
         Provider(const std::string& conn_id);
 
         ~Provider();
 
         /**
          * @brief Schedules retrieving IPMI value and calling cb function when done.
+         *
+         * Tasks with a resolved command go to the write lane, served before
+         * reads. A write from the same record as one still queued is merged
+         * into it, the newer value is written and both get completed. So is
+         * a write of the same value to the same target from another record.
          * @param address IPMI entity address
          * @param cb function to be called upon (un)succesfull completion
          * @return true if succesfully scheduled and will invoke record post-processing
@@ -91,6 +352,15 @@ class Provider {
          */
         void tasksThread();
 
+        /**
+         * @brief Tell the processing thread to stop without waiting for it.
+         *
+         * Queued tasks are dropped, thread closes the session once the
+         * task it's working on is done.
+         * @return number of dropped tasks
+         */
+        size_t requestStop();
+
         /**
          * @brief Stop the processing thread, to be run from destructor.
          * @param timeout in seconds to wait for thread, 0 means no timeout
@@ -98,27 +368,98 @@ class Provider {
          */
         bool stopThread(double timeout=0.0);
 
+        /**
+         * @brief Was processing thread asked to stop.
+         */
+        bool isStopping() const;
+
         void start();
 
+        /**
+         * @brief Return task counters and current queue depth.
+         */
+        TaskStats getTaskStats();
+
+        /**
+         * @brief Latency of all tasks of this connection.
+         */
+        LatencyStats& getLatency();
+
     private:
 
         const std::string mConnId;
         struct {
-            bool processing{true};
+            std::atomic<bool> processing{true};
+            std::atomic<bool> exited{false};    //!< Thread is done, stopped event may have been consumed already
             std::list<Task> queue;
+            std::list<Task> writes;             //!< Write lane, served before reads
             epicsMutex mutex;
             epicsEvent event;
             epicsEvent stopped;
+            std::atomic<unsigned long> completed{0};
+            std::atomic<unsigned long> suppressed{0};
+            std::atomic<unsigned long> errors{0};
+            std::atomic<double> rate{0.0};
+            std::atomic<double> errorRate{0.0};
+            epicsTime rateStart;                //!< Beginning of current rate window
+            unsigned long rateCount{0};         //!< Tasks done when rate window started
+            unsigned long rateErrors{0};        //!< Tasks failed when rate window started
+            LatencyStats latency;
+            /** Last read failure written to log for one link. */
+            struct LoggedError {
+                std::shared_ptr<const EntityAddrType> entAddrTyp;   //!< Keeps the key alive
+                ReadError error;
+                epicsTime time;
+                unsigned long unlogged{0};      //!< Failures same as error not logged since
+            };
+            std::map<const EntityAddrType*, LoggedError> logged;    //!< Only touched by the connection thread
         } m_tasks;
 
+        void updateRate();
+
+        /**
+         * @brief Turn failed task's entity into previous result with given alarm.
+         */
+        void fail(Task& task, Entity& entity, int stat, int sevr, const std::string& error);
+
+        /**
+         * @brief Like fail() for sensor reads, formats error only when it gets logged.
+         *
+         * During an outage all reads fail the same way, such failures are
+         * logged once per period and counted in between.
+         */
+        void readFailed(Task& task, Entity& entity, const ReadError& error);
+
         /**
          * @brief Based on the address, determine IPMI entity type and retrieve its current value.
          * @param address FreeIPMI implementation specific address
          * @return current value
          */
-        virtual Entity getEntityValue(const std::shared_ptr<EntityAddrType> entAddrType) = 0;
-        virtual void write_oem_command(const std::shared_ptr<EntityAddrType> entAddrType, Entity &entity) = 0;
+        virtual Entity getEntityValue(const std::shared_ptr<const EntityAddrType> entAddrType) = 0;
+
+        /**
+         * @brief Retrieve current value of already resolved sensor.
+         * @return false and the reason in error when sensor couldn't be read
+         */
+        virtual bool readSensorValue(const std::shared_ptr<IpmiSensorRecComp> sensor, Entity& entity, ReadError& error,
+                                     WireTime& wire) = 0;
+
+        /**
+         * @brief Describe failed sensor read for the log.
+         */
+        virtual std::string formatReadError(const IpmiSensorRecComp& sensor, const ReadError& error) = 0;
+
+        /**
+         * @brief Read all sensors of the snapshot and store readings into it.
+         * @return COUNT of sensors and VAL with the number of failed reads
+         */
+        virtual Entity readSnapshot(Snapshot &snapshot) = 0;
         
         virtual void process() = 0;
 
+        /**
+         * @brief Called from processing thread when it stops, closes the session.
+         */
+        virtual void close() {};
+
 };
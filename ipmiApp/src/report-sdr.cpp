@@ -45,6 +45,9 @@ bool create_report_file = false;
 std::string report_file_name;
 bool create_epics_db_file = false;
 std::string epics_db_file_name;
+bool probe_leds = true;
+std::string led_cache_file_name;
+std::map<std::string, std::string> led_cache;   //!< LED results by FRU cache key, same as the IOC's .leds file
 ipmi_sdr_ctx_t sdr{nullptr};
 
 uint16_t record_count = 0;
@@ -87,7 +90,8 @@ void print_help() {
     ss << "\n";
     ss << "Usage: report-sdr [-H hostname or ip address] [-u username] [-p password]\n";
     ss << "[--auth-type [none, plain, md2, md5]] [--privilege-level [admin, operator, user]]\n";
-    ss << "[--create-report-file [FILE NAME]] [--create-db-file [FILE NAME]]\n\n";
+    ss << "[--create-report-file [FILE NAME]] [--create-db-file [FILE NAME]]\n";
+    ss << "[--led-cache [FILE NAME]] [--no-leds]\n\n";
     ss << "Description\n";
     ss << "    Read the SDR (Sensor Device Repository) and display the sensor records.\n\n";
     ss << "Options:\n";
@@ -97,7 +101,9 @@ void print_help() {
     ss << "    --auth-type Authentication Type (none, plain, md2, md5)\n";
     ss << "    --privilege-level Privilege Level (admin, operator, user)\n";
     ss << "    --create-report-file Create a file that contains the SDR data\n";
-    ss << "    --create-db-file Create an EPICS database file from the SDR data\n\n";
+    ss << "    --create-db-file Create an EPICS database file from the SDR data\n";
+    ss << "    --led-cache Take PICMG LEDs from an IOC's .leds cache file, only FRUs missing there are probed\n";
+    ss << "    --no-leds Don't probe FRUs for PICMG LEDs, non-physical FRUs may take seconds to time out\n\n";
     ss << "Examples:\n";
     ss << "To print the SDR to the console:\n";
     ss << "./report-sdr -H 192.168.201.205 -u \"ADMIN\" -p \"Password0\" --auth-type md5 --privilege-level admin\n\n";
@@ -178,6 +184,16 @@ void ipmi_init() {
         epics_db_file_name = itr->second.c_str();
     }
 
+    itr = cli_args_map.find("--led-cache");
+    if(itr != cli_args_map.end()) {
+        led_cache_file_name = itr->second;
+    }
+
+    itr = cli_args_map.find("--no-leds");
+    if(itr != cli_args_map.end()) {
+        probe_leds = false;
+    }
+
     ipmi = ipmi_ctx_create();
     if(ipmi == nullptr) {
         throw std::logic_error(
@@ -256,6 +272,57 @@ void ipmi_open_cache() {
     }
 }
 
+/** Only trust the cache when it was written for this very SDR. */
+void load_led_cache() {
+
+    std::ifstream file(led_cache_file_name);
+    if(!file.is_open())
+        throw std::runtime_error("Can't open LED cache file \'" + led_cache_file_name + "\'");
+
+    std::string line;
+    std::string tag;
+    uint32_t addTs = 0, eraseTs = 0;
+    if(std::getline(file, line))
+        std::istringstream(line) >> tag >> addTs >> eraseTs;
+    if(tag != "sdr" || addTs != SdrAdditionTimestamp || eraseTs != SdrEraseTimestamp) {
+        std::cerr << "LED cache \'" << led_cache_file_name << "\' is for a different SDR, ignoring it\n";
+        return;
+    }
+
+    while(std::getline(file, line)) {
+        auto pos = line.find(' ');
+        if(pos != std::string::npos)
+            led_cache[line.substr(0, pos)] = line.substr(pos + 1);
+    }
+}
+
+void add_fru_leds(std::shared_ptr<IpmiFruDevLocRec> fru) {
+
+    auto it = led_cache.find(fru->getLedCacheKey());
+    if(it != led_cache.end()) {
+        std::istringstream ss(it->second);
+        std::string led;
+        while(ss >> led) {
+            auto pos = led.find('=');
+            if(pos != std::string::npos)
+                fru->addStatusLed(std::stoi(led.substr(0, pos)), led.substr(pos + 1));
+        }
+        return;
+    }
+
+    if(!probe_leds)
+        return;
+
+    /** Does this FRU device have LEDs? */
+    try {
+        for(auto &led : fru->discoverStatusLeds(ipmi))
+            fru->addStatusLed(led->getLedId(), led->getLedColor());
+    } catch(const std::exception& e) {
+        std::cerr << fru->get_device_id_string() << " [" << (unsigned) fru->get_device_slave_address()
+        << "] " << e.what() << '\n';
+    }
+}
+
 void ipmi_parse_sdr() {
 
     if(ipmi_sdr_cache_sdr_version (sdr, &SdrVersion) < 0)
@@ -273,6 +340,9 @@ void ipmi_parse_sdr() {
     if(ipmi_sdr_cache_record_count (sdr, &record_count) < 0)
         throw std::runtime_error("Error! Could not read SDR cache record count.");
 
+    if(!led_cache_file_name.empty())
+        load_led_cache();
+
     const void *sdr_record = NULL;
     unsigned int sdr_record_len = 0;
     uint16_t record_id = 0;
@@ -305,7 +375,9 @@ void ipmi_parse_sdr() {
         }
 
         if(record_type == IPMI_SDR_FORMAT_FRU_DEVICE_LOCATOR_RECORD) {
-            fruDevLocRecList.push_back(std::make_shared<IpmiFruDevLocRec>(ipmi, sdr, record_id, record_type));
+            auto fru = std::make_shared<IpmiFruDevLocRec>(sdr, record_id, record_type);
+            add_fru_leds(fru);
+            fruDevLocRecList.push_back(fru);
         }
 
         if(record_type == IPMI_SDR_FORMAT_MANAGEMENT_CONTROLLER_DEVICE_LOCATOR_RECORD) {
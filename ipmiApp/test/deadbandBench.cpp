@@ -0,0 +1,135 @@
+/* deadbandBench.cpp
+ *
+ * Copyright (c) 2018 Oak Ridge National Laboratory.
+ * All rights reserved.
+ * See file LICENSE that is included with this distribution.
+ *
+ * Connection thread's cost of the deadband check and the share of reads
+ * it keeps from processing their record. Processing itself needs an IOC,
+ * ipmiUpdateReport counts processed and suppressed reads on a live one.
+ *
+ * Usage: deadbandBench [reads] [noise]
+ *   noise is the peak to peak change between readings in deadbands, default 0.8
+ */
+
+#include "provider.h"
+#include "sdrRecords.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+/** Sensors read in turn, each has its own record. */
+static const unsigned SENSORS = 100;
+static const double DEADBAND = 0.5;
+
+/** Sensor readings wandering around 25 degrees C. */
+class NoisyProvider : public Provider {
+    public:
+        NoisyProvider(double noise)
+        : Provider("bench")
+        , mNoise(noise)
+        {}
+
+    private:
+        Entity getEntityValue(const std::shared_ptr<const EntityAddrType> entAddrType) override
+        {
+            return Entity();
+        }
+
+        bool readSensorValue(const std::shared_ptr<IpmiSensorRecComp> sensor, Entity& entity, ReadError& error,
+                             WireTime& wire) override
+        {
+            /** Cheap deterministic noise, same readings for both runs. */
+            mSeed = mSeed * 1103515245 + 12345;
+            double noise = mNoise * DEADBAND * ((mSeed >> 16) % 1000 / 1000.0 - 0.5);
+            entity.setField<Entity::VAL>(25.0 + noise);
+            entity.setField<Entity::HIGH>(70.0);
+            entity.setField<Entity::HIHI>(85.0);
+            return true;
+        }
+
+        std::string formatReadError(const IpmiSensorRecComp& sensor, const ReadError& error) override
+        {
+            return "";
+        }
+
+        Entity readSnapshot(Snapshot &snapshot) override
+        {
+            return Entity();
+        }
+
+        void process() override {}
+
+        double mNoise;
+        uint32_t mSeed{1};
+};
+
+/** Run all reads through the connection thread's loop, in this thread. */
+static double run(size_t reads, double noise, double deadband, const std::vector<std::shared_ptr<IpmiSensorRecComp>>& sensors,
+                  const std::vector<std::shared_ptr<const EntityAddrType>>& links, size_t& processed)
+{
+    NoisyProvider provider(noise);
+    std::vector<common::Mailbox<Provider::Entity>> mailboxes(SENSORS);
+    std::vector<Provider::ChangeFilter> filters(SENSORS);
+    size_t done = 0;
+    processed = 0;
+    auto complete = [&done, &provider, reads]()
+    {
+        if(++done == reads)
+            provider.requestStop();
+    };
+    std::function<void()> cb = [&processed, &complete]()
+    {
+        processed++;
+        complete();
+    };
+
+    for(auto &filter : filters)
+    {
+        filter.deadband = deadband;
+        filter.release = complete;
+    }
+    for(size_t i = 0; i < reads; i++)
+    {
+        size_t n = i % SENSORS;
+        Provider::Task task(links[n], cb, mailboxes[n], sensors[n]);
+        task.filter = &filters[n];
+        provider.schedule(std::move(task));
+    }
+
+    epicsTime start = epicsTime::getCurrent();
+    provider.tasksThread();
+    return (epicsTime::getCurrent() - start) / reads;
+}
+
+int main(int argc, char **argv)
+{
+    size_t reads = (argc > 1 ? strtoul(argv[1], nullptr, 10) : 100000);
+    double noise = (argc > 2 ? atof(argv[2]) : 0.8);
+
+    ipmi_sdr_ctx_t sdr = ipmi_sdr_ctx_create();
+    std::vector<std::vector<uint8_t>> records;
+    std::vector<std::shared_ptr<IpmiSensorRecComp>> sensors;
+    std::vector<std::shared_ptr<const EntityAddrType>> links;
+    for(unsigned i = 0; i < SENSORS; i++)
+    {
+        std::string name = "TEMP" + std::to_string(i);
+        records.push_back(sdrRecords::compactSensor(i, i, name));
+        common::bytes_view data{records.back().data(), static_cast<unsigned>(records.back().size())};
+        sensors.push_back(std::make_shared<IpmiSensorRecComp>(sdr, i, IPMI_SDR_FORMAT_COMPACT_SENSOR_RECORD, data));
+        links.push_back(EntityAddrType::intern("bench SENSOR 30:97 \'" + name + "\'"));
+    }
+
+    size_t processedAll, processedChanged;
+    double allTime = run(reads, noise, -1.0, sensors, links, processedAll);
+    double filterTime = run(reads, noise, DEADBAND, sensors, links, processedChanged);
+
+    printf("%zu reads of %u sensors, noise %.2f deadbands\n", reads, SENSORS, noise);
+    printf("no deadband: %6.0f ns/read, %6.1f%% records processed\n", allTime * 1e9, 100.0 * processedAll / reads);
+    printf("deadband:    %6.0f ns/read, %6.1f%% records processed\n", filterTime * 1e9, 100.0 * processedChanged / reads);
+
+    ipmi_sdr_ctx_destroy(sdr);
+    return 0;
+}
@@ -0,0 +1,139 @@
+/* entityBench.cpp
+ *
+ * Copyright (c) 2018 Oak Ridge National Laboratory.
+ * All rights reserved.
+ * See file LICENSE that is included with this distribution.
+ *
+ * Cost of handing one threshold sensor reading to an ai record, with the
+ * string keyed Entity it used to be and the fixed layout Provider::Entity.
+ * Each scan fills the reading like the sensor reader does, hands it to the
+ * record like the connection thread does and reads it back like
+ * processAiRecord() does.
+ *
+ * Usage: entityBench [scans]
+ */
+
+#include "provider.h"
+#include "mapEntity.h"
+#include "heapCounter.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+/** Fields of aiRecord that device support writes. */
+struct AiFields {
+    double val{0.0}, hihi{0.0}, high{0.0}, low{0.0}, lolo{0.0}, hyst{0.0};
+    int sevr{0}, stat{0};
+};
+
+/** Keep the compiler from dropping the work. */
+static volatile double g_sink = 0.0;
+
+__attribute__((noinline)) static mapEntity::Entity readMap(double value)
+{
+    mapEntity::Entity entity;
+    entity["VAL"] = value;
+    entity["THRESHOLDS_READABLE"] = 0x3F;
+    entity["HIHI"] = value + 30.0;
+    entity["HIGH"] = value + 20.0;
+    entity["LOW"] = value - 20.0;
+    entity["LOLO"] = value - 30.0;
+    entity["HYST"] = 1.0;
+    return entity;
+}
+
+__attribute__((noinline)) static Provider::Entity readFixed(double value)
+{
+    Provider::Entity entity;
+    entity.setField<Provider::Entity::VAL>(value);
+    entity.setField<Provider::Entity::THRESHOLDS_READABLE>(0x3F);
+    entity.setField<Provider::Entity::HIHI>(value + 30.0);
+    entity.setField<Provider::Entity::HIGH>(value + 20.0);
+    entity.setField<Provider::Entity::LOW>(value - 20.0);
+    entity.setField<Provider::Entity::LOLO>(value - 30.0);
+    entity.setField<Provider::Entity::HYST>(1.0);
+    return entity;
+}
+
+static double scanMap(size_t scans, size_t &allocations)
+{
+    mapEntity::Entity recordEntity;
+    size_t allocationsBefore = heapCounter::getAllocations();
+    epicsTime start = epicsTime::getCurrent();
+    for(size_t i = 0; i < scans; i++)
+    {
+        auto entity = readMap(i % 100);
+        for(auto &kv : entity)
+            recordEntity[kv.first] = std::move(kv.second);
+        recordEntity["SEVR"] = 0;
+        recordEntity["STAT"] = 0;
+
+        AiFields rec;
+        rec.val = recordEntity.getField<double>("VAL", rec.val);
+        if(recordEntity.hasField("HIHI"))
+            rec.hihi = recordEntity.getField<double>("HIHI", rec.hihi);
+        if(recordEntity.hasField("HIGH"))
+            rec.high = recordEntity.getField<double>("HIGH", rec.high);
+        if(recordEntity.hasField("LOW"))
+            rec.low = recordEntity.getField<double>("LOW", rec.low);
+        if(recordEntity.hasField("LOLO"))
+            rec.lolo = recordEntity.getField<double>("LOLO", rec.lolo);
+        if(recordEntity.hasField("HYST"))
+            rec.hyst = recordEntity.getField<double>("HYST", rec.hyst);
+        rec.sevr = recordEntity.getField<int>("SEVR", 0);
+        rec.stat = recordEntity.getField<int>("STAT", 0);
+        g_sink = g_sink + rec.val + rec.hihi + rec.lolo + rec.sevr;
+    }
+    double time = epicsTime::getCurrent() - start;
+    allocations = heapCounter::getAllocations() - allocationsBefore;
+    return time / scans;
+}
+
+static double scanFixed(size_t scans, size_t &allocations)
+{
+    common::Mailbox<Provider::Entity> mailbox;
+    Provider::Entity recordEntity;
+    size_t allocationsBefore = heapCounter::getAllocations();
+    epicsTime start = epicsTime::getCurrent();
+    for(size_t i = 0; i < scans; i++)
+    {
+        auto entity = readFixed(i % 100);
+        entity.sevr = 0;
+        entity.stat = 0;
+        mailbox.publish(entity);
+        mailbox.read(recordEntity);
+
+        AiFields rec;
+        rec.val = recordEntity.getField<Provider::Entity::VAL>(rec.val);
+        if(recordEntity.hasField<Provider::Entity::HIHI>())
+            rec.hihi = recordEntity.getField<Provider::Entity::HIHI>(rec.hihi);
+        if(recordEntity.hasField<Provider::Entity::HIGH>())
+            rec.high = recordEntity.getField<Provider::Entity::HIGH>(rec.high);
+        if(recordEntity.hasField<Provider::Entity::LOW>())
+            rec.low = recordEntity.getField<Provider::Entity::LOW>(rec.low);
+        if(recordEntity.hasField<Provider::Entity::LOLO>())
+            rec.lolo = recordEntity.getField<Provider::Entity::LOLO>(rec.lolo);
+        if(recordEntity.hasField<Provider::Entity::HYST>())
+            rec.hyst = recordEntity.getField<Provider::Entity::HYST>(rec.hyst);
+        rec.sevr = recordEntity.sevr;
+        rec.stat = recordEntity.stat;
+        g_sink = g_sink + rec.val + rec.hihi + rec.lolo + rec.sevr;
+    }
+    double time = epicsTime::getCurrent() - start;
+    allocations = heapCounter::getAllocations() - allocationsBefore;
+    return time / scans;
+}
+
+int main(int argc, char **argv)
+{
+    size_t scans = (argc > 1 ? strtoul(argv[1], nullptr, 10) : 2000000);
+
+    size_t mapAllocations, fixedAllocations;
+    double mapTime = scanMap(scans, mapAllocations);
+    double fixedTime = scanFixed(scans, fixedAllocations);
+
+    printf("%zu scans of a threshold sensor\n", scans);
+    printf("map of variants: %8.1f ns/scan %6.1f allocations/scan\n", mapTime * 1e9, (double)mapAllocations / scans);
+    printf("fixed layout:    %8.1f ns/scan %6.1f allocations/scan\n", fixedTime * 1e9, (double)fixedAllocations / scans);
+    return 0;
+}
@@ -0,0 +1,54 @@
+/* heapCounter.cpp
+ *
+ * Copyright (c) 2018 Oak Ridge National Laboratory.
+ * All rights reserved.
+ * See file LICENSE that is included with this distribution.
+ */
+
+#include "heapCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include <malloc.h>
+
+static std::atomic<size_t> g_live{0};
+static std::atomic<size_t> g_allocations{0};
+
+/** Array, nothrow and sized forms all end up in these by default. */
+void* operator new(std::size_t size)
+{
+    void* ptr = malloc(size > 0 ? size : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+    g_allocations++;
+    g_live += malloc_usable_size(ptr);
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+    if (ptr)
+        g_live -= malloc_usable_size(ptr);
+    free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    operator delete(ptr);
+}
+
+namespace heapCounter {
+
+size_t getLive()
+{
+    return g_live;
+}
+
+size_t getAllocations()
+{
+    return g_allocations;
+}
+
+} // namespace heapCounter
@@ -0,0 +1,27 @@
+/* heapCounter.h
+ *
+ * Copyright (c) 2018 Oak Ridge National Laboratory.
+ * All rights reserved.
+ * See file LICENSE that is included with this distribution.
+ *
+ * Heap use of benchmarks, linking heapCounter.cpp replaces global operator
+ * new and delete of the program with counting ones.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace heapCounter {
+
+/**
+ * @brief Bytes allocated through operator new and not freed yet, as sized by malloc.
+ */
+size_t getLive();
+
+/**
+ * @brief Number of operator new calls so far.
+ */
+size_t getAllocations();
+
+} // namespace heapCounter
@@ -0,0 +1,58 @@
+/* internBench.cpp
+ *
+ * Copyright (c) 2018 Oak Ridge National Laboratory.
+ * All rights reserved.
+ * See file LICENSE that is included with this distribution.
+ *
+ * Heap held by parsed record links, one EntityAddrType per record against
+ * records with identical links sharing one through EntityAddrType::intern().
+ *
+ * Usage: internBench [records] [records per link]
+ */
+
+#include "EntityAddrType.h"
+#include "heapCounter.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv)
+{
+    size_t records = (argc > 1 ? strtoul(argv[1], nullptr, 10) : 10000);
+    size_t perLink = (argc > 2 ? strtoul(argv[2], nullptr, 10) : 4);
+    size_t count = records / perLink;
+
+    /** Sensor links like a generated database, e.g. ai, alarm and archive records of one sensor. */
+    std::vector<std::string> links;
+    for(size_t i = 0; i < count; i++)
+        links.push_back("ipmidev" + std::to_string(i / 1000) + " SENSOR " + std::to_string(i % 256) +
+                        ":97 'SENSOR " + std::to_string(i) + "'");
+
+    size_t liveBefore = heapCounter::getLive();
+    std::vector<std::shared_ptr<const EntityAddrType>> parsed;
+    parsed.reserve(count * perLink);
+    size_t vectorSize = heapCounter::getLive() - liveBefore;
+    for(auto &link : links)
+    {
+        for(size_t i = 0; i < perLink; i++)
+            parsed.push_back(std::make_shared<const EntityAddrType>(link));
+    }
+    size_t separate = heapCounter::getLive() - liveBefore - vectorSize;
+    parsed.clear();
+
+    liveBefore = heapCounter::getLive();
+    for(auto &link : links)
+    {
+        for(size_t i = 0; i < perLink; i++)
+            parsed.push_back(EntityAddrType::intern(link));
+    }
+    size_t interned = heapCounter::getLive() - liveBefore;
+
+    printf("%zu records, %zu links, sizeof(EntityAddrType) %zu\n", parsed.size(), count, sizeof(EntityAddrType));
+    printf("one per record: %10zu bytes\n", separate);
+    printf("interned:       %10zu bytes, including intern table\n", interned);
+    return 0;
+}
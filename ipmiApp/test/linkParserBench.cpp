@@ -0,0 +1,82 @@
+/* linkParserBench.cpp
+ *
+ * Copyright (c) 2018 Oak Ridge National Laboratory.
+ * All rights reserved.
+ * See file LICENSE that is included with this distribution.
+ *
+ * Time spent parsing record links at iocInit, old regular expressions
+ * against EntityAddrType's tokenizer.
+ *
+ * Usage: linkParserBench [links]
+ */
+
+#include "EntityAddrType.h"
+#include "regexLinkParser.h"
+
+#include <epicsTime.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv)
+{
+    size_t count = (argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000);
+
+    /** Mostly sensors like a generated database, with some of the other link types. */
+    std::vector<std::string> links;
+    for(size_t i = 0; i < count; i++)
+    {
+        std::string conn = "ipmidev" + std::to_string(i / 1000);
+        switch(i % 10)
+        {
+            case 0:
+                links.push_back(conn + " FRU " + std::to_string(i % 256) + ":97 STATUS");
+                break;
+            case 1:
+                links.push_back(conn + " PICMG_LED " + std::to_string(i % 256) + ":1");
+                break;
+            case 2:
+                links.push_back(conn + " SENSOR 30:97 'CU TEMP" + std::to_string(i) + "' POLL=2 DEADBAND=auto");
+                break;
+            default:
+                links.push_back(conn + " SENSOR " + std::to_string(i % 256) + ":97 'SENSOR " + std::to_string(i) + "'");
+                break;
+        }
+    }
+
+    size_t errors = 0;
+    epicsTime start = epicsTime::getCurrent();
+    for(auto &link : links)
+    {
+        try
+        {
+            regexLinkParser::parse(link);
+        }
+        catch(const std::exception &e)
+        {
+            errors++;
+        }
+    }
+    double regexTime = epicsTime::getCurrent() - start;
+
+    start = epicsTime::getCurrent();
+    for(auto &link : links)
+    {
+        try
+        {
+            EntityAddrType entAddrType(link);
+        }
+        catch(const std::exception &e)
+        {
+            errors++;
+        }
+    }
+    double tokenizerTime = epicsTime::getCurrent() - start;
+
+    printf("%zu links, %zu errors\n", links.size(), errors);
+    printf("regex:     %10.3f ms total %10.0f ns/link\n", regexTime * 1e3, regexTime * 1e9 / links.size());
+    printf("tokenizer: %10.3f ms total %10.0f ns/link\n", tokenizerTime * 1e3, tokenizerTime * 1e9 / links.size());
+    return (errors == 0 ? 0 : 1);
+}
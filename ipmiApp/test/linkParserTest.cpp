@@ -0,0 +1,245 @@
+/* linkParserTest.cpp
+ *
+ * Copyright (c) 2018 Oak Ridge National Laboratory.
+ * All rights reserved.
+ * See file LICENSE that is included with this distribution.
+ *
+ * Record links are parsed the same as with the old regular expressions,
+ * except for the relaxations documented in EntityAddrType::parseInOutString().
+ */
+
+#include "EntityAddrType.h"
+#include "regexLinkParser.h"
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/** Same text as regexLinkParser::parse() produces for the same link. */
+static std::string describe(const EntityAddrType &entAddrType)
+{
+    static const char *types[] = {"SENSOR", "FRU", "PICMG_LED", "OEM_CMD", "SEL", "STATS"};
+    static const char *stats[] = {
+        "queue_depth", "read_rate", "error_rate", "errors", "timeouts", "reconnects",
+        "latency_avg", "latency_p99", "sdr_generation", "connected", "state"
+    };
+
+    std::ostringstream ss;
+    ss << types[static_cast<int>(entAddrType.getEntityAddressType())] << " " << entAddrType.getConnectionId();
+    switch(entAddrType.getEntityAddressType())
+    {
+        case EntityAddrType::Type::SENSOR:
+            ss << " " << unsigned(entAddrType.getSensorEntityId().first) << ":" << unsigned(entAddrType.getSensorEntityInstance().first)
+               << " '" << entAddrType.getSensorIdString().first << "' poll=" << entAddrType.getPollPeriod() << " deadband=";
+            if(entAddrType.isDeadbandAuto())
+                ss << "auto";
+            else if(entAddrType.getDeadband() < 0.0)
+                ss << "none";
+            else
+                ss << entAddrType.getDeadband();
+            break;
+        case EntityAddrType::Type::PICMG_LED:
+            ss << " " << unsigned(entAddrType.getPicmgLedFruDeviceSlaveSddress().first) << ":" << unsigned(entAddrType.getPicmgLedId().first);
+            break;
+        case EntityAddrType::Type::OEM_CMD:
+        {
+            auto cmd = entAddrType.get_oem_command();
+            ss << " " << std::get<0>(cmd) << " " << std::get<1>(cmd);
+            for(auto &arg : std::get<2>(cmd))
+                ss << " [" << arg << "]";
+            break;
+        }
+        case EntityAddrType::Type::FRU:
+        {
+            static const char *fields[] = {"VALUES", "STATUS", "NAMES"};
+            if(!entAddrType.getFruKey().empty())
+                ss << " " << entAddrType.getFruKey();
+            ss << " " << fields[static_cast<int>(entAddrType.getFruField())];
+            break;
+        }
+        case EntityAddrType::Type::STATS:
+            ss << " " << stats[static_cast<int>(entAddrType.getStat())];
+            break;
+        default:
+            break;
+    }
+    return ss.str();
+}
+
+static std::string parseNew(const std::string &link)
+{
+    try
+    {
+        return describe(EntityAddrType(link));
+    }
+    catch(const std::invalid_argument &e)
+    {
+        return "invalid";
+    }
+}
+
+static std::string parseOld(const std::string &link)
+{
+    try
+    {
+        return regexLinkParser::parse(link);
+    }
+    catch(const std::invalid_argument &e)
+    {
+        return "invalid";
+    }
+}
+
+/** Links written for the regex parser, valid and invalid. */
+static const std::vector<std::string> corpus = {
+    "ipmidev1 sensor 30:97 'CU TEMP1'",
+    "ipmidev1 SENSOR 30:97 'CU TEMP1'",
+    "vt811 SENSOR 29:97 'FAN1'",
+    "vt811 SENSOR 30 : 97 'VT BIOS POST '",
+    "vt811 SENSOR30:97 'CU TEMP1'",
+    "vt811 SENSOR 30:97'CU TEMP1'",
+    "vt811 SENSOR 300:97 'CU TEMP1'",
+    "vt811 SENSOR 30:97 'it's quoted'",
+    "vt811 SENSOR 30:97 ''",
+    "vt811 SENSOR 30:97 'A' POLL=2 'B'",
+    "vt811 SENSOR 30:97 'CU TEMP1'   ",
+    "vt811 SENSOR 30:97 'CU TEMP1' POLL=2",
+    "vt811 SENSOR 30:97 'CU TEMP1' poll = 2.5",
+    "vt811 SENSOR 30:97 'CU TEMP1' POLL=1.2.3",
+    "vt811 SENSOR 30:97 'CU TEMP1' DEADBAND=0.5",
+    "vt811 SENSOR 30:97 'CU TEMP1' DEADBAND=0.0000001",
+    "vt811 SENSOR 30:97 'CU TEMP1' DEADBAND=1e3",
+    "vt811 SENSOR 30:97 'CU TEMP1' POLL=2 DEADBAND=AUTO",
+    "vt811 SENSOR 30:97 'CU TEMP1' DeadBand=auto\tPOLL=1",
+    "vt811 PICMG_LED 0:1",
+    "vt811 picmg_led 5 : 2",
+    "vt811 PICMG_LED0:1",
+    "vt811 OEM_CMD vadatech reboot",
+    "vt811 OEM_CMD VadaTech Reboot",
+    "vt811  OEM_CMD  vadatech  reboot",
+    "vt811 OEM_CMD vt set-power-state AMC 1",
+    "vt811 OEM_CMD vadatech set-power-state amc 10",
+    "vt811 OEM_CMD vadatech set-fan fan_1 auto",
+    "vt811 SEL",
+    "vt811 sel",
+    "vt811 SEL  ",
+    "vt811\tSEL",
+    "vt811 FRU",
+    "vt811 FRU 193:97",
+    "vt811 fru 193 : 97 status",
+    "vt811 FRU NAMES",
+    "vt811 FRU 193:97 values",
+    "vt811 FRU\t193:97\tSTATUS",
+
+    "",
+    "vt811",
+    "vt811 SENSOR",
+    "vt811 SENSOR 30:97",
+    "vt811 SENSOR 30:97 CU TEMP1",
+    "vt811 SENSOR 30:97 'CU TEMP1",
+    "vt811 SENSOR 30 97 'CU TEMP1'",
+    "vt811 SENSOR :97 'CU TEMP1'",
+    "vt811 SENSOR 30:97 'CU TEMP1' POLL",
+    "vt811 SENSOR 30:97 'CU TEMP1' POLL=",
+    "vt811 SENSOR 30:97 'CU TEMP1' POLL=fast",
+    "vt811 SENSOR 30:97 'CU TEMP1' FOO=1",
+    "vt811 SENSOR 30:97 'CU TEMP1' DEADBAND=-1",
+    "vt811 SENSOR 30:97 'CU TEMP1' junk",
+    "vt811 SENSOR 30:97 'CU TEMP1'POLL=2",
+    "vt-811 SENSOR 30:97 'CU TEMP1'",
+    "vt811 LED 0:1",
+    "vt811 PICMG_LED 0",
+    "vt811 PICMG_LED 0:1 extra",
+    "vt811 OEM_CMD vadatech",
+    "vt811 OEM_CMD vendor! reboot",
+    "vt811 OEM_CMD vadatech reboot!",
+    "vt811 SEL 1",
+    "vt811 FRU 193",
+    "vt811 FRU 193:97 STATE",
+    "vt811 FRU STATUS NAMES",
+    "vt811 FRU193:97",
+    "vt811 FRU 193:97STATUS",
+};
+
+/** Links the regex parser rejected or split differently, with what the tokenizer makes of them. */
+static const std::vector<std::pair<std::string, std::string>> relaxed = {
+    {" vt811 SEL",                                          "SEL vt811"},
+    {"vt811\tSENSOR 30:97 'CU TEMP1'",                      "SENSOR vt811 30:97 'CU TEMP1' poll=0 deadband=none"},
+    {"vt811  SENSOR 30:97 'CU TEMP1'",                      "SENSOR vt811 30:97 'CU TEMP1' poll=0 deadband=none"},
+    {"vt811 SENSOR\t30\t:\t97\t'CU TEMP1'",                 "SENSOR vt811 30:97 'CU TEMP1' poll=0 deadband=none"},
+    {"vt811 PICMG_LED 0:1 ",                                "PICMG_LED vt811 0:1"},
+    {"vt811 oem_cmd vadatech reboot",                       "OEM_CMD vt811 vadatech reboot"},
+    {"vt811 OEM_CMD vadatech reboot 1",                     "OEM_CMD vt811 vadatech reboot [1]"},
+    {"vt811 OEM_CMD vadatech reboot ",                      "OEM_CMD vt811 vadatech reboot"},
+    {"vt811 OEM_CMD vadatech set-power-state  AMC 1",       "OEM_CMD vt811 vadatech set-power-state [amc] [1]"},
+};
+
+/** Split the same link differently, tabs separate OEM arguments now. */
+static const std::vector<std::pair<std::string, std::string>> changed = {
+    {"vt811 OEM_CMD vadatech set-power-state AMC\t1",       "OEM_CMD vt811 vadatech set-power-state [amc] [1]"},
+};
+
+/** STATS links didn't exist with the regex parser. */
+static const std::vector<std::pair<std::string, std::string>> stats = {
+    {"vt811 STATS queue_depth",                             "STATS vt811 queue_depth"},
+    {"vt811 stats STATE",                                   "STATS vt811 state"},
+    {"vt811 STATS latency_p99 ",                            "STATS vt811 latency_p99"},
+    {"vt811 STATS foo",                                     "invalid"},
+    {"vt811 STATS",                                         "invalid"},
+    {"vt811 STATS state connected",                         "invalid"},
+};
+
+MAIN(linkParserTest)
+{
+    testPlan(corpus.size() + 2 * relaxed.size() + 2 * changed.size() + stats.size() + 2);
+
+    testDiag("Links written for the regex parser");
+    for(auto &link : corpus)
+    {
+        std::string expected = parseOld(link);
+        std::string parsed = parseNew(link);
+        testOk(parsed == expected, "'%s' -> %s (regex %s)", link.c_str(), parsed.c_str(), expected.c_str());
+    }
+
+    testDiag("Whitespace and case the regex parser didn't accept");
+    for(auto &test : relaxed)
+    {
+        testOk(parseOld(test.first) == "invalid", "regex rejects '%s'", test.first.c_str());
+        std::string parsed = parseNew(test.first);
+        testOk(parsed == test.second, "'%s' -> %s", test.first.c_str(), parsed.c_str());
+    }
+    for(auto &test : changed)
+    {
+        std::string expected = parseOld(test.first);
+        testOk(expected != "invalid" && expected != test.second, "regex gives '%s'", expected.c_str());
+        std::string parsed = parseNew(test.first);
+        testOk(parsed == test.second, "'%s' -> %s", test.first.c_str(), parsed.c_str());
+    }
+
+    testDiag("STATS links");
+    for(auto &test : stats)
+    {
+        std::string parsed = parseNew(test.first);
+        testOk(parsed == test.second, "'%s' -> %s", test.first.c_str(), parsed.c_str());
+    }
+
+    double deadband = EntityAddrType("vt811 SENSOR 30:97 'CU TEMP1' DEADBAND=0.0000001").getDeadband();
+    testOk(deadband == 1e-7, "deadband smaller than 1e-6 is kept: %g", deadband);
+
+    try
+    {
+        EntityAddrType("vt811 SENSOR 30:97 'CU TEMP1' POLL");
+        testFail("missing option value accepted");
+    }
+    catch(const std::invalid_argument &e)
+    {
+        testOk(std::string(e.what()).find("expected '=' after option name at position 34") != std::string::npos,
+               "error tells where parsing stopped: %s", e.what());
+    }
+
+    return testDone();
+}
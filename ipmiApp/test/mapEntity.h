@@ -0,0 +1,42 @@
+/* mapEntity.h
+ *
+ * Copyright (c) 2018 Oak Ridge National Laboratory.
+ * All rights reserved.
+ * See file LICENSE that is included with this distribution.
+ *
+ * Provider::Entity as it was before it got a fixed layout, string keyed
+ * map of variants, kept as reference for the benchmark.
+ */
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <variant>
+
+namespace mapEntity {
+
+typedef std::variant<int,double,std::string> Variant;
+
+class Entity : public std::map<std::string, Variant> {
+    public:
+        template <typename T>
+        T getField(const std::string& field, const T& default_) const
+        {
+            auto it = find(field);
+            if (it != end()) {
+                auto ptr = std::get_if<T>(&it->second);
+                if (ptr)
+                    return *ptr;
+            }
+            return default_;
+        }
+
+        bool hasField(const std::string& field)
+        {
+            auto it = find(field);
+            return (it != end());
+        }
+};
+
+} // namespace mapEntity
@@ -0,0 +1,147 @@
+/* readErrorBench.cpp
+ *
+ * Copyright (c) 2018 Oak Ridge National Laboratory.
+ * All rights reserved.
+ * See file LICENSE that is included with this distribution.
+ *
+ * Cost of a failed sensor read on the connection thread, e.g. during an
+ * outage. The old path formatted every failure into text, threw it and
+ * rethrew it before Provider logged it. The new one returns a compact
+ * ReadError that is only formatted when it gets logged.
+ *
+ * Usage: readErrorBench [reads] [log level]
+ */
+
+#include "provider.h"
+#include "IpmiException.h"
+#include "sdrRecords.h"
+
+#include <freeipmi/freeipmi.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/** Sensors failing in turn, each has its own link. */
+static const unsigned SENSORS = 100;
+
+class FailingProvider : public Provider {
+    public:
+        FailingProvider()
+        : Provider("bench")
+        {}
+
+    private:
+        /** Old path, as IpmiConnectionManager::getSensorReading() used to fail on session timeout. */
+        Entity getEntityValue(const std::shared_ptr<const EntityAddrType> entAddrType) override
+        {
+            try
+            {
+                std::string str_error = "internal IPMI error";
+                std::string str_errmsg = "session timeout";
+                throw IpmiException(16, "\'" + str_error + "\' Error Message: \'" + str_errmsg + "\'");
+            }
+            catch(const IpmiException &e)
+            {
+                std::stringstream ss;
+                ss << "Could not read sensor for {\n";
+                ss << " * Connection-ID: \'bench\'\n";
+                ss << " * Hostname: \'localhost\'\n";
+                ss << " * Entity-Id: \'" << std::to_string(entAddrType->getSensorEntityId().first) << "\'\n";
+                ss << " * Entity-Instance: \'" << std::to_string(entAddrType->getSensorEntityInstance().first) << "\'\n";
+                ss << " * Sensor-Id-String: \'" << entAddrType->getSensorIdString().first << "\'\n";
+                ss << " * Reason: \'Session Timeout\'" << "\n";
+                ss << " * Error Code: \'" << e.getErrorCode() << "\', Error Message: \'" << e.getErrorString() << "\'\n";
+                ss << "}\n\n";
+                throw std::runtime_error(ss.str());
+            }
+        }
+
+        bool readSensorValue(const std::shared_ptr<IpmiSensorRecComp> sensor, Entity& entity, ReadError& error,
+                             WireTime& wire) override
+        {
+            error = {ReadError::Reason::SESSION_TIMEOUT, 16};
+            return false;
+        }
+
+        /** Same text as IpmiConnectionManager::formatReadError(). */
+        std::string formatReadError(const IpmiSensorRecComp& sensor, const ReadError& error) override
+        {
+            std::stringstream ss;
+            ss << "Could not read sensor for {\n";
+            ss << " * Connection-ID: \'bench\'\n";
+            ss << " * Hostname: \'localhost\'\n";
+            ss << " * Entity-Id: \'" << std::to_string(sensor.get_entity_id()) << "\'\n";
+            ss << " * Entity-Instance: \'" << std::to_string(sensor.get_entity_instance()) << "\'\n";
+            ss << " * Sensor-Id-String: \'" << sensor.get_device_id_string() << "\'\n";
+            ss << " * Reason: \'Session Timeout\'\n";
+            ss << " * Error Code: \'" << error.code << "\', Error Message: \'" << ipmi_sensor_read_ctx_strerror(error.code) << "\'\n";
+            ss << "}\n";
+            return ss.str();
+        }
+
+        Entity readSnapshot(Snapshot &snapshot) override
+        {
+            return Entity();
+        }
+
+        void process() override {}
+};
+
+/** Run all reads through the connection thread's loop, in this thread. */
+static double run(size_t reads, bool oldPath, const std::vector<std::shared_ptr<IpmiSensorRecComp>>& sensors,
+                  const std::vector<std::shared_ptr<const EntityAddrType>>& links)
+{
+    FailingProvider provider;
+    std::vector<common::Mailbox<Provider::Entity>> mailboxes(SENSORS);
+    size_t done = 0;
+    std::function<void()> cb = [&done, &provider, reads]()
+    {
+        if(++done == reads)
+            provider.requestStop();
+    };
+
+    for(size_t i = 0; i < reads; i++)
+    {
+        size_t n = i % SENSORS;
+        provider.schedule(Provider::Task(links[n], cb, mailboxes[n], (oldPath ? nullptr : sensors[n])));
+    }
+
+    epicsTime start = epicsTime::getCurrent();
+    provider.tasksThread();
+    return (epicsTime::getCurrent() - start) / reads;
+}
+
+int main(int argc, char **argv)
+{
+    size_t reads = (argc > 1 ? strtoul(argv[1], nullptr, 10) : 20000);
+    unsigned level = (argc > 2 ? atoi(argv[2]) : 0);
+
+    ipmi_sdr_ctx_t sdr = ipmi_sdr_ctx_create();
+    std::vector<std::vector<uint8_t>> records;
+    std::vector<std::shared_ptr<IpmiSensorRecComp>> sensors;
+    std::vector<std::shared_ptr<const EntityAddrType>> links;
+    for(unsigned i = 0; i < SENSORS; i++)
+    {
+        std::string name = "TEMP" + std::to_string(i);
+        records.push_back(sdrRecords::compactSensor(i, i, name));
+        common::bytes_view data{records.back().data(), static_cast<unsigned>(records.back().size())};
+        sensors.push_back(std::make_shared<IpmiSensorRecComp>(sdr, i, IPMI_SDR_FORMAT_COMPACT_SENSOR_RECORD, data));
+        links.push_back(EntityAddrType::intern("bench SENSOR 30:97 \'" + name + "\'"));
+    }
+
+    common::setLogLevel(level);
+    double oldTime = run(reads, true, sensors, links);
+    double newTime = run(reads, false, sensors, links);
+    common::flushLog();
+
+    printf("%zu failed reads of %u sensors, log level %u\n", reads, SENSORS, level);
+    printf("throw and format: %8.0f ns/read\n", oldTime * 1e9);
+    printf("ReadError:        %8.0f ns/read\n", newTime * 1e9);
+
+    ipmi_sdr_ctx_destroy(sdr);
+    return 0;
+}
@@ -0,0 +1,123 @@
+/* regexLinkParser.h
+ *
+ * Copyright (c) 2018 Oak Ridge National Laboratory.
+ * All rights reserved.
+ * See file LICENSE that is included with this distribution.
+ *
+ * Link parsing as done with regular expressions before EntityAddrType got its
+ * own tokenizer, kept as reference for the equivalence test and benchmark.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace regexLinkParser {
+
+/**
+ * @brief Parse link the old way and describe it like describe() in linkParserTest.
+ * @throw std::invalid_argument when old parser rejected the link
+ */
+inline std::string parse(const std::string &link)
+{
+    std::regex re_sensor ("([a-zA-Z0-9]+) ([sS][eE][nN][sS][oO][rR]) *([0-9]+) *: *([0-9]+) *\'(.*)\'((?:\\s+[a-zA-Z]+\\s*=\\s*[a-zA-Z0-9.]+)*)\\s*");
+    std::regex re_option ("([a-zA-Z]+)\\s*=\\s*([a-zA-Z0-9.]+)");
+    std::regex re_picmg_led("([a-zA-Z0-9]+) ([pP][iI][cC][mM][gG]_[lL][eE][dD]) *([0-9]+) *: *([0-9]+)");
+    std::regex re_oem_cmd ("^([a-zA-Z0-9]+)\\s+OEM_CMD\\s+([a-zA-Z0-9]+)\\s+([a-zA-Z0-9-]+)(?: ([a-zA-Z0-9][a-zA-Z0-9-_\\s]+))?$");
+    std::regex re_sel ("^([a-zA-Z0-9]+)\\s+[sS][eE][lL]\\s*$");
+    std::regex re_fru ("^([a-zA-Z0-9]+)\\s+[fF][rR][uU](?:\\s+([0-9]+)\\s*:\\s*([0-9]+))?(?:\\s+([a-zA-Z]+))?\\s*$");
+    std::smatch re_m;
+
+    auto lower = [](std::string str) {
+        std::transform(str.begin(), str.end(), str.begin(), ::tolower);
+        return str;
+    };
+    /** Options are compared by value, both parsers keep full precision. */
+    auto number = [](double value) {
+        std::ostringstream ss;
+        ss << value;
+        return ss.str();
+    };
+
+    std::ostringstream ss;
+    if(std::regex_match(link, re_m, re_sensor))
+    {
+        std::string sid;
+        for(auto &ch : re_m[5].str())
+        {
+            if(ch != '\'')
+                sid.push_back(ch);
+        }
+        double poll = 0.0;
+        std::string deadband = "none";
+        const std::string options = re_m[6].str();
+        for(auto it = std::sregex_iterator(options.begin(), options.end(), re_option); it != std::sregex_iterator(); ++it)
+        {
+            std::string key = (*it)[1].str();
+            std::string value = lower((*it)[2].str());
+            std::transform(key.begin(), key.end(), key.begin(), ::toupper);
+            try
+            {
+                if(key == "POLL")
+                    poll = std::stod(value);
+                else if(key == "DEADBAND" && value == "auto")
+                    deadband = value;
+                else if(key == "DEADBAND")
+                    deadband = number(std::stod(value));
+                else
+                    throw std::invalid_argument("unknown option");
+            }
+            catch(const std::logic_error &e)
+            {
+                throw std::invalid_argument("Invalid option \'" + (*it)[0].str() + "\' in link \'" + link + "\'");
+            }
+        }
+        ss << "SENSOR " << re_m[1] << " " << (std::stoul(re_m[3]) & 0xFF) << ":" << (std::stoul(re_m[4]) & 0xFF)
+           << " '" << sid << "' poll=" << poll << " deadband=" << deadband;
+    }
+    else if(std::regex_match(link, re_m, re_picmg_led))
+    {
+        ss << "PICMG_LED " << re_m[1] << " " << (std::stoul(re_m[3]) & 0xFF) << ":" << (std::stoul(re_m[4]) & 0xFF);
+    }
+    else if(std::regex_match(link, re_m, re_oem_cmd))
+    {
+        ss << "OEM_CMD " << re_m[1] << " " << lower(re_m[2].str()) << " " << lower(re_m[3].str());
+        const std::string args = re_m[4].str();
+        size_t start = 0;
+        size_t end = 0;
+        while((start = args.find_first_not_of(' ', end)) != std::string::npos)
+        {
+            end = args.find(' ', start);
+            ss << " [" << lower(args.substr(start, end - start)) << "]";
+        }
+    }
+    else if(std::regex_match(link, re_m, re_sel))
+    {
+        ss << "SEL " << re_m[1];
+    }
+    else if(std::regex_match(link, re_m, re_fru))
+    {
+        ss << "FRU " << re_m[1];
+        if(re_m[2].matched)
+            ss << " " << (std::stoul(re_m[2]) & 0xFF) << ":" << (std::stoul(re_m[3]) & 0xFF);
+        std::string field = re_m[4].str();
+        std::transform(field.begin(), field.end(), field.begin(), ::toupper);
+        if(field.empty())
+            field = "VALUES";
+        else if(field != "STATUS" && field != "NAMES" && field != "VALUES")
+            throw std::invalid_argument("Unknown FRU field \'" + re_m[4].str() + "\' in link \'" + link + "\'");
+        ss << " " << field;
+    }
+    else
+    {
+        throw std::invalid_argument("Link field does not contain proper arguments. \'" + link + "\'");
+    }
+    return ss.str();
+}
+
+} // namespace regexLinkParser
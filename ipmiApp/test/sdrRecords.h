@@ -0,0 +1,44 @@
+/* sdrRecords.h
+ *
+ * Copyright (c) 2018 Oak Ridge National Laboratory.
+ * All rights reserved.
+ * See file LICENSE that is included with this distribution.
+ *
+ * Raw SDR records for tests and benchmarks that run without a device.
+ */
+
+#pragma once
+
+#include <freeipmi/freeipmi.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace sdrRecords {
+
+/**
+ * @brief Compact sensor record of a threshold temperature sensor, IPMI 2.0 table 43-2.
+ */
+inline std::vector<uint8_t> compactSensor(uint16_t recordId, uint8_t number, const std::string &name)
+{
+    std::vector<uint8_t> rec(32 + name.size(), 0);
+    rec[0] = recordId & 0xFF;
+    rec[1] = recordId >> 8;
+    rec[2] = 0x51;                          // SDR version
+    rec[3] = IPMI_SDR_FORMAT_COMPACT_SENSOR_RECORD;
+    rec[4] = rec.size() - 5;
+    rec[5] = 0x20;                          // Owner is the BMC
+    rec[7] = number;
+    rec[8] = 30;                            // Entity id
+    rec[9] = 97;                            // Entity instance
+    rec[12] = 0x01;                         // Temperature
+    rec[13] = 0x01;                         // Threshold reading type
+    rec[21] = 0x01;                         // degrees C
+    rec[31] = 0xC0 | name.size();           // 8-bit ASCII id string
+    std::copy(name.begin(), name.end(), rec.begin() + 32);
+    return rec;
+}
+
+} // namespace sdrRecords
@@ -0,0 +1,79 @@
+/* sdrRepositoryBench.cpp
+ *
+ * Copyright (c) 2018 Oak Ridge National Laboratory.
+ * All rights reserved.
+ * See file LICENSE that is included with this distribution.
+ *
+ * Time and heap it takes to parse an SDR into IpmiSdrRepository, as done
+ * by the connection on every SDR (re)load. Reads the SDR cache file an IOC
+ * keeps for each connection, no device is needed.
+ *
+ * Usage: sdrRepositoryBench <connection>.<host>.cache [runs]
+ */
+
+#include "IpmiSdrRepository.h"
+#include "heapCounter.h"
+
+#include <epicsTime.h>
+
+#include <freeipmi/freeipmi.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+
+int main(int argc, char **argv)
+{
+    if(argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <SDR cache file> [runs]\n", argv[0]);
+        return 1;
+    }
+    unsigned runs = (argc > 2 ? atoi(argv[2]) : 50);
+
+    ipmi_sdr_ctx_t sdr = ipmi_sdr_ctx_create();
+    uint16_t count = 0;
+    if(ipmi_sdr_cache_open(sdr, nullptr, argv[1]) < 0 || ipmi_sdr_cache_record_count(sdr, &count) < 0)
+    {
+        fprintf(stderr, "Can't read SDR cache file '%s' - %s\n", argv[1], ipmi_sdr_ctx_errormsg(sdr));
+        ipmi_sdr_ctx_destroy(sdr);
+        return 1;
+    }
+
+    /** Best of all runs, heap is the same every time. */
+    double best = 0.0;
+    size_t live = 0, allocations = 0, usage = 0, sensors = 0, frus = 0;
+    try
+    {
+        for(unsigned i = 0; i < runs; i++)
+        {
+            size_t liveBefore = heapCounter::getLive();
+            size_t allocationsBefore = heapCounter::getAllocations();
+            epicsTime start = epicsTime::getCurrent();
+            auto repository = std::make_shared<IpmiSdrRepository>(sdr, count);
+            double time = epicsTime::getCurrent() - start;
+            live = heapCounter::getLive() - liveBefore;
+            allocations = heapCounter::getAllocations() - allocationsBefore;
+            best = (i == 0 ? time : std::min(best, time));
+            usage = repository->getMemoryUsage();
+            sensors = repository->getSensorCount();
+            frus = repository->getFruCount();
+        }
+    }
+    catch(const std::exception &e)
+    {
+        fprintf(stderr, "Can't parse SDR - %s\n", e.what());
+        ipmi_sdr_ctx_destroy(sdr);
+        return 1;
+    }
+
+    printf("%u records, %zu sensors, %zu FRUs\n", count, sensors, frus);
+    printf("parse:  %10.0f us, best of %u\n", best * 1e6, runs);
+    printf("heap:   %10zu bytes in %zu allocations, %zu bytes by getMemoryUsage()\n", live, allocations, usage);
+
+    ipmi_sdr_cache_close(sdr);
+    ipmi_sdr_ctx_destroy(sdr);
+    return 0;
+}